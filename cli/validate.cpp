@@ -0,0 +1,459 @@
+#include "uzuki/parser.hpp"
+#include "uzuki/error.hpp"
+#include "nlohmann/json.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <glob.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+/**
+ * Command-line tool to validate uzuki documents, see usage() for details.
+ */
+
+namespace {
+
+enum ExitCode : int {
+    ALL_VALID = 0,
+    SOME_INVALID = 1,
+    USAGE_ERROR = 2,
+    IO_ERROR = 3
+};
+
+void usage(std::ostream& out) {
+    out << "Usage: uzuki-validate [OPTIONS] PATH...\n"
+        << "\n"
+        << "Validate uzuki JSON documents. Each PATH may be a file, a directory\n"
+        << "(searched recursively for '*.json' files) or a glob pattern.\n"
+        << "\n"
+        << "Options:\n"
+        << "  -t, --threads N      Number of threads (default: hardware concurrency).\n"
+        << "  -e, --externals N    Expected number of external references in each document.\n"
+        << "  -r, --report FILE    Write a JSON report to FILE, or to stdout if FILE is '-'.\n"
+        << "  -q, --quiet          Only print failures and the summary.\n"
+        << "  -h, --help           Print this message.\n"
+        << "\n"
+        << "Exit status is 0 if all documents are valid, 1 if any document is invalid,\n"
+        << "2 for usage errors and 3 if any file could not be read or any PATH\n"
+        << "did not match any files.\n";
+}
+
+/*
+ * Read-only view of a file's contents, using a memory mapping where
+ * available to avoid copying the file into a separate buffer.
+ */
+class FileView {
+public:
+    explicit FileView(const std::string& path) {
+#ifndef _WIN32
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            throw std::runtime_error(std::string("failed to open file (") + std::strerror(errno) + ")");
+        }
+
+        struct stat info;
+        if (::fstat(fd, &info) != 0) {
+            ::close(fd);
+            throw std::runtime_error(std::string("failed to query file size (") + std::strerror(errno) + ")");
+        }
+
+        length = info.st_size;
+        if (length) {
+            void* ptr = ::mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (ptr == MAP_FAILED) {
+                ::close(fd);
+                throw std::runtime_error(std::string("failed to map file (") + std::strerror(errno) + ")");
+            }
+            mapped = static_cast<const char*>(ptr);
+            ::madvise(ptr, length, MADV_SEQUENTIAL);
+        }
+        ::close(fd);
+#else
+        std::ifstream handle(path, std::ios::binary);
+        if (!handle) {
+            throw std::runtime_error("failed to open file");
+        }
+        buffer.assign(std::istreambuf_iterator<char>(handle), std::istreambuf_iterator<char>());
+        length = buffer.size();
+#endif
+    }
+
+    ~FileView() {
+#ifndef _WIN32
+        if (mapped) {
+            ::munmap(const_cast<char*>(mapped), length);
+        }
+#endif
+    }
+
+    FileView(const FileView&) = delete;
+    FileView& operator=(const FileView&) = delete;
+
+    const char* data() const {
+#ifndef _WIN32
+        return mapped;
+#else
+        return buffer.data();
+#endif
+    }
+
+    size_t size() const {
+        return length;
+    }
+
+private:
+    size_t length = 0;
+#ifndef _WIN32
+    const char* mapped = nullptr;
+#else
+    std::string buffer;
+#endif
+};
+
+/*
+ * Counting the uzuki nodes, i.e., lists and their elements, using the same
+ * rules as the validator. An explicit stack is used for deeply nested documents.
+ */
+size_t count_nodes(const nlohmann::json& root) {
+    size_t count = 0;
+    std::vector<const nlohmann::json*> stack{ &root };
+    while (!stack.empty()) {
+        auto current = stack.back();
+        stack.pop_back();
+        ++count;
+
+        if (current->is_object()) {
+            auto tIt = current->find("type");
+            if (tIt != current->end() && tIt->is_string()) {
+                continue;
+            }
+        } else if (!current->is_array()) {
+            continue;
+        }
+
+        for (const auto& x : *current) {
+            stack.push_back(&x);
+        }
+    }
+    return count;
+}
+
+struct Outcome {
+    std::string path;
+    bool readable = true;
+    bool valid = false;
+    size_t bytes = 0;
+    size_t nodes = 0;
+    size_t externals = 0;
+    double seconds = 0;
+    uzuki::ErrorCode code = uzuki::ErrorCode::OK;
+    std::string error_path;
+    size_t error_index = uzuki::Error::no_index;
+    std::string message;
+};
+
+bool is_glob(const std::string& path) {
+    return path.find_first_of("*?[") != std::string::npos;
+}
+
+void collect_paths(const std::string& arg, std::vector<std::string>& paths) {
+    namespace fs = std::filesystem;
+
+#ifndef _WIN32
+    if (is_glob(arg) && !fs::exists(arg)) {
+        glob_t matches;
+        if (::glob(arg.c_str(), 0, nullptr, &matches) == 0) {
+            for (size_t i = 0; i < matches.gl_pathc; ++i) {
+                collect_paths(matches.gl_pathv[i], paths);
+            }
+        }
+        ::globfree(&matches);
+        return;
+    }
+#endif
+
+    std::error_code ec;
+    if (fs::is_directory(arg, ec)) {
+        std::vector<std::string> found;
+        for (fs::recursive_directory_iterator it(arg, fs::directory_options::skip_permission_denied, ec), end; !ec && it != end; it.increment(ec)) {
+            if (it->is_regular_file(ec) && it->path().extension() == ".json") {
+                found.push_back(it->path().string());
+            }
+        }
+        std::sort(found.begin(), found.end());
+        paths.insert(paths.end(), found.begin(), found.end());
+    } else {
+        paths.push_back(arg); // non-existent files are reported as unreadable.
+    }
+}
+
+Outcome validate_file(const std::string& path, uzuki::Parser<>& parser, bool check_externals, size_t num_external) {
+    Outcome output;
+    output.path = path;
+    auto start = std::chrono::steady_clock::now();
+
+    try {
+        FileView view(path);
+        output.bytes = view.size();
+
+        try {
+            auto contents = nlohmann::json::parse(view.data(), view.data() + view.size());
+            if (check_externals) {
+                parser.validate(contents, num_external);
+                output.externals = num_external;
+            } else {
+                output.externals = parser.validate(contents);
+            }
+            output.valid = true;
+            output.nodes = count_nodes(contents);
+
+        } catch (const uzuki::Error& e) {
+            output.code = e.code();
+            output.error_path = e.path();
+            output.error_index = e.index();
+            output.message = e.what();
+        } catch (const nlohmann::json::exception& e) {
+            output.code = uzuki::ErrorCode::UNKNOWN;
+            output.message = std::string("invalid JSON: ") + e.what();
+        } catch (const std::exception& e) {
+            output.code = uzuki::ErrorCode::UNKNOWN;
+            output.message = e.what();
+        }
+
+    } catch (const std::exception& e) {
+        output.readable = false;
+        output.message = e.what();
+    }
+
+    output.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return output;
+}
+
+nlohmann::json to_json(const Outcome& x) {
+    nlohmann::json out = {
+        { "path", x.path },
+        { "readable", x.readable },
+        { "valid", x.valid },
+        { "bytes", x.bytes },
+        { "nodes", x.nodes },
+        { "seconds", x.seconds }
+    };
+
+    if (x.valid) {
+        out["externals"] = x.externals;
+    } else {
+        nlohmann::json error = { { "message", x.message } };
+        if (x.readable) {
+            error["code"] = uzuki::error_name(x.code);
+            error["path"] = x.error_path;
+            if (x.error_index != uzuki::Error::no_index) {
+                error["index"] = x.error_index;
+            }
+        }
+        out["error"] = std::move(error);
+    }
+
+    return out;
+}
+
+bool parse_count(const char* arg, size_t& out) {
+    char* end = nullptr;
+    errno = 0;
+    auto val = std::strtoull(arg, &end, 10);
+    if (errno || end == arg || *end != '\0' || arg[0] == '-') {
+        return false;
+    }
+    out = val;
+    return true;
+}
+
+}
+
+int main(int argc, char** argv) {
+    size_t nthreads = std::max(1u, std::thread::hardware_concurrency());
+    bool check_externals = false;
+    size_t num_external = 0;
+    bool quiet = false;
+    std::string report;
+    std::vector<std::string> args;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string current = argv[i];
+        auto next_value = [&](const char* name) -> const char* {
+            if (i + 1 >= argc) {
+                std::cerr << "uzuki-validate: " << name << " requires a value" << std::endl;
+                std::exit(USAGE_ERROR);
+            }
+            return argv[++i];
+        };
+
+        if (current == "-h" || current == "--help") {
+            usage(std::cout);
+            return ALL_VALID;
+        } else if (current == "-t" || current == "--threads") {
+            if (!parse_count(next_value("--threads"), nthreads) || nthreads == 0) {
+                std::cerr << "uzuki-validate: --threads should be a positive integer" << std::endl;
+                return USAGE_ERROR;
+            }
+        } else if (current == "-e" || current == "--externals") {
+            if (!parse_count(next_value("--externals"), num_external)) {
+                std::cerr << "uzuki-validate: --externals should be a non-negative integer" << std::endl;
+                return USAGE_ERROR;
+            }
+            check_externals = true;
+        } else if (current == "-r" || current == "--report") {
+            report = next_value("--report");
+        } else if (current == "-q" || current == "--quiet") {
+            quiet = true;
+        } else if (current == "--") {
+            args.insert(args.end(), argv + i + 1, argv + argc);
+            break;
+        } else if (current.size() > 1 && current[0] == '-') {
+            std::cerr << "uzuki-validate: unknown option '" << current << "'" << std::endl;
+            usage(std::cerr);
+            return USAGE_ERROR;
+        } else {
+            args.push_back(current);
+        }
+    }
+
+    if (args.empty()) {
+        usage(std::cerr);
+        return USAGE_ERROR;
+    }
+
+    // Arguments that don't match any files (e.g., empty directories or globs) are reported as unreadable.
+    std::vector<std::string> paths;
+    std::vector<unsigned char> unmatched;
+    for (const auto& a : args) {
+        size_t before = paths.size();
+        collect_paths(a, paths);
+        unmatched.resize(paths.size(), false);
+        if (paths.size() == before) {
+            paths.push_back(a);
+            unmatched.push_back(true);
+        }
+    }
+
+    // Validating files in parallel, where each thread reuses its own Parser.
+    std::vector<Outcome> outcomes(paths.size());
+    std::atomic<size_t> next(0);
+    auto start = std::chrono::steady_clock::now();
+
+    auto worker = [&]() -> void {
+        uzuki::Parser<> parser;
+        while (true) {
+            size_t i = next.fetch_add(1);
+            if (i >= paths.size()) {
+                break;
+            }
+            if (unmatched[i]) {
+                auto& current = outcomes[i];
+                current.path = paths[i];
+                current.readable = false;
+                current.message = "no matching files";
+            } else {
+                outcomes[i] = validate_file(paths[i], parser, check_externals, num_external);
+            }
+        }
+    };
+
+    nthreads = std::min(nthreads, std::max<size_t>(1, paths.size()));
+    std::vector<std::thread> threads;
+    threads.reserve(nthreads - 1);
+    for (size_t t = 1; t < nthreads; ++t) {
+        threads.emplace_back(worker);
+    }
+    worker();
+    for (auto& t : threads) {
+        t.join();
+    }
+
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    // Reporting the results in the input order.
+    size_t nvalid = 0, ninvalid = 0, nunreadable = 0, total_bytes = 0, total_nodes = 0;
+    std::ostream& log = (report == "-" ? std::cerr : std::cout);
+    for (const auto& x : outcomes) {
+        total_bytes += x.bytes;
+        total_nodes += x.nodes;
+        if (!x.readable) {
+            ++nunreadable;
+            log << "ERROR " << x.path << ": " << x.message << "\n";
+        } else if (!x.valid) {
+            ++ninvalid;
+            log << "FAIL  " << x.path << ": " << x.message;
+            if (x.code != uzuki::ErrorCode::UNKNOWN) {
+                log << " [" << uzuki::error_name(x.code) << " at \"" << x.error_path << "\"]";
+            }
+            log << "\n";
+        } else {
+            ++nvalid;
+            if (!quiet) {
+                log << "PASS  " << x.path << " (" << x.bytes << " bytes, " << x.nodes << " nodes, " << x.seconds * 1000 << " ms)\n";
+            }
+        }
+    }
+
+    double mbps = (elapsed > 0 ? total_bytes / 1e6 / elapsed : 0);
+    double nps = (elapsed > 0 ? total_nodes / elapsed : 0);
+    log << paths.size() << " files: " << nvalid << " valid, " << ninvalid << " invalid, " << nunreadable << " unreadable; "
+        << elapsed << " s on " << nthreads << " thread(s), " << mbps << " MB/s, " << nps << " nodes/s" << std::endl;
+
+    if (!report.empty()) {
+        nlohmann::json files = nlohmann::json::array();
+        for (const auto& x : outcomes) {
+            files.push_back(to_json(x));
+        }
+        nlohmann::json summary = {
+            { "files", paths.size() },
+            { "valid", nvalid },
+            { "invalid", ninvalid },
+            { "unreadable", nunreadable },
+            { "bytes", total_bytes },
+            { "nodes", total_nodes },
+            { "seconds", elapsed },
+            { "threads", nthreads },
+            { "mb_per_second", mbps },
+            { "nodes_per_second", nps }
+        };
+        nlohmann::json doc = { { "summary", std::move(summary) }, { "files", std::move(files) } };
+
+        if (report == "-") {
+            std::cout << doc.dump(2) << std::endl;
+        } else {
+            std::ofstream out(report);
+            out << doc.dump(2) << std::endl;
+            if (!out) {
+                std::cerr << "uzuki-validate: failed to write report to '" << report << "'" << std::endl;
+                return IO_ERROR;
+            }
+        }
+    }
+
+    if (nunreadable) {
+        return IO_ERROR;
+    } else if (ninvalid) {
+        return SOME_INVALID;
+    }
+    return ALL_VALID;
+}
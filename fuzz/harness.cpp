@@ -0,0 +1,184 @@
+#include "uzuki/validate.hpp"
+#include "uzuki/parse.hpp"
+#include "nlohmann/json.hpp"
+
+#include "test_subclass.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <string>
+
+/**
+ * libFuzzer-compatible harness that checks the cost of validating and parsing
+ * each input, in addition to the usual crash detection. The time and the
+ * number/size of allocations are measured for each pass over the document
+ * and compared to a budget that is linear in the input size; inputs that
+ * exceed the budget are reported and cause an abort, so that the fuzzer
+ * saves them as reproducers.
+ *
+ * The budgets can be scaled by setting the UZUKI_FUZZ_BUDGET_SCALE
+ * environment variable, e.g., for slow sanitizer builds.
+ *
+ * When compiled with UZUKI_FUZZ_REPLAY (i.e., in the standalone replay
+ * driver for the test suite), only the allocation budgets are enforced.
+ * These are deterministic, while the time depends on the build type and
+ * the load on the machine and would cause spurious failures.
+ */
+
+/*
+ * Counting allocations by replacing the global operator new. Only the size
+ * of each allocation is recorded, so the delete operators don't need to
+ * do any bookkeeping.
+ */
+namespace {
+
+std::atomic<size_t> allocation_count(0);
+std::atomic<size_t> allocation_bytes(0);
+
+void* counted_allocate(size_t n) {
+    allocation_count.fetch_add(1, std::memory_order_relaxed);
+    allocation_bytes.fetch_add(n, std::memory_order_relaxed);
+    void* ptr = std::malloc(n ? n : 1);
+    if (!ptr) {
+        throw std::bad_alloc();
+    }
+    return ptr;
+}
+
+}
+
+void* operator new(size_t n) {
+    return counted_allocate(n);
+}
+
+void* operator new[](size_t n) {
+    return counted_allocate(n);
+}
+
+void operator delete(void* ptr) noexcept {
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr) noexcept {
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept {
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr, size_t) noexcept {
+    std::free(ptr);
+}
+
+namespace {
+
+/*
+ * Budgets are expressed as a fixed allowance plus a per-byte allowance.
+ * The per-byte allowances are generous for any linear algorithm (the
+ * most expensive inputs in the corpus use about half, mostly for the
+ * traversal stack of deeply nested lists), so exceeding them almost always
+ * indicates super-linear behavior. Time is the noisiest measure and gets
+ * the most headroom; it mostly serves as a backstop for CPU-bound loops
+ * that don't allocate.
+ */
+struct Budget {
+    size_t base_bytes = 1 << 20;
+    size_t bytes_per_byte = 512;
+    size_t base_count = 1024;
+    size_t count_per_byte = 8;
+    double base_seconds = 0.1;
+    double seconds_per_byte = 2e-6;
+#ifdef UZUKI_FUZZ_REPLAY
+    bool check_time = false;
+#else
+    bool check_time = true;
+#endif
+};
+
+double budget_scale() {
+    static double scale = []() -> double {
+        auto env = std::getenv("UZUKI_FUZZ_BUDGET_SCALE");
+        if (env) {
+            double val = std::atof(env);
+            if (val > 0) {
+                return val;
+            }
+        }
+        return 1;
+    }();
+    return scale;
+}
+
+template<class Function>
+void measure(const char* pass, size_t size, Function fun) {
+    Budget budget;
+    double scale = budget_scale();
+
+    size_t start_count = allocation_count.load(std::memory_order_relaxed);
+    size_t start_bytes = allocation_bytes.load(std::memory_order_relaxed);
+    auto start = std::chrono::steady_clock::now();
+    try {
+        fun();
+    } catch (std::exception&) {
+        // Errors are fine, as long as they are cheap.
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    size_t count = allocation_count.load(std::memory_order_relaxed) - start_count;
+    size_t bytes = allocation_bytes.load(std::memory_order_relaxed) - start_bytes;
+
+    double max_bytes = scale * (budget.base_bytes + static_cast<double>(budget.bytes_per_byte) * size);
+    double max_count = scale * (budget.base_count + static_cast<double>(budget.count_per_byte) * size);
+    double max_seconds = scale * (budget.base_seconds + budget.seconds_per_byte * size);
+
+    if (bytes > max_bytes || count > max_count || (budget.check_time && seconds > max_seconds)) {
+        std::fprintf(stderr,
+            "super-linear cost in '%s' for a %zu-byte input: %zu bytes in %zu allocations, %g s (budget: %.0f bytes, %.0f allocations, %g s)\n",
+            pass, size, bytes, count, seconds, max_bytes, max_count, max_seconds);
+        std::abort();
+    }
+}
+
+}
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
+    auto contents = nlohmann::json::parse(data, data + size, nullptr, /* allow_exceptions = */ false);
+    if (contents.is_discarded()) {
+        return 0;
+    }
+
+    // Limiting the decoded size of encoded vectors, which would otherwise
+    // allow tiny inputs to request arbitrarily large allocations.
+    uzuki::Options options;
+    options.limits.max_total_elements = 16 * size + 1024;
+
+    size_t num_external = 0;
+    bool valid = false;
+    measure("validate", size, [&]() -> void {
+        num_external = uzuki::validate(contents, options);
+        valid = true;
+    });
+    if (!valid) {
+        return 0;
+    }
+
+    // The test Provisioner's lists are destroyed recursively, so we limit
+    // the depth to avoid blowing the stack when the parsed tree is released.
+    // The validation above is still used to check deeply nested inputs.
+    options.limits.max_depth = 1000;
+
+    measure("parse", size, [&]() -> void {
+        uzuki::parse<DefaultProvisioner>(contents, DefaultExternals(num_external), options);
+    });
+
+    options.deduplicate = true;
+    measure("parse (deduplicated)", size, [&]() -> void {
+        uzuki::parse<DefaultProvisioner>(contents, DefaultExternals(num_external), options);
+    });
+
+    return 0;
+}
@@ -0,0 +1,55 @@
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+/**
+ * Standalone driver that runs the fuzzing harness over a corpus, for use
+ * without libFuzzer (e.g., in regression tests). Each argument may be a file
+ * or a directory, in which case all files inside it are used.
+ */
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size);
+
+int main(int argc, char** argv) {
+    namespace fs = std::filesystem;
+    std::vector<std::string> paths;
+    for (int a = 1; a < argc; ++a) {
+        std::error_code ec;
+        if (fs::is_directory(argv[a], ec)) {
+            std::vector<std::string> found;
+            for (const auto& entry : fs::recursive_directory_iterator(argv[a])) {
+                if (entry.is_regular_file()) {
+                    found.push_back(entry.path().string());
+                }
+            }
+            std::sort(found.begin(), found.end());
+            paths.insert(paths.end(), found.begin(), found.end());
+        } else {
+            paths.push_back(argv[a]);
+        }
+    }
+
+    if (paths.empty()) {
+        std::cerr << "Usage: " << argv[0] << " FILE|DIR..." << std::endl;
+        return 2;
+    }
+
+    for (const auto& p : paths) {
+        std::ifstream handle(p, std::ios::binary);
+        if (!handle) {
+            std::cerr << "failed to open '" << p << "'" << std::endl;
+            return 1;
+        }
+        std::string contents((std::istreambuf_iterator<char>(handle)), std::istreambuf_iterator<char>());
+        std::cout << p << " (" << contents.size() << " bytes)" << std::endl;
+        LLVMFuzzerTestOneInput(reinterpret_cast<const uint8_t*>(contents.data()), contents.size());
+    }
+
+    return 0;
+}
@@ -46,6 +46,7 @@ struct DummyFactor : public Factor {
 
     void is_ordered() {}
     void set_level(size_t, std::string) {}
+    bool share_levels(const std::shared_ptr<const std::vector<std::string> >&) { return true; }
 
     size_t length;
 };
@@ -86,6 +87,7 @@ struct DummyFactorArray : public FactorArray {
 
     void is_ordered() {}
     void set_level(size_t, std::string) {}
+    bool share_levels(const std::shared_ptr<const std::vector<std::string> >&) { return true; }
 
     std::vector<size_t> dimensions;
 };
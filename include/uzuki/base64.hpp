@@ -0,0 +1,214 @@
+#ifndef UZUKI_BASE64_HPP
+#define UZUKI_BASE64_HPP
+
+#include <string>
+#include <vector>
+#include <array>
+#include <utility>
+#include <cstdint>
+#include <cstring>
+
+/**
+ * @file base64.hpp
+ *
+ * @brief Encode and decode binary payloads for the `"base64"` encoding.
+ */
+
+namespace uzuki {
+
+/**
+ * @cond
+ */
+inline const std::array<unsigned char, 256>& base64_decoding_table() {
+    static const std::array<unsigned char, 256> table = []() -> std::array<unsigned char, 256> {
+        std::array<unsigned char, 256> output;
+        output.fill(255);
+        const char* alphabet = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+        for (unsigned char i = 0; i < 64; ++i) {
+            output[static_cast<unsigned char>(alphabet[i])] = i;
+        }
+        return output;
+    }();
+    return table;
+}
+
+inline bool is_little_endian() {
+    const uint16_t probe = 1;
+    unsigned char first;
+    std::memcpy(&first, &probe, 1);
+    return first == 1;
+}
+
+template<typename T>
+T read_little_endian(const unsigned char* ptr) {
+    T output;
+    if (is_little_endian()) {
+        std::memcpy(&output, ptr, sizeof(T));
+    } else {
+        unsigned char reversed[sizeof(T)];
+        for (size_t b = 0; b < sizeof(T); ++b) {
+            reversed[b] = ptr[sizeof(T) - b - 1];
+        }
+        std::memcpy(&output, reversed, sizeof(T));
+    }
+    return output;
+}
+
+template<typename T>
+void write_little_endian(T val, unsigned char* ptr) {
+    std::memcpy(ptr, &val, sizeof(T));
+    if (!is_little_endian()) {
+        for (size_t b = 0; b < sizeof(T) / 2; ++b) {
+            std::swap(ptr[b], ptr[sizeof(T) - b - 1]);
+        }
+    }
+}
+/**
+ * @endcond
+ */
+
+/**
+ * Decode a standard (RFC 4648) base64 string.
+ * The string should be padded to a multiple of 4 characters, and should not contain any whitespace.
+ *
+ * @param input The base64-encoded string.
+ * @param[out] output Vector in which to store the decoded bytes.
+ * This is resized to the number of decoded bytes.
+ *
+ * @return Whether the decoding was successful.
+ * If `false`, the contents of `output` are unspecified.
+ */
+inline bool base64_decode(const std::string& input, std::vector<unsigned char>& output) {
+    size_t n = input.size();
+    if (n % 4 != 0) {
+        return false;
+    }
+
+    size_t padding = 0;
+    if (n && input[n - 1] == '=') {
+        ++padding;
+        if (input[n - 2] == '=') {
+            ++padding;
+        }
+    }
+
+    output.resize(n / 4 * 3 - padding);
+    if (n == 0) {
+        return true;
+    }
+
+    // Decoding all full groups of 4 characters without any padding checks.
+    const auto& table = base64_decoding_table();
+    const unsigned char* src = reinterpret_cast<const unsigned char*>(input.data());
+    unsigned char* dest = output.data();
+    size_t full = (padding ? n - 4 : n);
+
+    for (size_t i = 0; i < full; i += 4, dest += 3) {
+        uint32_t a = table[src[i]], b = table[src[i + 1]], c = table[src[i + 2]], d = table[src[i + 3]];
+        if ((a | b | c | d) & 0x80) {
+            return false;
+        }
+        uint32_t combined = (a << 18) | (b << 12) | (c << 6) | d;
+        dest[0] = combined >> 16;
+        dest[1] = (combined >> 8) & 0xFF;
+        dest[2] = combined & 0xFF;
+    }
+
+    if (padding) {
+        const unsigned char* last = src + full;
+        uint32_t a = table[last[0]], b = table[last[1]];
+        uint32_t c = (padding == 2 ? 0 : table[last[2]]);
+        if ((a | b | c) & 0x80) {
+            return false;
+        }
+        uint32_t combined = (a << 18) | (b << 12) | (c << 6);
+        dest[0] = combined >> 16;
+        if (padding == 1) {
+            dest[1] = (combined >> 8) & 0xFF;
+        }
+    }
+
+    return true;
+}
+
+/**
+ * Encode bytes into a standard (RFC 4648) base64 string with padding.
+ *
+ * @param input Pointer to an array of bytes.
+ * @param n Number of bytes in `input`.
+ *
+ * @return The base64-encoded string.
+ */
+inline std::string base64_encode(const unsigned char* input, size_t n) {
+    const char* alphabet = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    std::string output;
+    output.reserve((n + 2) / 3 * 4);
+
+    size_t full = n / 3 * 3;
+    for (size_t i = 0; i < full; i += 3) {
+        uint32_t combined = (static_cast<uint32_t>(input[i]) << 16) | (static_cast<uint32_t>(input[i + 1]) << 8) | input[i + 2];
+        output += alphabet[combined >> 18];
+        output += alphabet[(combined >> 12) & 0x3F];
+        output += alphabet[(combined >> 6) & 0x3F];
+        output += alphabet[combined & 0x3F];
+    }
+
+    size_t leftover = n - full;
+    if (leftover) {
+        uint32_t combined = static_cast<uint32_t>(input[full]) << 16;
+        if (leftover == 2) {
+            combined |= static_cast<uint32_t>(input[full + 1]) << 8;
+        }
+        output += alphabet[combined >> 18];
+        output += alphabet[(combined >> 12) & 0x3F];
+        output += (leftover == 2 ? alphabet[(combined >> 6) & 0x3F] : '=');
+        output += '=';
+    }
+
+    return output;
+}
+
+/**
+ * Encode values into a base64 string for use in `values` with the `"base64"` encoding.
+ * Each value is stored in little-endian byte order, regardless of the endianness of the host.
+ *
+ * @tparam T Type of the values.
+ * This should be `double` for `"number"`, `int32_t` for `"integer"` and `unsigned char` for `"boolean"`.
+ *
+ * @param values Pointer to an array of values.
+ * For booleans, each value should be 0 or 1.
+ * @param n Number of values.
+ *
+ * @return The base64-encoded string.
+ */
+template<typename T>
+std::string base64_encode_values(const T* values, size_t n) {
+    std::vector<unsigned char> buffer(n * sizeof(T));
+    for (size_t i = 0; i < n; ++i) {
+        write_little_endian(values[i], buffer.data() + i * sizeof(T));
+    }
+    return base64_encode(buffer.data(), buffer.size());
+}
+
+/**
+ * Encode a validity bitmap into a base64 string for use in `validity` with the `"base64"` encoding.
+ * Element `i` is stored in bit `i % 8` (least significant first) of byte `i / 8`.
+ *
+ * @param present Pointer to an array of length `n`, indicating whether each element is present (non-zero) or missing (zero).
+ * @param n Number of elements.
+ *
+ * @return The base64-encoded string.
+ */
+inline std::string base64_encode_validity(const unsigned char* present, size_t n) {
+    std::vector<unsigned char> buffer((n + 7) / 8);
+    for (size_t i = 0; i < n; ++i) {
+        if (present[i]) {
+            buffer[i / 8] |= static_cast<unsigned char>(1u << (i % 8));
+        }
+    }
+    return base64_encode(buffer.data(), buffer.size());
+}
+
+}
+
+#endif
@@ -0,0 +1,186 @@
+#ifndef UZUKI_BINARY_HPP
+#define UZUKI_BINARY_HPP
+
+#include "parse.hpp"
+#include "validate.hpp"
+
+#include "nlohmann/json.hpp"
+
+#include <memory>
+
+/**
+ * @file binary.hpp
+ *
+ * @brief Parse and validate binary JSON representations (CBOR, MessagePack, BJData) using the **uzuki** spec.
+ *
+ * The binary input is decoded with the corresponding `nlohmann::json` reader and then processed with the usual **uzuki** rules,
+ * so the semantics are identical to those for text JSON. 
+ *
+ * For BJData, optimized N-dimensional typed containers are decoded into annotated objects containing the `_ArrayType_`, `_ArraySize_` and `_ArrayData_` fields.
+ * These are accepted as `values` for any vector or array, in which case `_ArrayData_` is used as the `values` array.
+ * For vectors, `_ArraySize_` should have length 1.
+ * For arrays, `_ArraySize_` should be equal to `dimensions` and `_ArrayData_` is interpreted in BJData's row-major order.
+ * The declared `_ArrayType_` is not trusted, so each element is checked in the same manner as a plain `values` array.
+ */
+
+namespace uzuki {
+
+/**
+ * Parse CBOR-encoded contents using the **uzuki** specification.
+ *
+ * @tparam Provisioner A class namespace defining static methods for creating new `Base` objects, see `parse()` for details.
+ * This should not declare `lazy_values`, as the decoded contents are discarded on return.
+ * @tparam Json A [`nlohmann::json`](https://github.com/nlohmann/json)-compatible representation of JSON data.
+ * @tparam Input Any input type accepted by `Json::from_cbor()`, e.g., a `std::vector<uint8_t>`.
+ * @tparam Externals Class describing how to resolve external references for type `OTHER`, see `parse()` for details.
+ *
+ * @param input CBOR-encoded contents.
+ * @param ext Instance of an external reference resolver class.
+ *
+ * @return Pointer to the root `Base` object.
+ */
+template<class Provisioner, class Json = nlohmann::json, class Input, class Externals>
+std::shared_ptr<Base> parse_cbor(Input&& input, Externals ext) {
+    static_assert(!lazy_values<Provisioner>::value, "lazy provisioners cannot be used as the decoded contents are not retained");
+    auto contents = Json::from_cbor(std::forward<Input>(input));
+    return parse<Provisioner>(contents, std::move(ext));
+}
+
+/**
+ * Parse MessagePack-encoded contents using the **uzuki** specification.
+ *
+ * @tparam Provisioner A class namespace defining static methods for creating new `Base` objects, see `parse()` for details.
+ * This should not declare `lazy_values`, as the decoded contents are discarded on return.
+ * @tparam Json A [`nlohmann::json`](https://github.com/nlohmann/json)-compatible representation of JSON data.
+ * @tparam Input Any input type accepted by `Json::from_msgpack()`, e.g., a `std::vector<uint8_t>`.
+ * @tparam Externals Class describing how to resolve external references for type `OTHER`, see `parse()` for details.
+ *
+ * @param input MessagePack-encoded contents.
+ * @param ext Instance of an external reference resolver class.
+ *
+ * @return Pointer to the root `Base` object.
+ */
+template<class Provisioner, class Json = nlohmann::json, class Input, class Externals>
+std::shared_ptr<Base> parse_msgpack(Input&& input, Externals ext) {
+    static_assert(!lazy_values<Provisioner>::value, "lazy provisioners cannot be used as the decoded contents are not retained");
+    auto contents = Json::from_msgpack(std::forward<Input>(input));
+    return parse<Provisioner>(contents, std::move(ext));
+}
+
+/**
+ * Parse BJData-encoded contents using the **uzuki** specification.
+ *
+ * @tparam Provisioner A class namespace defining static methods for creating new `Base` objects, see `parse()` for details.
+ * This should not declare `lazy_values`, as the decoded contents are discarded on return.
+ * @tparam Json A [`nlohmann::json`](https://github.com/nlohmann/json)-compatible representation of JSON data.
+ * @tparam Input Any input type accepted by `Json::from_bjdata()`, e.g., a `std::vector<uint8_t>`.
+ * @tparam Externals Class describing how to resolve external references for type `OTHER`, see `parse()` for details.
+ *
+ * @param input BJData-encoded contents.
+ * @param ext Instance of an external reference resolver class.
+ *
+ * @return Pointer to the root `Base` object.
+ */
+template<class Provisioner, class Json = nlohmann::json, class Input, class Externals>
+std::shared_ptr<Base> parse_bjdata(Input&& input, Externals ext) {
+    static_assert(!lazy_values<Provisioner>::value, "lazy provisioners cannot be used as the decoded contents are not retained");
+    auto contents = Json::from_bjdata(std::forward<Input>(input));
+    return parse<Provisioner>(contents, std::move(ext));
+}
+
+/**
+ * Validate CBOR-encoded contents against the **uzuki** specification.
+ * Any invalid representations will cause an error to be thrown.
+ *
+ * @tparam Json A [`nlohmann::json`](https://github.com/nlohmann/json)-compatible representation of JSON data.
+ * @tparam Input Any input type accepted by `Json::from_cbor()`.
+ *
+ * @param input CBOR-encoded contents.
+ * @param num_external Expected number of external references to "other" objects.
+ */
+template<class Json = nlohmann::json, class Input>
+void validate_cbor(Input&& input, size_t num_external) {
+    validate(Json::from_cbor(std::forward<Input>(input)), num_external);
+}
+
+/**
+ * Validate CBOR-encoded contents against the **uzuki** specification with an unknown number of external references.
+ * Any invalid representations will cause an error to be thrown.
+ *
+ * @tparam Json A [`nlohmann::json`](https://github.com/nlohmann/json)-compatible representation of JSON data.
+ * @tparam Input Any input type accepted by `Json::from_cbor()`.
+ *
+ * @param input CBOR-encoded contents.
+ *
+ * @return Number of external references.
+ */
+template<class Json = nlohmann::json, class Input>
+size_t validate_cbor(Input&& input) {
+    return validate(Json::from_cbor(std::forward<Input>(input)));
+}
+
+/**
+ * Validate MessagePack-encoded contents against the **uzuki** specification.
+ * Any invalid representations will cause an error to be thrown.
+ *
+ * @tparam Json A [`nlohmann::json`](https://github.com/nlohmann/json)-compatible representation of JSON data.
+ * @tparam Input Any input type accepted by `Json::from_msgpack()`.
+ *
+ * @param input MessagePack-encoded contents.
+ * @param num_external Expected number of external references to "other" objects.
+ */
+template<class Json = nlohmann::json, class Input>
+void validate_msgpack(Input&& input, size_t num_external) {
+    validate(Json::from_msgpack(std::forward<Input>(input)), num_external);
+}
+
+/**
+ * Validate MessagePack-encoded contents against the **uzuki** specification with an unknown number of external references.
+ * Any invalid representations will cause an error to be thrown.
+ *
+ * @tparam Json A [`nlohmann::json`](https://github.com/nlohmann/json)-compatible representation of JSON data.
+ * @tparam Input Any input type accepted by `Json::from_msgpack()`.
+ *
+ * @param input MessagePack-encoded contents.
+ *
+ * @return Number of external references.
+ */
+template<class Json = nlohmann::json, class Input>
+size_t validate_msgpack(Input&& input) {
+    return validate(Json::from_msgpack(std::forward<Input>(input)));
+}
+
+/**
+ * Validate BJData-encoded contents against the **uzuki** specification.
+ * Any invalid representations will cause an error to be thrown.
+ *
+ * @tparam Json A [`nlohmann::json`](https://github.com/nlohmann/json)-compatible representation of JSON data.
+ * @tparam Input Any input type accepted by `Json::from_bjdata()`.
+ *
+ * @param input BJData-encoded contents.
+ * @param num_external Expected number of external references to "other" objects.
+ */
+template<class Json = nlohmann::json, class Input>
+void validate_bjdata(Input&& input, size_t num_external) {
+    validate(Json::from_bjdata(std::forward<Input>(input)), num_external);
+}
+
+/**
+ * Validate BJData-encoded contents against the **uzuki** specification with an unknown number of external references.
+ * Any invalid representations will cause an error to be thrown.
+ *
+ * @tparam Json A [`nlohmann::json`](https://github.com/nlohmann/json)-compatible representation of JSON data.
+ * @tparam Input Any input type accepted by `Json::from_bjdata()`.
+ *
+ * @param input BJData-encoded contents.
+ *
+ * @return Number of external references.
+ */
+template<class Json = nlohmann::json, class Input>
+size_t validate_bjdata(Input&& input) {
+    return validate(Json::from_bjdata(std::forward<Input>(input)));
+}
+
+}
+
+#endif
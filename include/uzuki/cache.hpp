@@ -0,0 +1,326 @@
+#ifndef UZUKI_CACHE_HPP
+#define UZUKI_CACHE_HPP
+
+#include "validate.hpp"
+#include "error.hpp"
+#include "hash.hpp"
+
+#include "nlohmann/json.hpp"
+
+#include <string>
+#include <list>
+#include <unordered_map>
+#include <mutex>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <cstdio>
+#include <cstdint>
+#include <random>
+
+/**
+ * @file cache.hpp
+ *
+ * @brief Content-addressed cache of validation results.
+ */
+
+namespace uzuki {
+
+/**
+ * @cond
+ */
+namespace caching {
+
+// Bump this whenever the validation rules or the format of the cache files change, so that stale results on disk are ignored.
+constexpr uint32_t version = 3;
+
+// Results depend on the limits, so these are included in the name of each file on disk.
+inline uint64_t limits_tag(const Limits& limits) {
+    std::string serialized;
+    for (auto x : { limits.max_depth, limits.max_total_elements, limits.max_string_bytes, limits.max_node_elements, limits.max_factor_levels }) {
+        serialized += std::to_string(x);
+        serialized += ' ';
+    }
+    return hash_bytes(serialized);
+}
+
+}
+/**
+ * @endcond
+ */
+
+/**
+ * @brief Content-addressed cache of validation results.
+ *
+ * Each document is identified by the XXH64 hash of its raw bytes (see `hash_bytes()`) and its length.
+ * On a cache hit, the stored outcome is returned without parsing the document,
+ * which is useful when the same immutable files are repeatedly validated.
+ *
+ * The outcome is stored for the unknown-count variant of `validate()`, i.e., we cache whether the document is valid and the number of external references.
+ * This is sufficient to answer requests with any expected number of external references.
+ * Failures are also cached, in which case a hit will throw an `Error` with the original `ErrorCode`, path, index and message.
+ * Files that are not valid JSON are reported with `ErrorCode::UNKNOWN`.
+ *
+ * Results are cached for entire documents, so appending to a document will cause it to be validated again in full.
+ * Caching at the granularity of subtrees (e.g., by their `Fingerprints`) is not supported,
+ * as the validity of a subtree depends on its position in the document via the resource limits and the indices of "other" objects.
+ *
+ * Results are held in an in-memory cache with a least-recently-used eviction policy.
+ * Optionally, results can also be stored in a directory on disk so that they persist across processes.
+ * Files on disk are also keyed by the version of the cache and by the `Limits` used for validation,
+ * so results from older versions of this library or with different limits are ignored.
+ * All methods are thread-safe.
+ *
+ * @tparam Json A [`nlohmann::json`](https://github.com/nlohmann/json)-compatible representation of JSON data.
+ */
+template<class Json = nlohmann::json>
+class ValidationCache {
+public:
+    /**
+     * @param capacity Maximum number of results to hold in memory.
+     * @param directory Path to a directory in which to store results on disk.
+     * This should already exist.
+     * If empty, results are only stored in memory.
+     * @param options Further options for validation.
+     * Only `Options::limits` is used, as the other options do not affect the validity of a document.
+     */
+    ValidationCache(size_t capacity = 1000, std::string directory = "", const Options& options = Options()) :
+        max_size(capacity), dir(std::move(directory)), tag(caching::limits_tag(options.limits))
+    {
+        opts.limits = options.limits;
+    }
+
+public:
+    /**
+     * Validate a JSON document against the **uzuki** specification with an unknown number of external references.
+     * Any invalid representations will cause an error to be thrown.
+     *
+     * @param bytes Contents of the JSON document.
+     *
+     * @return Number of external references.
+     */
+    size_t validate(const std::string& bytes) {
+        auto out = fetch(bytes);
+        if (!out.valid) {
+            throw Error(out.code, out.path, out.message, out.index);
+        }
+        return out.num_external;
+    }
+
+    /**
+     * Validate a JSON document against the **uzuki** specification.
+     * Any invalid representations will cause an error to be thrown.
+     *
+     * @param bytes Contents of the JSON document.
+     * @param num_external Expected number of external references to "other" objects.
+     */
+    void validate(const std::string& bytes, size_t num_external) {
+        auto out = fetch(bytes);
+        if (!out.valid) {
+            throw Error(out.code, out.path, out.message, out.index);
+        }
+        if (out.num_external != num_external) {
+            // Re-running the validation to get the exact error message.
+            uzuki::validate(Json::parse(bytes), num_external, opts);
+        }
+    }
+
+    /**
+     * @return Number of cache hits, in memory or on disk.
+     */
+    size_t hits() const {
+        std::lock_guard<std::mutex> lock(mut);
+        return num_hits;
+    }
+
+    /**
+     * @return Number of cache misses, i.e., documents that needed to be parsed.
+     */
+    size_t misses() const {
+        std::lock_guard<std::mutex> lock(mut);
+        return num_misses;
+    }
+
+    /**
+     * Remove all results from the in-memory cache.
+     * Results on disk are not affected.
+     */
+    void clear() {
+        std::lock_guard<std::mutex> lock(mut);
+        order.clear();
+        lookup.clear();
+    }
+
+private:
+    struct Outcome {
+        bool valid = false;
+        size_t num_external = 0;
+        ErrorCode code = ErrorCode::OK;
+        size_t index = Error::no_index;
+        std::string path;
+        std::string message;
+    };
+
+    struct Key {
+        uint64_t hash;
+        size_t length;
+        bool operator==(const Key& other) const {
+            return hash == other.hash && length == other.length;
+        }
+    };
+
+    struct KeyHasher {
+        size_t operator()(const Key& k) const {
+            return k.hash ^ (k.length * xxh64::prime1);
+        }
+    };
+
+    size_t max_size;
+    std::string dir;
+    Options opts;
+    uint64_t tag;
+
+    mutable std::mutex mut;
+    std::list<std::pair<Key, Outcome> > order;
+    std::unordered_map<Key, typename std::list<std::pair<Key, Outcome> >::iterator, KeyHasher> lookup;
+    size_t num_hits = 0, num_misses = 0;
+
+private:
+    Outcome fetch(const std::string& bytes) {
+        Key key { hash_bytes(bytes), bytes.size() };
+
+        {
+            std::lock_guard<std::mutex> lock(mut);
+            auto it = lookup.find(key);
+            if (it != lookup.end()) {
+                order.splice(order.begin(), order, it->second);
+                ++num_hits;
+                return it->second->second;
+            }
+        }
+
+        Outcome out;
+        if (!read_disk(key, out)) {
+            Json contents;
+            try {
+                contents = Json::parse(bytes);
+            } catch (std::exception& e) {
+                out.code = ErrorCode::UNKNOWN;
+                out.message = e.what();
+            }
+            if (out.code == ErrorCode::OK) {
+                auto res = validate_nothrow(contents, opts, out.num_external);
+                out.valid = res.ok();
+                if (!out.valid) {
+                    out.code = res.code;
+                    out.index = res.index;
+                    out.path = res.path;
+                    out.message = res.message();
+                }
+            }
+            write_disk(key, out);
+            std::lock_guard<std::mutex> lock(mut);
+            ++num_misses;
+        } else {
+            std::lock_guard<std::mutex> lock(mut);
+            ++num_hits;
+        }
+
+        store(key, out);
+        return out;
+    }
+
+    void store(const Key& key, const Outcome& out) {
+        std::lock_guard<std::mutex> lock(mut);
+        if (max_size == 0 || lookup.find(key) != lookup.end()) {
+            return;
+        }
+        order.emplace_front(key, out);
+        lookup[key] = order.begin();
+        if (order.size() > max_size) {
+            lookup.erase(order.back().first);
+            order.pop_back();
+        }
+    }
+
+    std::string disk_path(const Key& key) const {
+        char buffer[96];
+        std::snprintf(
+            buffer,
+            sizeof(buffer),
+            "%016llx-%llu-%016llx-v%u.uzuki",
+            static_cast<unsigned long long>(key.hash),
+            static_cast<unsigned long long>(key.length),
+            static_cast<unsigned long long>(tag),
+            static_cast<unsigned>(caching::version)
+        );
+        return dir + "/" + buffer;
+    }
+
+    bool read_disk(const Key& key, Outcome& output) const {
+        if (dir.empty()) {
+            return false;
+        }
+
+        std::ifstream handle(disk_path(key));
+        if (!handle) {
+            return false;
+        }
+
+        // Format is '<valid> <num_external> <code> <index> <path length>\n<path><message>'.
+        // We only fill 'output' once everything is read, so that a corrupted file has no effect.
+        Outcome out;
+        int valid, code;
+        size_t path_length;
+        if (!(handle >> valid >> out.num_external >> code >> out.index >> path_length)) {
+            return false;
+        }
+        if (code < 0 || code > static_cast<int>(ErrorCode::UNKNOWN)) {
+            return false;
+        }
+        out.valid = valid;
+        out.code = static_cast<ErrorCode>(code);
+        handle.get();
+
+        // Checking the path length against the rest of the file, in case the latter is corrupted.
+        auto current = handle.tellg();
+        if (current < 0 || !handle.seekg(0, std::ios::end)) {
+            return false;
+        }
+        auto remaining = handle.tellg() - current;
+        if (remaining < 0 || path_length > static_cast<unsigned long long>(remaining) || !handle.seekg(current)) {
+            return false;
+        }
+        out.path.resize(path_length);
+        if (path_length && !handle.read(&(out.path[0]), path_length)) {
+            return false;
+        }
+        std::stringstream rest;
+        rest << handle.rdbuf();
+        out.message = rest.str();
+        output = std::move(out);
+        return true;
+    }
+
+    void write_disk(const Key& key, const Outcome& out) const {
+        if (dir.empty()) {
+            return;
+        }
+
+        // Writing to a temporary file first so that concurrent readers never see a partial result.
+        auto path = disk_path(key);
+        auto tmp = path + ".tmp" + std::to_string(std::random_device()());
+        {
+            std::ofstream handle(tmp);
+            if (!handle) {
+                return;
+            }
+            handle << out.valid << " " << out.num_external << " " << static_cast<int>(out.code) << " " << out.index << " " << out.path.size() << "\n" << out.path << out.message;
+        }
+        std::rename(tmp.c_str(), path.c_str());
+    }
+};
+
+}
+
+#endif
@@ -0,0 +1,506 @@
+#ifndef UZUKI_COMPACT_HPP
+#define UZUKI_COMPACT_HPP
+
+#include "interfaces.hpp"
+
+#include <vector>
+#include <string>
+#include <memory>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+
+/**
+ * @file compact.hpp
+ *
+ * @brief Memory-efficient storage for factors and booleans.
+ */
+
+namespace uzuki {
+
+/**
+ * @brief Bit-packed vector of flags.
+ *
+ * The `i`-th flag is stored in bit `i % 8` (least significant first) of byte `i / 8`,
+ * consistent with the validity bitmaps used elsewhere in **uzuki**.
+ */
+class PackedBits {
+public:
+    /**
+     * @param n Number of flags, all initially false.
+     */
+    PackedBits(size_t n = 0) : length(n), bytes((n + 7) / 8) {}
+
+    /**
+     * @return Number of flags.
+     */
+    size_t size() const {
+        return length;
+    }
+
+    /**
+     * @param i Index of the flag.
+     * @return Value of the flag.
+     */
+    bool get(size_t i) const {
+        return (bytes[i / 8] >> (i % 8)) & 1u;
+    }
+
+    /**
+     * @param i Index of the flag.
+     * @param v Value of the flag.
+     */
+    void set(size_t i, bool v) {
+        auto mask = static_cast<unsigned char>(1u << (i % 8));
+        if (v) {
+            bytes[i / 8] |= mask;
+        } else {
+            bytes[i / 8] &= static_cast<unsigned char>(~mask);
+        }
+    }
+
+    /**
+     * @return Pointer to the packed bytes, of length equal to `ceil(size() / 8)`.
+     */
+    const unsigned char* data() const {
+        return bytes.data();
+    }
+
+private:
+    size_t length;
+    std::vector<unsigned char> bytes;
+};
+
+/**
+ * @brief Factor codes stored with the narrowest unsigned integer type that fits the number of levels.
+ *
+ * Codes are stored in 1, 2 or 4 bytes (or 8 bytes for more than 2^32 levels),
+ * with missingness recorded in a separate bit-packed validity vector.
+ */
+class PackedCodes {
+public:
+    /**
+     * @param n Number of codes.
+     * @param nlevels Number of levels.
+     */
+    PackedCodes(size_t n = 0, size_t nlevels = 0) : length(n), bytes_per_code(choose_width(nlevels)), bytes(n * bytes_per_code), present(n) {}
+
+    /**
+     * @return Number of codes.
+     */
+    size_t size() const {
+        return length;
+    }
+
+    /**
+     * @return Number of bytes used to store each code.
+     */
+    size_t width() const {
+        return bytes_per_code;
+    }
+
+    /**
+     * @param i Index of the code.
+     * @return The code, i.e., an index into the levels.
+     * This is zero for missing values.
+     */
+    size_t get(size_t i) const {
+        const unsigned char* src = bytes.data() + i * bytes_per_code;
+        switch (bytes_per_code) {
+            case 1:
+                return *src;
+            case 2:
+                return load<uint16_t>(src);
+            case 4:
+                return load<uint32_t>(src);
+        }
+        return load<uint64_t>(src);
+    }
+
+    /**
+     * @param i Index of the code.
+     * @return Whether the code is missing.
+     */
+    bool is_missing(size_t i) const {
+        return !present.get(i);
+    }
+
+    /**
+     * @param i Index of the code.
+     * @param v The code, which should be less than the number of levels.
+     */
+    void set(size_t i, size_t v) {
+        unsigned char* dest = bytes.data() + i * bytes_per_code;
+        switch (bytes_per_code) {
+            case 1:
+                *dest = static_cast<unsigned char>(v);
+                break;
+            case 2:
+                store<uint16_t>(dest, v);
+                break;
+            case 4:
+                store<uint32_t>(dest, v);
+                break;
+            default:
+                store<uint64_t>(dest, v);
+        }
+        present.set(i, true);
+    }
+
+    /**
+     * @param i Index of the code.
+     */
+    void set_missing(size_t i) {
+        present.set(i, false);
+    }
+
+    /**
+     * @return Validity of each code, where a set bit indicates that the code is present.
+     */
+    const PackedBits& validity() const {
+        return present;
+    }
+
+private:
+    static size_t choose_width(size_t nlevels) {
+        // Codes are always less than the number of levels.
+        if (nlevels <= static_cast<size_t>(std::numeric_limits<uint8_t>::max()) + 1) {
+            return 1;
+        } else if (nlevels <= static_cast<size_t>(std::numeric_limits<uint16_t>::max()) + 1) {
+            return 2;
+        } else if (nlevels - 1 <= static_cast<size_t>(std::numeric_limits<uint32_t>::max())) {
+            return 4;
+        }
+        return 8;
+    }
+
+    template<typename T>
+    static size_t load(const unsigned char* src) {
+        T out;
+        std::memcpy(&out, src, sizeof(T));
+        return out;
+    }
+
+    template<typename T>
+    static void store(unsigned char* dest, size_t v) {
+        T val = static_cast<T>(v);
+        std::memcpy(dest, &val, sizeof(T));
+    }
+
+    size_t length;
+    size_t bytes_per_code;
+    std::vector<unsigned char> bytes;
+    PackedBits present;
+};
+
+/**
+ * @brief Bit-packed booleans with a separate validity vector.
+ */
+class PackedBooleans {
+public:
+    /**
+     * @param n Number of booleans.
+     */
+    PackedBooleans(size_t n = 0) : values(n), present(n) {}
+
+    /**
+     * @return Number of booleans.
+     */
+    size_t size() const {
+        return values.size();
+    }
+
+    /**
+     * @param i Index of the boolean.
+     * @return Value of the boolean.
+     * This is false for missing values.
+     */
+    bool get(size_t i) const {
+        return values.get(i);
+    }
+
+    /**
+     * @param i Index of the boolean.
+     * @return Whether the boolean is missing.
+     */
+    bool is_missing(size_t i) const {
+        return !present.get(i);
+    }
+
+    /**
+     * @param i Index of the boolean.
+     * @param v Value of the boolean.
+     */
+    void set(size_t i, bool v) {
+        values.set(i, v);
+        present.set(i, true);
+    }
+
+    /**
+     * @param i Index of the boolean.
+     */
+    void set_missing(size_t i) {
+        values.set(i, false);
+        present.set(i, false);
+    }
+
+    /**
+     * @return Validity of each boolean, where a set bit indicates that the boolean is present.
+     */
+    const PackedBits& validity() const {
+        return present;
+    }
+
+private:
+    PackedBits values, present;
+};
+
+/**
+ * @cond
+ */
+namespace compact {
+
+inline size_t product(const std::vector<size_t>& d) {
+    size_t prod = 1;
+    for (auto x : d) {
+        prod *= x;
+    }
+    return prod;
+}
+
+}
+/**
+ * @endcond
+ */
+
+/**
+ * @brief Factor that stores its codes in the narrowest suitable width.
+ *
+ * This can be returned by `Provisioner::new_Factor()` using the number of levels supplied by the parser.
+ */
+struct CompactFactor : public Factor {
+    /**
+     * @param l Length of the factor.
+     * @param ll Number of levels.
+     */
+    CompactFactor(size_t l, size_t ll) : codes(l, ll), owned(std::make_shared<std::vector<std::string> >(ll)), levels(owned) {}
+
+    /**
+     * @cond
+     */
+    size_t size() const { return codes.size(); }
+
+    void set(size_t i, size_t v) { codes.set(i, v); }
+
+    void set_missing(size_t i) { codes.set_missing(i); }
+
+    void set_level(size_t il, std::string vl) { (*owned)[il] = std::move(vl); }
+
+    bool share_levels(const std::shared_ptr<const std::vector<std::string> >& l) {
+        owned.reset();
+        levels = l;
+        return true;
+    }
+
+    void is_ordered() { ordered = true; }
+
+    void use_names() {
+        has_names = true;
+        names.resize(codes.size());
+    }
+
+    void set_name(size_t i, std::string n) { names[i] = std::move(n); }
+    /**
+     * @endcond
+     */
+
+    /**
+     * Codes of the factor elements.
+     */
+    PackedCodes codes;
+
+private:
+    std::shared_ptr<std::vector<std::string> > owned;
+
+public:
+    /**
+     * Levels of the factor.
+     * This may be shared with other factors that have the same levels, see `Options::deduplicate`.
+     */
+    std::shared_ptr<const std::vector<std::string> > levels;
+
+    /**
+     * Whether the levels are ordered.
+     */
+    bool ordered = false;
+
+    /**
+     * Whether the factor is named.
+     */
+    bool has_names = false;
+
+    /**
+     * Names of the factor elements, if `has_names = true`.
+     */
+    std::vector<std::string> names;
+};
+
+/**
+ * @brief Factor array that stores its codes in the narrowest suitable width.
+ *
+ * This can be returned by `Provisioner::new_Factor()` using the number of levels supplied by the parser.
+ */
+struct CompactFactorArray : public FactorArray {
+    /**
+     * @param d Dimensions of the array.
+     * @param ll Number of levels.
+     */
+    CompactFactorArray(std::vector<size_t> d, size_t ll) : dimensions(std::move(d)), codes(compact::product(dimensions), ll), owned(std::make_shared<std::vector<std::string> >(ll)), levels(owned), names(dimensions.size()) {}
+
+    /**
+     * @cond
+     */
+    size_t first_dim() const { return dimensions.front(); }
+
+    void set(size_t i, size_t v) { codes.set(i, v); }
+
+    void set_missing(size_t i) { codes.set_missing(i); }
+
+    void set_level(size_t il, std::string vl) { (*owned)[il] = std::move(vl); }
+
+    bool share_levels(const std::shared_ptr<const std::vector<std::string> >& l) {
+        owned.reset();
+        levels = l;
+        return true;
+    }
+
+    void is_ordered() { ordered = true; }
+
+    void use_names(size_t d) { names[d].resize(dimensions[d]); }
+
+    void set_name(size_t d, size_t i, std::string n) { names[d][i] = std::move(n); }
+    /**
+     * @endcond
+     */
+
+    /**
+     * Dimensions of the array.
+     */
+    std::vector<size_t> dimensions;
+
+    /**
+     * Codes of the array elements, in column-major order.
+     */
+    PackedCodes codes;
+
+private:
+    std::shared_ptr<std::vector<std::string> > owned;
+
+public:
+    /**
+     * Levels of the factor.
+     * This may be shared with other factors that have the same levels, see `Options::deduplicate`.
+     */
+    std::shared_ptr<const std::vector<std::string> > levels;
+
+    /**
+     * Whether the levels are ordered.
+     */
+    bool ordered = false;
+
+    /**
+     * Names for each dimension.
+     * Each entry is empty if the corresponding dimension is unnamed.
+     */
+    std::vector<std::vector<std::string> > names;
+};
+
+/**
+ * @brief Boolean vector that stores one bit per element.
+ */
+struct CompactBooleanVector : public BooleanVector {
+    /**
+     * @param l Length of the vector.
+     */
+    CompactBooleanVector(size_t l) : values(l) {}
+
+    /**
+     * @cond
+     */
+    size_t size() const { return values.size(); }
+
+    void set(size_t i, unsigned char v) { values.set(i, v); }
+
+    void set_missing(size_t i) { values.set_missing(i); }
+
+    void use_names() {
+        has_names = true;
+        names.resize(values.size());
+    }
+
+    void set_name(size_t i, std::string n) { names[i] = std::move(n); }
+    /**
+     * @endcond
+     */
+
+    /**
+     * Values of the vector.
+     */
+    PackedBooleans values;
+
+    /**
+     * Whether the vector is named.
+     */
+    bool has_names = false;
+
+    /**
+     * Names of the vector elements, if `has_names = true`.
+     */
+    std::vector<std::string> names;
+};
+
+/**
+ * @brief Boolean array that stores one bit per element.
+ */
+struct CompactBooleanArray : public BooleanArray {
+    /**
+     * @param d Dimensions of the array.
+     */
+    CompactBooleanArray(std::vector<size_t> d) : dimensions(std::move(d)), values(compact::product(dimensions)), names(dimensions.size()) {}
+
+    /**
+     * @cond
+     */
+    size_t first_dim() const { return dimensions.front(); }
+
+    void set(size_t i, unsigned char v) { values.set(i, v); }
+
+    void set_missing(size_t i) { values.set_missing(i); }
+
+    void use_names(size_t d) { names[d].resize(dimensions[d]); }
+
+    void set_name(size_t d, size_t i, std::string n) { names[d][i] = std::move(n); }
+    /**
+     * @endcond
+     */
+
+    /**
+     * Dimensions of the array.
+     */
+    std::vector<size_t> dimensions;
+
+    /**
+     * Values of the array, in column-major order.
+     */
+    PackedBooleans values;
+
+    /**
+     * Names for each dimension.
+     * Each entry is empty if the corresponding dimension is unnamed.
+     */
+    std::vector<std::vector<std::string> > names;
+};
+
+}
+
+#endif
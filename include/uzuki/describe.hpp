@@ -0,0 +1,327 @@
+#ifndef UZUKI_DESCRIBE_HPP
+#define UZUKI_DESCRIBE_HPP
+
+#include "interfaces.hpp"
+#include "unpack.hpp"
+#include "parse.hpp"
+
+#include <vector>
+#include <string>
+#include <memory>
+#include <cstdint>
+
+/**
+ * @file describe.hpp
+ *
+ * @brief Summarize the structure of a document without materializing its values.
+ */
+
+namespace uzuki {
+
+/**
+ * @brief Summary of the shape of an R object.
+ *
+ * This describes the type, length, dimensions and missingness of each object, along with the names and summaries of the children of each list or data frame.
+ */
+struct Description {
+    /**
+     * Type of the object.
+     */
+    Type type = NOTHING;
+
+    /**
+     * Length of a vector, number of elements in an array (i.e., the product of `dimensions`), number of elements in a list or number of rows in a data frame.
+     * This is zero for `NOTHING` and `OTHER`.
+     */
+    size_t length = 0;
+
+    /**
+     * Dimensions of an array.
+     * This is empty for all other types.
+     */
+    std::vector<size_t> dimensions;
+
+    /**
+     * Number of levels for a factor or factor array.
+     */
+    size_t levels = 0;
+
+    /**
+     * Whether a factor or factor array is ordered.
+     */
+    bool ordered = false;
+
+    /**
+     * Number of missing values in a vector or array.
+     */
+    size_t missing = 0;
+
+    /**
+     * Index of the external reference for `OTHER`.
+     */
+    size_t index = 0;
+
+    /**
+     * Whether names are present.
+     * For vectors and lists, this refers to the names of the elements;
+     * for arrays, this is true if any dimension has names;
+     * and for data frames, this refers to the row names.
+     */
+    bool has_names = false;
+
+    /**
+     * Names of the elements of a named list, or the column names of a data frame.
+     * This is empty for all other types.
+     */
+    std::vector<std::string> names;
+
+    /**
+     * Descriptions of the elements of a list, or of the columns of a data frame.
+     * This is empty for all other types.
+     * Elements that were not selected by `Options::projection` have type `NOTHING`.
+     */
+    std::vector<Description> children;
+};
+
+/**
+ * @cond
+ */
+namespace description {
+
+struct Described {
+    Description info;
+};
+
+// Deduplicated children may be shared with other parents, in which case we must copy.
+inline void absorb(Description& target, const std::shared_ptr<Base>& child) {
+    auto& info = dynamic_cast<Described*>(child.get())->info;
+    if (child.use_count() > 1) {
+        target = info;
+    } else {
+        target = std::move(info);
+    }
+}
+
+template<typename T, Type tt>
+struct DescribedVector : public TypedVector<T, tt>, public Described {
+    DescribedVector(size_t l) {
+        info.type = tt;
+        info.length = l;
+    }
+
+    size_t size() const { return info.length; }
+
+    void set(size_t, T) {}
+    void set_missing(size_t) { ++info.missing; }
+
+    void use_names() { info.has_names = true; }
+    void set_name(size_t, std::string) {}
+};
+
+struct DescribedFactor : public Factor, public Described {
+    DescribedFactor(size_t l, size_t ll) {
+        info.type = FACTOR;
+        info.length = l;
+        info.levels = ll;
+    }
+
+    size_t size() const { return info.length; }
+
+    void set(size_t, size_t) {}
+    void set_missing(size_t) { ++info.missing; }
+
+    void use_names() { info.has_names = true; }
+    void set_name(size_t, std::string) {}
+
+    void is_ordered() { info.ordered = true; }
+    void set_level(size_t, std::string) {}
+};
+
+inline void set_dimensions(Description& info, std::vector<size_t> d) {
+    info.length = 1;
+    for (auto x : d) {
+        info.length *= x;
+    }
+    info.dimensions = std::move(d);
+}
+
+template<typename T, Type tt>
+struct DescribedArray : public TypedArray<T, tt>, public Described {
+    DescribedArray(std::vector<size_t> d) {
+        info.type = tt;
+        set_dimensions(info, std::move(d));
+    }
+
+    size_t first_dim() const { return info.dimensions[0]; }
+
+    void set(size_t, T) {}
+    void set_missing(size_t) { ++info.missing; }
+
+    void use_names(size_t) { info.has_names = true; }
+    void set_name(size_t, size_t, std::string) {}
+};
+
+struct DescribedFactorArray : public FactorArray, public Described {
+    DescribedFactorArray(std::vector<size_t> d, size_t ll) {
+        info.type = FACTOR_ARRAY;
+        info.levels = ll;
+        set_dimensions(info, std::move(d));
+    }
+
+    size_t first_dim() const { return info.dimensions[0]; }
+
+    void set(size_t, size_t) {}
+    void set_missing(size_t) { ++info.missing; }
+
+    void use_names(size_t) { info.has_names = true; }
+    void set_name(size_t, size_t, std::string) {}
+
+    void is_ordered() { info.ordered = true; }
+    void set_level(size_t, std::string) {}
+};
+
+struct DescribedNothing : public Nothing, public Described {};
+
+struct DescribedOther : public Other, public Described {
+    DescribedOther(void* p) {
+        info.type = OTHER;
+        info.index = reinterpret_cast<uintptr_t>(p);
+    }
+};
+
+struct DescribedList : public List, public Described {
+    DescribedList(size_t n) {
+        info.type = LIST;
+        info.length = n;
+        info.children.resize(n);
+    }
+
+    size_t size() const { return info.length; }
+
+    void set(size_t i, std::shared_ptr<Base> v) { absorb(info.children[i], v); }
+
+    void use_names() {
+        info.has_names = true;
+        info.names.resize(info.length);
+    }
+
+    void set_name(size_t i, std::string n) { info.names[i] = std::move(n); }
+};
+
+struct DescribedDataFrame : public DataFrame, public Described {
+    DescribedDataFrame(size_t r, size_t c) {
+        info.type = DATA_FRAME;
+        info.length = r;
+        info.names.resize(c);
+        info.children.resize(c);
+    }
+
+    void set(size_t i, std::string n, std::shared_ptr<Base> v) {
+        info.names[i] = std::move(n);
+        absorb(info.children[i], v);
+    }
+
+    void use_names() { info.has_names = true; }
+    void set_name(size_t, std::string) {}
+};
+
+struct Provisioner {
+    static constexpr bool skip_values = true;
+
+    static Nothing* new_Nothing() { return (new DescribedNothing); }
+
+    static Other* new_Other(void* p) { return (new DescribedOther(p)); }
+
+    static DataFrame* new_DataFrame(size_t r, size_t c) { return (new DescribedDataFrame(r, c)); }
+
+    static List* new_List(size_t l) { return (new DescribedList(l)); }
+
+    static IntegerVector* new_Integer(size_t l) { return (new DescribedVector<int32_t, INTEGER>(l)); }
+
+    static NumberVector* new_Number(size_t l) { return (new DescribedVector<double, NUMBER>(l)); }
+
+    static StringVector* new_String(size_t l) { return (new DescribedVector<std::string, STRING>(l)); }
+
+    static BooleanVector* new_Boolean(size_t l) { return (new DescribedVector<unsigned char, BOOLEAN>(l)); }
+
+    static DateVector* new_Date(size_t l) { return (new DescribedVector<std::string, DATE>(l)); }
+
+    static Factor* new_Factor(size_t l, size_t ll) { return (new DescribedFactor(l, ll)); }
+
+    static IntegerArray* new_Integer(std::vector<size_t> d) { return (new DescribedArray<int32_t, INTEGER_ARRAY>(std::move(d))); }
+
+    static NumberArray* new_Number(std::vector<size_t> d) { return (new DescribedArray<double, NUMBER_ARRAY>(std::move(d))); }
+
+    static BooleanArray* new_Boolean(std::vector<size_t> d) { return (new DescribedArray<unsigned char, BOOLEAN_ARRAY>(std::move(d))); }
+
+    static StringArray* new_String(std::vector<size_t> d) { return (new DescribedArray<std::string, STRING_ARRAY>(std::move(d))); }
+
+    static DateArray* new_Date(std::vector<size_t> d) { return (new DescribedArray<std::string, DATE_ARRAY>(std::move(d))); }
+
+    static FactorArray* new_Factor(std::vector<size_t> d, size_t ll) { return (new DescribedFactorArray(std::move(d), ll)); }
+};
+
+// Smuggling the index through the pointer, as we don't need to resolve anything.
+struct Externals {
+    void* get(size_t i) const {
+        return reinterpret_cast<void*>(static_cast<uintptr_t>(i));
+    }
+
+    size_t size() const {
+        return -1;
+    }
+};
+
+}
+/**
+ * @endcond
+ */
+
+/**
+ * Summarize the structure of a document, without checking or copying any of the individual values.
+ * Structural checks (types, lengths, dimensions, data frame consistency, external references, resource limits) are still performed,
+ * and any violations will cause an error to be thrown.
+ * However, the contents of `values` are only inspected to count missing values, so this is not a substitute for `validate()`.
+ *
+ * @tparam Json A [`nlohmann::json`](https://github.com/nlohmann/json)-compatible representation of JSON data.
+ *
+ * @param contents Parsed contents of the JSON file.
+ * @param options Further options for parsing.
+ *
+ * @return Description of the root list.
+ */
+template<class Json>
+Description describe(const Json& contents, const Options& options) {
+    Workspace<Json> work;
+    ExternalTracker<description::Externals> etrack(description::Externals(), work.scratch.externals, work.scratch.sites);
+    Result status;
+    auto ptr = unpack<description::Provisioner>(contents, etrack, options, work, status);
+    if (status.ok() && (options.projection.paths.empty() || !options.projection.trust)) {
+        etrack.indices.finish(status);
+    }
+    if (!status.ok()) {
+        throw_error(status);
+    }
+
+    Description output;
+    description::absorb(output, ptr);
+    return output;
+}
+
+/**
+ * Summarize the structure of a document, without checking or copying any of the individual values.
+ *
+ * @tparam Json A [`nlohmann::json`](https://github.com/nlohmann/json)-compatible representation of JSON data.
+ *
+ * @param contents Parsed contents of the JSON file.
+ *
+ * @return Description of the root list.
+ */
+template<class Json>
+Description describe(const Json& contents) {
+    return describe(contents, Options());
+}
+
+}
+
+#endif
@@ -0,0 +1,250 @@
+#ifndef UZUKI_ERROR_HPP
+#define UZUKI_ERROR_HPP
+
+#include <string>
+#include <stdexcept>
+#include <cstddef>
+#include <cstdlib>
+
+#if !defined(__cpp_exceptions) && !defined(__EXCEPTIONS) && !defined(_CPPUNWIND)
+#define UZUKI_NO_EXCEPTIONS
+#endif
+
+/**
+ * @file error.hpp
+ *
+ * @brief Structured errors for invalid documents.
+ */
+
+namespace uzuki {
+
+/**
+ * Rule that was violated by an invalid document.
+ */
+enum class ErrorCode : unsigned char {
+    OK = 0,               /**< No error. */
+    INVALID_STRUCTURE,    /**< List elements are not JSON arrays or objects, or the root is not a list. */
+    INVALID_TYPE,         /**< `type` is missing, not a string or not recognized. */
+    INVALID_VALUES,       /**< `values` does not have the expected form, e.g., not an array or a valid base64 string. */
+    INVALID_VALUE,        /**< An individual value has the wrong JSON type. */
+    OUT_OF_RANGE,         /**< An integer value or sequence lies outside of the 32-bit range. */
+    INVALID_DATE,         /**< A date value does not use the YYYY-MM-DD format. */
+    INVALID_LEVELS,       /**< Factor levels are missing, malformed or duplicated. */
+    UNKNOWN_LEVEL,        /**< A factor value is not present in the levels. */
+    INVALID_ENCODING,     /**< `encoding` is unrecognized or its fields are invalid for the type. */
+    INVALID_LENGTHS,      /**< Run lengths for the "rle" encoding are malformed. */
+    INVALID_DIMENSIONS,   /**< Array dimensions are malformed or inconsistent with the values. */
+    INVALID_NAMES,        /**< Names are malformed or of the wrong length. */
+    INVALID_DATA_FRAME,   /**< Data frame rows or columns are malformed or inconsistent. */
+    INVALID_EXTERNAL,     /**< An external reference index is malformed or out of range. */
+    DUPLICATE_EXTERNAL,   /**< An external reference index is used more than once. */
+    EXTERNAL_COUNT,       /**< External reference indices are not consecutive or do not match the expected number. */
+    LIMIT_EXCEEDED,       /**< A resource limit in `Options::limits` was exceeded. */
+    SIZE_OVERFLOW,        /**< A sum of run lengths or product of dimensions overflows. */
+    UNKNOWN               /**< Any other error, e.g., from the `Provisioner` or `Externals`. */
+};
+
+/**
+ * @param code Rule that was violated.
+ * @return Name of the `ErrorCode`, e.g., `"INVALID_VALUE"`, for use in logs and reports.
+ */
+inline const char* error_name(ErrorCode code) {
+    switch (code) {
+        case ErrorCode::OK: return "OK";
+        case ErrorCode::INVALID_STRUCTURE: return "INVALID_STRUCTURE";
+        case ErrorCode::INVALID_TYPE: return "INVALID_TYPE";
+        case ErrorCode::INVALID_VALUES: return "INVALID_VALUES";
+        case ErrorCode::INVALID_VALUE: return "INVALID_VALUE";
+        case ErrorCode::OUT_OF_RANGE: return "OUT_OF_RANGE";
+        case ErrorCode::INVALID_DATE: return "INVALID_DATE";
+        case ErrorCode::INVALID_LEVELS: return "INVALID_LEVELS";
+        case ErrorCode::UNKNOWN_LEVEL: return "UNKNOWN_LEVEL";
+        case ErrorCode::INVALID_ENCODING: return "INVALID_ENCODING";
+        case ErrorCode::INVALID_LENGTHS: return "INVALID_LENGTHS";
+        case ErrorCode::INVALID_DIMENSIONS: return "INVALID_DIMENSIONS";
+        case ErrorCode::INVALID_NAMES: return "INVALID_NAMES";
+        case ErrorCode::INVALID_DATA_FRAME: return "INVALID_DATA_FRAME";
+        case ErrorCode::INVALID_EXTERNAL: return "INVALID_EXTERNAL";
+        case ErrorCode::DUPLICATE_EXTERNAL: return "DUPLICATE_EXTERNAL";
+        case ErrorCode::EXTERNAL_COUNT: return "EXTERNAL_COUNT";
+        case ErrorCode::LIMIT_EXCEEDED: return "LIMIT_EXCEEDED";
+        case ErrorCode::SIZE_OVERFLOW: return "SIZE_OVERFLOW";
+        case ErrorCode::UNKNOWN: return "UNKNOWN";
+    }
+    return "UNKNOWN";
+}
+
+/**
+ * @brief Outcome of a validation or parsing call.
+ *
+ * On failure, this records the violated rule and its location.
+ * The human-readable message is only rendered on request by `message()`, so failures are cheap to report.
+ */
+struct Result {
+    /**
+     * Value of `index` when the failure does not refer to an individual element.
+     */
+    static constexpr size_t no_index = static_cast<size_t>(-1);
+
+    /**
+     * Rule that was violated, or `ErrorCode::OK` if the call succeeded.
+     */
+    ErrorCode code = ErrorCode::OK;
+
+    /**
+     * Path to the offending node, e.g., `.foo[0].values`.
+     * This is empty if the failure is not specific to any node.
+     */
+    std::string path;
+
+    /**
+     * Index of the offending element in the node at `path`, or `no_index` if the failure does not refer to an individual element.
+     */
+    size_t index = no_index;
+
+    /**
+     * @return Whether the call succeeded.
+     */
+    bool ok() const {
+        return code == ErrorCode::OK;
+    }
+
+    /**
+     * @return Human-readable message describing the failure, or an empty string if the call succeeded.
+     */
+    std::string message() const {
+        std::string output;
+        for (const char* f = format; *f; ++f) {
+            if (*f != '%' || f[1] == '\0') {
+                output += *f;
+                continue;
+            }
+            switch (*(++f)) {
+                case 'p': output += path; break;
+                case 'i': output += std::to_string(index); break;
+                case 'n': output += std::to_string(number); break;
+                case 's': output += argument; break;
+                default: output += *f;
+            }
+        }
+        return output;
+    }
+
+    /**
+     * @cond
+     */
+    // Records the first failure only, and returns false for convenience in functions that report success.
+    // The message is rendered from 'fmt', where '%p' is replaced by the path, '%i' by the index, '%n' by 'num' and '%s' by 'arg'.
+    bool fail(ErrorCode c, std::string p, const char* fmt, size_t i = no_index, size_t num = 0, std::string arg = std::string()) {
+        if (code == ErrorCode::OK) {
+            code = c;
+            path = std::move(p);
+            index = i;
+            format = fmt;
+            number = num;
+            argument = std::move(arg);
+        }
+        return false;
+    }
+
+    const char* format = "";
+    size_t number = 0;
+    std::string argument;
+    /**
+     * @endcond
+     */
+};
+
+/**
+ * @brief Error thrown for an invalid document.
+ *
+ * This is a `std::runtime_error` with the usual human-readable message,
+ * along with the violated rule and its location for programmatic triage.
+ */
+class Error : public std::runtime_error {
+public:
+    /**
+     * Value of `index()` when the error does not refer to an individual element.
+     */
+    static constexpr size_t no_index = Result::no_index;
+
+    /**
+     * @param code Rule that was violated.
+     * @param path Path to the offending node, using the same syntax as error messages.
+     * @param message Human-readable message.
+     * @param index Index of the offending element inside the node, if applicable.
+     */
+    Error(ErrorCode code, std::string path, const std::string& message, size_t index = no_index) :
+        std::runtime_error(message), my_code(code), my_path(std::move(path)), my_index(index) {}
+
+    /**
+     * @param res Result of a failed call.
+     */
+    Error(const Result& res) : Error(res.code, res.path, res.message(), res.index) {}
+
+    /**
+     * @return Rule that was violated.
+     */
+    ErrorCode code() const {
+        return my_code;
+    }
+
+    /**
+     * @return Path to the offending node, e.g., `.foo[0].values`.
+     * This is empty if the error is not specific to any node.
+     */
+    const std::string& path() const {
+        return my_path;
+    }
+
+    /**
+     * @return Index of the offending element in the node at `path()`, or `no_index` if the error does not refer to an individual element.
+     */
+    size_t index() const {
+        return my_index;
+    }
+
+private:
+    ErrorCode my_code;
+    std::string my_path;
+    size_t my_index;
+};
+
+/**
+ * @cond
+ */
+// Used by the throwing functions, which are thin wrappers around the ones that return a Result.
+// Without exceptions, failures in the throwing functions abort, as in nlohmann::json.
+[[noreturn]] inline void throw_error(const Result& res) {
+#ifdef UZUKI_NO_EXCEPTIONS
+    (void)res;
+    std::abort();
+#else
+    throw Error(res);
+#endif
+}
+
+// Used by the nothrow functions, where invalid documents are already reported through 'res' without unwinding.
+// This only catches exceptions from user-supplied classes (e.g., the Provisioner) or allocation failures, if exceptions are enabled at all.
+template<class Function>
+void guard(Result& res, Function fun) noexcept {
+#ifdef UZUKI_NO_EXCEPTIONS
+    (void)res;
+    fun();
+#else
+    try {
+        fun();
+    } catch (const std::exception& e) {
+        res.fail(ErrorCode::UNKNOWN, "", "%s", Result::no_index, 0, e.what());
+    } catch (...) {
+        res.fail(ErrorCode::UNKNOWN, "", "unknown error");
+    }
+#endif
+}
+/**
+ * @endcond
+ */
+
+}
+
+#endif
@@ -0,0 +1,262 @@
+#ifndef UZUKI_FINGERPRINT_HPP
+#define UZUKI_FINGERPRINT_HPP
+
+#include "hash.hpp"
+
+#include <string>
+#include <cstdint>
+#include <cstring>
+#include <unordered_map>
+#include <vector>
+#include <utility>
+
+/**
+ * @file fingerprint.hpp
+ *
+ * @brief Structural fingerprints of **uzuki** objects.
+ */
+
+namespace uzuki {
+
+/**
+ * @brief Structural fingerprints computed during parsing.
+ *
+ * Fingerprints are 64-bit hashes that only depend on the structure and content of each object,
+ * i.e., they are unaffected by whitespace or by the order of keys inside the JSON objects that define each vector, array, etc.
+ * However, they do respect the order of elements in lists and vectors.
+ * Keys that are ignored by the validator do not contribute to the fingerprint of a node.
+ * This can be used to identify duplicated objects across documents or to detect changes without a full comparison.
+ */
+struct Fingerprints {
+    /**
+     * Fingerprint of the entire document.
+     */
+    uint64_t document = 0;
+
+    /**
+     * Fingerprint of each node, i.e., each list element, non-list object or data frame column.
+     * Each key is the path to the node, using the same syntax as error messages, e.g., `.foo[0].columns.bar`.
+     * The root list has an empty path.
+     */
+    std::unordered_map<std::string, uint64_t> nodes;
+};
+
+/**
+ * @cond
+ */
+namespace fingerprint {
+
+enum Tag : uint64_t {
+    NULL_TAG = 1,
+    BOOLEAN_TAG,
+    NUMBER_TAG,
+    STRING_TAG,
+    ARRAY_TAG,
+    OBJECT_TAG,
+    UNNAMED_LIST_TAG,
+    NAMED_LIST_TAG,
+    DATA_FRAME_TAG,
+    BINARY_TAG
+};
+
+inline uint64_t combine(uint64_t seed, uint64_t value) {
+    seed ^= xxh64::round(0, value);
+    return xxh64::rotl(seed, 27) * xxh64::prime1 + xxh64::prime4;
+}
+
+inline uint64_t finish(uint64_t seed) {
+    return xxh64::avalanche(seed);
+}
+
+inline uint64_t string(const std::string& x) {
+    return hash_bytes(x, STRING_TAG);
+}
+
+inline uint64_t number(double x) {
+    if (x == 0) {
+        x = 0; // collapsing negative zero.
+    }
+    uint64_t bits;
+    std::memcpy(&bits, &x, sizeof(bits));
+    return finish(combine(NUMBER_TAG, bits));
+}
+
+}
+/**
+ * @endcond
+ */
+
+/**
+ * @cond
+ */
+namespace fingerprint {
+
+template<class Json>
+uint64_t scalar(const Json& j) {
+    if (j.is_null()) {
+        return finish(NULL_TAG);
+    } else if (j.is_boolean()) {
+        return finish(combine(BOOLEAN_TAG, j.template get<bool>()));
+    } else if (j.is_number()) {
+        return number(j.template get<double>());
+    } else if (j.is_string()) {
+        return string(j.template get_ref<const typename Json::string_t&>());
+    } else if (j.is_binary()) {
+        const auto& bytes = j.get_binary();
+        return hash_bytes(bytes.data(), bytes.size(), BINARY_TAG);
+    }
+    return finish(0);
+}
+
+template<class Json>
+struct Frame {
+    Frame(const Json* n, uint64_t a) : node(n), current(n->begin()), accumulated(a) {}
+    const Json* node;
+    typename Json::const_iterator current;
+    uint64_t accumulated;
+};
+
+template<class Json>
+void absorb(Frame<Json>& frame, uint64_t child) {
+    if (frame.node->is_array()) {
+        frame.accumulated = combine(frame.accumulated, child);
+    } else {
+        // Summing the per-pair hashes so that the result does not depend on the key order.
+        frame.accumulated += finish(combine(string(frame.current.key()), child));
+    }
+    ++frame.current;
+}
+
+/*
+ * Keys that are used by the validator for non-list objects.
+ * Anything else is ignored during validation and so does not contribute to the fingerprint.
+ */
+inline const std::vector<std::string>& node_fields() {
+    static const std::vector<std::string> fields {
+        "type", "values", "encoding", "start", "step", "length", "lengths", "validity", "levels", "dimensions", "names", "index"
+    };
+    return fields;
+}
+
+/*
+ * Same as 'a == b', but using an explicit stack so that deeply nested
+ * content can be compared safely. Numbers are compared by value.
+ */
+template<class Json>
+bool equal(const Json& a, const Json& b) {
+    std::vector<std::pair<const Json*, const Json*> > pending;
+    pending.emplace_back(&a, &b);
+
+    while (!pending.empty()) {
+        auto current = pending.back();
+        pending.pop_back();
+        const auto& x = *(current.first);
+        const auto& y = *(current.second);
+
+        if (x.is_array()) {
+            if (!y.is_array() || x.size() != y.size()) {
+                return false;
+            }
+            for (size_t i = 0, end = x.size(); i < end; ++i) {
+                pending.emplace_back(&(x[i]), &(y[i]));
+            }
+        } else if (x.is_object()) {
+            if (!y.is_object() || x.size() != y.size()) {
+                return false;
+            }
+            for (auto it = x.begin(); it != x.end(); ++it) {
+                auto yIt = y.find(it.key());
+                if (yIt == y.end()) {
+                    return false;
+                }
+                pending.emplace_back(&(it.value()), &(*yIt));
+            }
+        } else if (y.is_array() || y.is_object() || !(x == y)) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+}
+/**
+ * @endcond
+ */
+
+/**
+ * Compute the canonical hash of arbitrary JSON content.
+ * Numbers are hashed by their double-precision value, so `1` and `1.0` are treated as equal.
+ * Keys of JSON objects are hashed in an order-independent manner, while elements of JSON arrays are hashed in order.
+ * Nested content is traversed with an explicit stack, so arbitrarily deep input is safe to hash.
+ *
+ * @tparam Json A [`nlohmann::json`](https://github.com/nlohmann/json)-compatible representation of JSON data.
+ * @param j JSON content.
+ * @return The hash value.
+ */
+template<class Json>
+uint64_t hash_json(const Json& j) {
+    using namespace fingerprint;
+    if (!j.is_array() && !j.is_object()) {
+        return scalar(j);
+    }
+
+    std::vector<Frame<Json> > pending;
+    auto open = [&](const Json& x) -> void {
+        pending.emplace_back(&x, x.is_array() ? combine(ARRAY_TAG, x.size()) : 0);
+    };
+    open(j);
+
+    while (true) {
+        auto& frame = pending.back();
+        if (frame.current == frame.node->end()) {
+            const auto& node = *(frame.node);
+            uint64_t h = (node.is_array() ? finish(frame.accumulated) : finish(combine(combine(OBJECT_TAG, node.size()), frame.accumulated)));
+            pending.pop_back();
+            if (pending.empty()) {
+                return h;
+            }
+            absorb(pending.back(), h);
+            continue;
+        }
+
+        const auto& x = *(frame.current);
+        if (x.is_array() || x.is_object()) {
+            open(x); // invalidates 'frame', but we're restarting the loop anyway.
+        } else {
+            absorb(frame, scalar(x));
+        }
+    }
+}
+
+/**
+ * Compute the canonical hash of a non-list object, i.e., a vector, factor, array or other object.
+ * This is equal to `hash_json()` on the same object after removing all keys that are ignored by the validator,
+ * so that the fingerprint does not depend on extra (and potentially untrusted) content.
+ *
+ * @tparam Json A [`nlohmann::json`](https://github.com/nlohmann/json)-compatible representation of JSON data.
+ * @param j JSON object.
+ * @return The hash value.
+ */
+template<class Json>
+uint64_t hash_node(const Json& j) {
+    using namespace fingerprint;
+    if (!j.is_object()) {
+        return hash_json(j);
+    }
+
+    uint64_t total = 0;
+    size_t count = 0;
+    for (const auto& field : node_fields()) {
+        auto it = j.find(field);
+        if (it != j.end()) {
+            total += finish(combine(string(field), hash_json(*it)));
+            ++count;
+        }
+    }
+    return finish(combine(combine(OBJECT_TAG, count), total));
+}
+
+}
+
+#endif
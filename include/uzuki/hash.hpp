@@ -0,0 +1,142 @@
+#ifndef UZUKI_HASH_HPP
+#define UZUKI_HASH_HPP
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+/**
+ * @file hash.hpp
+ *
+ * @brief Fast non-cryptographic hashing of byte strings.
+ */
+
+namespace uzuki {
+
+/**
+ * @cond
+ */
+namespace xxh64 {
+
+constexpr uint64_t prime1 = 0x9E3779B185EBCA87ULL;
+constexpr uint64_t prime2 = 0xC2B2AE3D27D4EB4FULL;
+constexpr uint64_t prime3 = 0x165667B19E3779F9ULL;
+constexpr uint64_t prime4 = 0x85EBCA77C2B2AE63ULL;
+constexpr uint64_t prime5 = 0x27D4EB2F165667C5ULL;
+
+inline uint64_t rotl(uint64_t x, int r) {
+    return (x << r) | (x >> (64 - r));
+}
+
+// xxHash is defined on little-endian reads, so we assemble the words bytewise.
+inline uint64_t read64(const unsigned char* p) {
+    uint64_t out = 0;
+    for (int b = 7; b >= 0; --b) {
+        out = (out << 8) | p[b];
+    }
+    return out;
+}
+
+inline uint32_t read32(const unsigned char* p) {
+    uint32_t out = 0;
+    for (int b = 3; b >= 0; --b) {
+        out = (out << 8) | p[b];
+    }
+    return out;
+}
+
+inline uint64_t round(uint64_t acc, uint64_t input) {
+    acc += input * prime2;
+    acc = rotl(acc, 31);
+    return acc * prime1;
+}
+
+inline uint64_t merge(uint64_t acc, uint64_t val) {
+    acc ^= round(0, val);
+    return acc * prime1 + prime4;
+}
+
+inline uint64_t avalanche(uint64_t h) {
+    h ^= h >> 33;
+    h *= prime2;
+    h ^= h >> 29;
+    h *= prime3;
+    h ^= h >> 32;
+    return h;
+}
+
+}
+/**
+ * @endcond
+ */
+
+/**
+ * Compute the 64-bit [xxHash](https://github.com/Cyan4973/xxHash) (XXH64) of a byte string.
+ * This is a fast non-cryptographic hash that is suitable for content addressing.
+ *
+ * @param data Pointer to the bytes.
+ * @param n Number of bytes.
+ * @param seed Seed for the hash.
+ *
+ * @return The hash value.
+ */
+inline uint64_t hash_bytes(const void* data, size_t n, uint64_t seed = 0) {
+    using namespace xxh64;
+    const unsigned char* p = static_cast<const unsigned char*>(data);
+    const unsigned char* end = p + n;
+    uint64_t h;
+
+    if (n >= 32) {
+        uint64_t v1 = seed + prime1 + prime2;
+        uint64_t v2 = seed + prime2;
+        uint64_t v3 = seed;
+        uint64_t v4 = seed - prime1;
+        const unsigned char* limit = end - 32;
+        do {
+            v1 = xxh64::round(v1, read64(p));
+            v2 = xxh64::round(v2, read64(p + 8));
+            v3 = xxh64::round(v3, read64(p + 16));
+            v4 = xxh64::round(v4, read64(p + 24));
+            p += 32;
+        } while (p <= limit);
+
+        h = rotl(v1, 1) + rotl(v2, 7) + rotl(v3, 12) + rotl(v4, 18);
+        h = merge(h, v1);
+        h = merge(h, v2);
+        h = merge(h, v3);
+        h = merge(h, v4);
+    } else {
+        h = seed + prime5;
+    }
+
+    h += static_cast<uint64_t>(n);
+
+    for (; p + 8 <= end; p += 8) {
+        h ^= xxh64::round(0, read64(p));
+        h = rotl(h, 27) * prime1 + prime4;
+    }
+    if (p + 4 <= end) {
+        h ^= static_cast<uint64_t>(read32(p)) * prime1;
+        h = rotl(h, 23) * prime2 + prime3;
+        p += 4;
+    }
+    for (; p < end; ++p) {
+        h ^= static_cast<uint64_t>(*p) * prime5;
+        h = rotl(h, 11) * prime1;
+    }
+
+    return avalanche(h);
+}
+
+/**
+ * @param data String to be hashed.
+ * @param seed Seed for the hash.
+ * @return The XXH64 hash of the string's bytes.
+ */
+inline uint64_t hash_bytes(const std::string& data, uint64_t seed = 0) {
+    return hash_bytes(data.data(), data.size(), seed);
+}
+
+}
+
+#endif
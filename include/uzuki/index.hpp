@@ -0,0 +1,593 @@
+#ifndef UZUKI_INDEX_HPP
+#define UZUKI_INDEX_HPP
+
+#include "interfaces.hpp"
+#include "unpack.hpp"
+#include "parse.hpp"
+#include "describe.hpp"
+#include "base64.hpp"
+#include "hash.hpp"
+
+#include "nlohmann/json.hpp"
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+
+/**
+ * @file index.hpp
+ *
+ * @brief Sidecar byte-offset index for random access into **uzuki** files.
+ */
+
+namespace uzuki {
+
+/**
+ * @brief Index entry for a single node.
+ */
+struct IndexEntry {
+    /**
+     * Path to the node, using the same syntax as error messages, e.g., `.foo[0].columns.bar`.
+     * The root list has an empty path.
+     */
+    std::string path;
+
+    /**
+     * Type of the node.
+     */
+    Type type = NOTHING;
+
+    /**
+     * Length of the node, see `Description::length` for details.
+     */
+    uint64_t length = 0;
+
+    /**
+     * Dimensions of an array.
+     * This is empty for all other types.
+     */
+    std::vector<uint64_t> dimensions;
+
+    /**
+     * Byte offset of the start of the node's JSON value in the file.
+     */
+    uint64_t begin = 0;
+
+    /**
+     * Byte offset of the end of the node's JSON value in the file, i.e., one past the last byte.
+     */
+    uint64_t end = 0;
+
+    /**
+     * Whether this node is a data frame column.
+     * If so, the first `parent_size` characters of `path` contain the path to the parent data frame.
+     */
+    bool column = false;
+
+    /**
+     * Length of the parent data frame's path, only used if `column = true`.
+     */
+    uint64_t parent_size = 0;
+
+    /**
+     * XXH64 hash of the bytes from `begin` to `end`, see `hash_bytes()`.
+     * This is used to check that the node has not changed since the index was built.
+     */
+    uint64_t hash = 0;
+};
+
+/**
+ * @brief Byte-offset index of a **uzuki** file.
+ *
+ * This records the location of every list element and data frame column in a file,
+ * allowing `parse_at()` to parse a subtree without reading the rest of the file.
+ */
+struct FileIndex {
+    /**
+     * Size of the indexed file in bytes.
+     * This is used as a cheap check that the index is not out of date,
+     * before checking the hash of each node that is read by `parse_at()`.
+     */
+    uint64_t file_size = 0;
+
+    /**
+     * Entries for all nodes, sorted by `IndexEntry::path`.
+     */
+    std::vector<IndexEntry> entries;
+
+    /**
+     * @param path Path to a node.
+     * @return Pointer to the entry for `path`, or `NULL` if no such node exists.
+     */
+    const IndexEntry* find(const std::string& path) const {
+        auto it = std::lower_bound(entries.begin(), entries.end(), path, [](const IndexEntry& e, const std::string& p) -> bool { return e.path < p; });
+        if (it == entries.end() || it->path != path) {
+            return nullptr;
+        }
+        return &(*it);
+    }
+};
+
+/**
+ * @cond
+ */
+namespace indexing {
+
+inline bool is_whitespace(char c) {
+    return c == ' ' || c == '\n' || c == '\r' || c == '\t';
+}
+
+inline size_t skip_whitespace(const char* data, size_t n, size_t pos) {
+    while (pos < n && is_whitespace(data[pos])) {
+        ++pos;
+    }
+    return pos;
+}
+
+// 'pos' should point to the opening quote; returns the position after the closing quote.
+inline size_t skip_string(const char* data, size_t n, size_t pos) {
+    ++pos;
+    while (pos < n) {
+        char c = data[pos];
+        if (c == '\\') {
+            pos += 2;
+        } else if (c == '"') {
+            return pos + 1;
+        } else {
+            ++pos;
+        }
+    }
+    throw std::runtime_error("unterminated string in JSON file");
+}
+
+// Returns the position after the end of the value starting at 'pos'.
+inline size_t skip_value(const char* data, size_t n, size_t pos) {
+    size_t depth = 0;
+    while (pos < n) {
+        char c = data[pos];
+        if (c == '"') {
+            pos = skip_string(data, n, pos);
+            if (depth == 0) {
+                return pos;
+            }
+            continue;
+        }
+
+        if (c == '[' || c == '{') {
+            ++depth;
+        } else if (c == ']' || c == '}') {
+            if (depth == 0) {
+                return pos;
+            }
+            --depth;
+            if (depth == 0) {
+                return pos + 1;
+            }
+        } else if (depth == 0 && (c == ',' || is_whitespace(c))) {
+            return pos;
+        }
+        ++pos;
+    }
+    return pos;
+}
+
+struct Member {
+    std::string key;
+    size_t begin, end;
+};
+
+template<class Json>
+std::string decode_string(const char* data, size_t begin, size_t end) {
+    if (std::memchr(data + begin, '\\', end - begin) == nullptr) {
+        return std::string(data + begin + 1, data + end - 1);
+    }
+    return Json::parse(data + begin, data + end).template get<std::string>();
+}
+
+inline void expect(const char* data, size_t n, size_t pos, char c) {
+    if (pos >= n || data[pos] != c) {
+        throw std::runtime_error("expected '" + std::string(1, c) + "' at byte " + std::to_string(pos) + " of JSON file");
+    }
+}
+
+// 'pos' should point to the opening bracket or brace.
+template<class Json>
+void scan_container(const char* data, size_t n, size_t pos, bool object, std::vector<Member>& output) {
+    output.clear();
+    char closing = (object ? '}' : ']');
+    pos = skip_whitespace(data, n, pos + 1);
+    if (pos < n && data[pos] == closing) {
+        return;
+    }
+
+    while (true) {
+        Member current;
+        if (object) {
+            expect(data, n, pos, '"');
+            size_t kend = skip_string(data, n, pos);
+            current.key = decode_string<Json>(data, pos, kend);
+            pos = skip_whitespace(data, n, kend);
+            expect(data, n, pos, ':');
+            pos = skip_whitespace(data, n, pos + 1);
+        }
+
+        current.begin = pos;
+        current.end = skip_value(data, n, pos);
+        output.push_back(std::move(current));
+
+        pos = skip_whitespace(data, n, output.back().end);
+        if (pos < n && data[pos] == ',') {
+            pos = skip_whitespace(data, n, pos + 1);
+        } else {
+            expect(data, n, pos, closing);
+            return;
+        }
+    }
+}
+
+inline void collect_descriptions(const Description& root, std::unordered_map<std::string, const Description*>& output) {
+    std::vector<std::pair<const Description*, std::string> > pending;
+    pending.emplace_back(&root, "");
+
+    while (!pending.empty()) {
+        auto current = std::move(pending.back());
+        pending.pop_back();
+        const auto& desc = *(current.first);
+
+        if (desc.type == LIST) {
+            for (size_t i = 0; i < desc.children.size(); ++i) {
+                auto path = current.second;
+                if (desc.has_names) {
+                    path += "." + desc.names[i];
+                } else {
+                    path += "[" + std::to_string(i) + "]";
+                }
+                pending.emplace_back(&(desc.children[i]), std::move(path));
+            }
+        } else if (desc.type == DATA_FRAME) {
+            for (size_t i = 0; i < desc.children.size(); ++i) {
+                output[current.second + ".columns." + desc.names[i]] = &(desc.children[i]);
+            }
+        }
+
+        output[std::move(current.second)] = current.first;
+    }
+}
+
+inline void fill_entry(IndexEntry& entry, const std::unordered_map<std::string, const Description*>& descriptions) {
+    auto it = descriptions.find(entry.path);
+    if (it == descriptions.end()) {
+        throw std::runtime_error("failed to find \"" + entry.path + "\" in the parsed document");
+    }
+    const auto& desc = *(it->second);
+    entry.type = desc.type;
+    entry.length = desc.length;
+    entry.dimensions.insert(entry.dimensions.end(), desc.dimensions.begin(), desc.dimensions.end());
+}
+
+template<typename T>
+void put(std::string& buffer, T val) {
+    unsigned char tmp[sizeof(T)];
+    write_little_endian(val, tmp);
+    buffer.append(reinterpret_cast<const char*>(tmp), sizeof(T));
+}
+
+template<typename T>
+T take(const std::string& buffer, size_t& pos) {
+    if (buffer.size() - pos < sizeof(T)) {
+        throw std::runtime_error("index file is truncated");
+    }
+    T output = read_little_endian<T>(reinterpret_cast<const unsigned char*>(buffer.data()) + pos);
+    pos += sizeof(T);
+    return output;
+}
+
+constexpr const char* magic = "UZUKIIDX";
+constexpr uint32_t version = 2;
+
+inline std::string read_file(const std::string& path) {
+    std::ifstream handle(path, std::ios::binary);
+    if (!handle) {
+        throw std::runtime_error("failed to open '" + path + "'");
+    }
+    std::stringstream buffer;
+    buffer << handle.rdbuf();
+    return buffer.str();
+}
+
+}
+/**
+ * @endcond
+ */
+
+/**
+ * Build a byte-offset index for the contents of a **uzuki** JSON file.
+ * This parses the entire document and checks its structure via `describe()`, so it should only be done once per file.
+ * An error is thrown if two nodes have the same path, e.g., for a list element named `a.b` and an element `b` inside a list named `a`.
+ *
+ * @tparam Json A [`nlohmann::json`](https://github.com/nlohmann/json)-compatible representation of JSON data.
+ * @param contents Contents of the JSON file.
+ *
+ * @return Index of all list elements and data frame columns in `contents`.
+ */
+template<class Json = nlohmann::json>
+FileIndex build_index(const std::string& contents) {
+    auto desc = describe(Json::parse(contents));
+    std::unordered_map<std::string, const Description*> descriptions;
+    indexing::collect_descriptions(desc, descriptions);
+
+    FileIndex output;
+    output.file_size = contents.size();
+
+    const char* data = contents.data();
+    size_t n = contents.size();
+    std::vector<std::pair<size_t, std::string> > pending;
+    pending.emplace_back(indexing::skip_whitespace(data, n, 0), "");
+    std::vector<indexing::Member> members, columns;
+
+    // Each value is only skipped once per level of nesting, so the cost is proportional to the file size times the nesting depth.
+    while (!pending.empty()) {
+        auto current = std::move(pending.back());
+        pending.pop_back();
+        size_t pos = current.first;
+
+        IndexEntry entry;
+        entry.path = std::move(current.second);
+        entry.begin = pos;
+        entry.end = indexing::skip_value(data, n, pos);
+        entry.hash = hash_bytes(data + entry.begin, entry.end - entry.begin);
+        indexing::fill_entry(entry, descriptions);
+
+        if (data[pos] == '[') {
+            indexing::scan_container<Json>(data, n, pos, false, members);
+            for (size_t i = 0; i < members.size(); ++i) {
+                pending.emplace_back(members[i].begin, entry.path + "[" + std::to_string(i) + "]");
+            }
+
+        } else if (data[pos] == '{') {
+            indexing::scan_container<Json>(data, n, pos, true, members);
+
+            const indexing::Member* type = nullptr;
+            for (const auto& m : members) {
+                if (m.key == "type" && data[m.begin] == '"') {
+                    type = &m;
+                }
+            }
+
+            if (type == nullptr) {
+                for (const auto& m : members) {
+                    pending.emplace_back(m.begin, entry.path + "." + m.key);
+                }
+            } else if (entry.type == DATA_FRAME) {
+                for (const auto& m : members) {
+                    if (m.key == "columns" && data[m.begin] == '{') {
+                        indexing::scan_container<Json>(data, n, m.begin, true, columns);
+                        for (const auto& col : columns) {
+                            IndexEntry centry;
+                            centry.path = entry.path + ".columns." + col.key;
+                            centry.begin = col.begin;
+                            centry.end = col.end;
+                            centry.hash = hash_bytes(data + col.begin, col.end - col.begin);
+                            centry.column = true;
+                            centry.parent_size = entry.path.size();
+                            indexing::fill_entry(centry, descriptions);
+                            output.entries.push_back(std::move(centry));
+                        }
+                    }
+                }
+            }
+        }
+
+        output.entries.push_back(std::move(entry));
+    }
+
+    std::sort(output.entries.begin(), output.entries.end(), [](const IndexEntry& left, const IndexEntry& right) -> bool { return left.path < right.path; });
+
+    // Paths are not escaped, so names containing '.' or '[' (or duplicated keys) can make them ambiguous.
+    for (size_t i = 1; i < output.entries.size(); ++i) {
+        if (output.entries[i].path == output.entries[i - 1].path) {
+            throw std::runtime_error("multiple nodes have the same path \"" + output.entries[i].path + "\"");
+        }
+    }
+
+    return output;
+}
+
+/**
+ * Build a byte-offset index for a **uzuki** JSON file.
+ *
+ * @tparam Json A [`nlohmann::json`](https://github.com/nlohmann/json)-compatible representation of JSON data.
+ * @param path Path to the JSON file.
+ *
+ * @return Index of all list elements and data frame columns in the file.
+ */
+template<class Json = nlohmann::json>
+FileIndex build_index_from_file(const std::string& path) {
+    return build_index<Json>(indexing::read_file(path));
+}
+
+/**
+ * Save an index to a compact binary sidecar file.
+ * All integers are stored in little-endian byte order.
+ *
+ * @param index The index.
+ * @param path Path to the sidecar file.
+ */
+inline void save_index(const FileIndex& index, const std::string& path) {
+    std::string buffer(indexing::magic);
+    indexing::put<uint32_t>(buffer, indexing::version);
+    indexing::put<uint64_t>(buffer, index.file_size);
+    indexing::put<uint64_t>(buffer, index.entries.size());
+
+    for (const auto& e : index.entries) {
+        indexing::put<uint64_t>(buffer, e.begin);
+        indexing::put<uint64_t>(buffer, e.end);
+        indexing::put<uint8_t>(buffer, e.type);
+        indexing::put<uint8_t>(buffer, e.column);
+        indexing::put<uint64_t>(buffer, e.parent_size);
+        indexing::put<uint64_t>(buffer, e.length);
+        indexing::put<uint64_t>(buffer, e.hash);
+        indexing::put<uint32_t>(buffer, e.dimensions.size());
+        for (auto d : e.dimensions) {
+            indexing::put<uint64_t>(buffer, d);
+        }
+        indexing::put<uint64_t>(buffer, e.path.size());
+        buffer += e.path;
+    }
+
+    std::ofstream handle(path, std::ios::binary);
+    if (!handle || !handle.write(buffer.data(), buffer.size())) {
+        throw std::runtime_error("failed to write the index to '" + path + "'");
+    }
+}
+
+/**
+ * Load an index from a sidecar file created by `save_index()`.
+ *
+ * @param path Path to the sidecar file.
+ * @return The index.
+ */
+inline FileIndex load_index(const std::string& path) {
+    auto buffer = indexing::read_file(path);
+    size_t nmagic = std::strlen(indexing::magic);
+    if (buffer.compare(0, nmagic, indexing::magic) != 0) {
+        throw std::runtime_error("'" + path + "' is not a uzuki index file");
+    }
+
+    size_t pos = nmagic;
+    if (indexing::take<uint32_t>(buffer, pos) != indexing::version) {
+        throw std::runtime_error("unsupported version of the uzuki index file in '" + path + "'");
+    }
+
+    FileIndex output;
+    output.file_size = indexing::take<uint64_t>(buffer, pos);
+    uint64_t nentries = indexing::take<uint64_t>(buffer, pos);
+
+    for (uint64_t i = 0; i < nentries; ++i) {
+        IndexEntry e;
+        e.begin = indexing::take<uint64_t>(buffer, pos);
+        e.end = indexing::take<uint64_t>(buffer, pos);
+        e.type = static_cast<Type>(indexing::take<uint8_t>(buffer, pos));
+        e.column = indexing::take<uint8_t>(buffer, pos);
+        e.parent_size = indexing::take<uint64_t>(buffer, pos);
+        e.length = indexing::take<uint64_t>(buffer, pos);
+        e.hash = indexing::take<uint64_t>(buffer, pos);
+        uint32_t ndims = indexing::take<uint32_t>(buffer, pos);
+        for (uint32_t d = 0; d < ndims; ++d) {
+            e.dimensions.push_back(indexing::take<uint64_t>(buffer, pos));
+        }
+        uint64_t npath = indexing::take<uint64_t>(buffer, pos);
+        if (buffer.size() - pos < npath) {
+            throw std::runtime_error("index file is truncated");
+        }
+        e.path = buffer.substr(pos, npath);
+        pos += npath;
+        output.entries.push_back(std::move(e));
+    }
+
+    return output;
+}
+
+/**
+ * Parse a single subtree of a **uzuki** JSON file, using an index to read only the relevant bytes.
+ * The subtree is fully validated, except that the external references are only checked for being in range and unique within the subtree,
+ * as the contiguity of indices can only be checked across the entire document.
+ *
+ * @tparam Provisioner A class namespace defining static methods for creating new `Base` objects, see `parse()`.
+ * This should not declare `lazy_values`, as the subtree contents are discarded on return.
+ * @tparam Json A [`nlohmann::json`](https://github.com/nlohmann/json)-compatible representation of JSON data.
+ * @tparam Externals Class describing how to resolve external references for type `OTHER`, see `parse()`.
+ *
+ * @param file Path to the JSON file.
+ * @param index Index of the JSON file, usually created by `build_index_from_file()` or loaded by `load_index()`.
+ * @param path Path to the subtree of interest, using the same syntax as error messages.
+ * @param ext Instance of an external reference resolver class.
+ * The indices are relative to the entire document.
+ * @param options Further options for parsing.
+ *
+ * @return Pointer to the `Base` object for the subtree.
+ */
+template<class Provisioner, class Json = nlohmann::json, class Externals>
+std::shared_ptr<Base> parse_at(const std::string& file, const FileIndex& index, const std::string& path, Externals ext, const Options& options) {
+    static_assert(!lazy_values<Provisioner>::value, "lazy provisioners cannot be used as the subtree contents are not retained");
+    auto entry = index.find(path);
+    if (entry == nullptr) {
+        throw std::runtime_error("no node at \"" + path + "\" in the index");
+    }
+
+    const IndexEntry* parent = nullptr;
+    std::string parent_path;
+    if (entry->column) {
+        parent_path = entry->path.substr(0, entry->parent_size);
+        parent = index.find(parent_path);
+        if (parent == nullptr) {
+            throw std::runtime_error("no data frame at \"" + parent_path + "\" in the index");
+        }
+    }
+
+    std::ifstream handle(file, std::ios::binary | std::ios::ate);
+    if (!handle) {
+        throw std::runtime_error("failed to open '" + file + "'");
+    }
+    if (static_cast<uint64_t>(handle.tellg()) != index.file_size) {
+        throw std::runtime_error("index is out of date for '" + file + "'");
+    }
+
+    std::string buffer(entry->end - entry->begin, '\0');
+    handle.seekg(entry->begin);
+    if (!handle.read(&(buffer[0]), buffer.size())) {
+        throw std::runtime_error("failed to read \"" + path + "\" from '" + file + "'");
+    }
+    if (hash_bytes(buffer) != entry->hash) {
+        throw std::runtime_error("index is out of date for '" + file + "'");
+    }
+
+    auto contents = Json::parse(buffer);
+    Workspace<Json> work;
+    ExternalTracker<Externals> etrack(std::move(ext), work.scratch.externals, work.scratch.sites);
+    Result status;
+    auto ptr = unpack_subtree<Provisioner>(contents, entry->path, (parent ? &parent_path : nullptr), (parent ? parent->length : 0), etrack, options, work, status);
+    if (!status.ok()) {
+        throw_error(status);
+    }
+
+    if (!ptr && !etrack.sites.empty() && etrack.sites.back().list == nullptr) {
+        etrack.sites.back().slot = &ptr; // the subtree is a single deferred "other" object.
+    }
+    etrack.template resolve<Provisioner>(status);
+    if (!status.ok()) {
+        throw_error(status);
+    }
+    return ptr;
+}
+
+/**
+ * Parse a single subtree of a **uzuki** JSON file with default options.
+ *
+ * @tparam Provisioner A class namespace defining static methods for creating new `Base` objects, see `parse()`.
+ * This should not declare `lazy_values`, as the subtree contents are discarded on return.
+ * @tparam Json A [`nlohmann::json`](https://github.com/nlohmann/json)-compatible representation of JSON data.
+ * @tparam Externals Class describing how to resolve external references for type `OTHER`, see `parse()`.
+ *
+ * @param file Path to the JSON file.
+ * @param index Index of the JSON file.
+ * @param path Path to the subtree of interest.
+ * @param ext Instance of an external reference resolver class.
+ *
+ * @return Pointer to the `Base` object for the subtree.
+ */
+template<class Provisioner, class Json = nlohmann::json, class Externals>
+std::shared_ptr<Base> parse_at(const std::string& file, const FileIndex& index, const std::string& path, Externals ext) {
+    return parse_at<Provisioner, Json>(file, index, path, std::move(ext), Options());
+}
+
+}
+
+#endif
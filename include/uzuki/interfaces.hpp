@@ -140,6 +140,28 @@ struct TypedVector : public Vector {
      * @param v Value of the vector element.
      */
     virtual void set(size_t i, T v) = 0;
+
+    /**
+     * Optional destination for the vector elements, e.g., caller-owned or shared memory.
+     * If a non-null pointer is returned, each value is written directly to the `i`-th element of the buffer instead of calling `set()`.
+     * The buffer should have at least `size()` elements and remain valid until parsing is complete.
+     *
+     * @return Pointer to the buffer, or `NULL` to use `set()`.
+     */
+    virtual T* buffer() {
+        return nullptr;
+    }
+
+    /**
+     * Optional validity bitmap for the vector elements, only used if `buffer()` returns a non-null pointer.
+     * If a non-null pointer is returned, the `i`-th bit (least significant first) is set for each present element and cleared for each missing element, instead of calling `set_missing()`.
+     * The bitmap should have at least `ceil(size() / 8)` bytes.
+     *
+     * @return Pointer to the bitmap, or `NULL` to use `set_missing()`.
+     */
+    virtual unsigned char* validity() {
+        return nullptr;
+    }
 };
 
 /**
@@ -184,6 +206,19 @@ struct FactorBase {
      * If not called, it is assumed that the levels are unordered by default.
      */
     virtual void is_ordered() = 0;
+
+    /**
+     * Share the levels of the factor with other factors that have identical levels.
+     * This is only called when `Options::deduplicate = true`, before any calls to `set_level()`.
+     *
+     * @param levels Levels of the factor, which may be shared with other factors.
+     * @return Whether the levels were stored.
+     * If `false`, `set_level()` is called for each level instead.
+     */
+    virtual bool share_levels(const std::shared_ptr<const std::vector<std::string> >& levels) {
+        (void)levels;
+        return false;
+    }
 };
 
 /**
@@ -236,6 +271,7 @@ struct Array : public Base {
      * @param i Index of the element in the multi-dimensional array (see `set()`) to be marked as missing.
      * Indices should be computed by treating the array as a contiguous 1-dimensional vector,
      * where the first dimension is the fastest-changing, followed by the second, etc.
+     * This is reversed if the `Provisioner` requests row-major order, see `parse()` for details.
      */
     virtual void set_missing(size_t i) = 0;
 };
@@ -258,9 +294,31 @@ struct TypedArray : public Array {
      * @param i Index of the element in the multi-dimensional array.
      * Indices should be computed by treating the array as a contiguous 1-dimensional vector,
      * where the first dimension is the fastest-changing, followed by the second, etc.
+     * This is reversed if the `Provisioner` requests row-major order, see `parse()` for details.
      * @param v Value of the array element.
      */
     virtual void set(size_t i, T v) = 0;
+
+    /**
+     * Optional destination for the array elements, e.g., caller-owned or shared memory.
+     * If a non-null pointer is returned, each value is written directly to the `i`-th element of the buffer (see `set()`) instead of calling `set()`.
+     * The buffer should have at least as many elements as the product of the dimensions and remain valid until parsing is complete.
+     *
+     * @return Pointer to the buffer, or `NULL` to use `set()`.
+     */
+    virtual T* buffer() {
+        return nullptr;
+    }
+
+    /**
+     * Optional validity bitmap for the array elements, only used if `buffer()` returns a non-null pointer.
+     * If a non-null pointer is returned, the `i`-th bit (least significant first) is set for each present element and cleared for each missing element, instead of calling `set_missing()`.
+     *
+     * @return Pointer to the bitmap, or `NULL` to use `set_missing()`.
+     */
+    virtual unsigned char* validity() {
+        return nullptr;
+    }
 };
 
 /**
@@ -300,6 +358,7 @@ struct FactorArray : public Array, public FactorBase {
      * @param i Index of the element in the multi-dimensional array.
      * Indices should be computed by treating the array as a contiguous 1-dimensional vector,
      * where the first dimension is the fastest-changing, followed by the second, etc.
+     * This is reversed if the `Provisioner` requests row-major order, see `parse()` for details.
      * @param v Value of the array element, as an integer code that references the levels.
      */
     virtual void set(size_t i, size_t v) = 0;
@@ -0,0 +1,375 @@
+#ifndef UZUKI_LAZY_HPP
+#define UZUKI_LAZY_HPP
+
+#include "interfaces.hpp"
+#include "unpack.hpp"
+
+#include <vector>
+#include <string>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <algorithm>
+#include <stdexcept>
+
+/**
+ * @file lazy.hpp
+ *
+ * @brief Vectors and arrays that defer decoding of their values until first access.
+ */
+
+namespace uzuki {
+
+/**
+ * @cond
+ */
+namespace lazy {
+
+template<Type tt>
+struct Decoder;
+
+// Decoding happens on access, long after parsing has returned, so failures can only be thrown.
+template<class Function>
+auto checked(Function convert) {
+    Result status;
+    auto output = convert(status);
+    if (!status.ok()) {
+        throw_error(status);
+    }
+    return output;
+}
+
+template<>
+struct Decoder<STRING> {
+    template<class Json>
+    static std::string decode(const Json& x, size_t i, const std::string& sofar) { return checked([&](Result& status) { return convert_string(x, i, sofar, status); }); }
+};
+
+template<>
+struct Decoder<DATE> {
+    template<class Json>
+    static std::string decode(const Json& x, size_t i, const std::string& sofar) { return checked([&](Result& status) { return convert_date(x, i, sofar, status); }); }
+};
+
+template<>
+struct Decoder<INTEGER> {
+    template<class Json>
+    static int32_t decode(const Json& x, size_t i, const std::string& sofar) { return checked([&](Result& status) { return convert_integer(x, i, sofar, status); }); }
+};
+
+template<>
+struct Decoder<NUMBER> {
+    template<class Json>
+    static double decode(const Json& x, size_t i, const std::string& sofar) { return checked([&](Result& status) { return convert_number(x, i, sofar, status); }); }
+};
+
+template<>
+struct Decoder<BOOLEAN> {
+    template<class Json>
+    static unsigned char decode(const Json& x, size_t i, const std::string& sofar) { return checked([&](Result& status) { return convert_boolean(x, i, sofar, status); }); }
+};
+
+template<> struct Decoder<STRING_ARRAY> : public Decoder<STRING> {};
+template<> struct Decoder<DATE_ARRAY> : public Decoder<DATE> {};
+template<> struct Decoder<INTEGER_ARRAY> : public Decoder<INTEGER> {};
+template<> struct Decoder<NUMBER_ARRAY> : public Decoder<NUMBER> {};
+template<> struct Decoder<BOOLEAN_ARRAY> : public Decoder<BOOLEAN> {};
+
+}
+/**
+ * @endcond
+ */
+
+/**
+ * @brief Chunked storage of lazily decoded values.
+ *
+ * Once bound to the `values` of a vector or array in the JSON document, each chunk of values is only decoded on its first access.
+ * Decoding is thread-safe, i.e., multiple threads can call `get()` and `is_missing()` concurrently and each chunk will only be decoded once.
+ * If nothing is bound (e.g., for the "sequence" encoding or for base64-encoded values), values are stored directly via `set()` and `set_missing()`.
+ *
+ * The JSON document must outlive this object if any values are bound.
+ * If validation was deferred during parsing, `get()` and `is_missing()` will throw an error upon decoding a chunk with invalid values.
+ *
+ * @tparam T Type of the decoded values.
+ * @tparam tt `Type` of the vector or array, used to choose the decoder.
+ * @tparam Json A [`nlohmann::json`](https://github.com/nlohmann/json)-compatible representation of JSON data.
+ */
+template<typename T, Type tt, class Json>
+class LazyValues {
+public:
+    /**
+     * @param n Number of values.
+     * @param chunk Number of values in each chunk.
+     */
+    LazyValues(size_t n, size_t chunk = 4096) : len(n), chunk_size(std::max(chunk, static_cast<size_t>(1))), nchunks((n + chunk_size - 1) / chunk_size), chunks(new Chunk[nchunks]) {}
+
+    /**
+     * @return Number of values.
+     */
+    size_t size() const {
+        return len;
+    }
+
+    /**
+     * Bind values from the JSON document for later decoding.
+     * This is called by `parse()` when the `Provisioner` declares `lazy_values`.
+     *
+     * @param values Pointer to the JSON array of values.
+     * @param lengths Pointer to the run lengths for "rle" encoding, or `NULL` otherwise.
+     * @param sofar Path to the object, for error messages.
+     */
+    void bind(const Json* values, const std::vector<size_t>* lengths, const std::string& sofar) {
+        source = values;
+        path = sofar;
+        if (lengths) {
+            ends.resize(lengths->size());
+            size_t total = 0;
+            for (size_t r = 0; r < ends.size(); ++r) {
+                total += (*lengths)[r];
+                ends[r] = total;
+            }
+        }
+    }
+
+    /**
+     * @param i Index of the value.
+     * @param v Value to store directly.
+     */
+    void set(size_t i, T v) {
+        auto& current = prepare(i / chunk_size);
+        current.values[i % chunk_size] = std::move(v);
+    }
+
+    /**
+     * @param i Index of the missing value.
+     */
+    void set_missing(size_t i) {
+        auto& current = prepare(i / chunk_size);
+        current.missing[i % chunk_size] = 1;
+    }
+
+    /**
+     * @param i Index of the value.
+     * @return The value, decoding its chunk if necessary.
+     * This is a default-constructed `T` for missing values.
+     */
+    const T& get(size_t i) const {
+        const auto& current = load(i / chunk_size);
+        return current.values[i % chunk_size];
+    }
+
+    /**
+     * @param i Index of the value.
+     * @return Whether the value is missing, decoding its chunk if necessary.
+     */
+    bool is_missing(size_t i) const {
+        const auto& current = load(i / chunk_size);
+        return current.missing[i % chunk_size];
+    }
+
+    /**
+     * @return Number of chunks that have been materialized.
+     */
+    size_t loaded_chunks() const {
+        return loaded.load();
+    }
+
+private:
+    struct Chunk {
+        std::once_flag once;
+        std::vector<T> values;
+        std::vector<unsigned char> missing;
+    };
+
+    size_t len;
+    size_t chunk_size;
+    size_t nchunks;
+    std::unique_ptr<Chunk[]> chunks;
+    mutable std::atomic<size_t> loaded{0};
+
+    const Json* source = nullptr;
+    std::vector<size_t> ends;
+    std::string path;
+
+    size_t chunk_length(size_t c) const {
+        return std::min(chunk_size, len - c * chunk_size);
+    }
+
+    Chunk& prepare(size_t c) {
+        auto& current = chunks[c];
+        if (current.values.empty()) {
+            size_t n = chunk_length(c);
+            current.values.resize(n);
+            current.missing.resize(n);
+            ++loaded;
+        }
+        return current;
+    }
+
+    const Chunk& load(size_t c) const {
+        auto& current = chunks[c];
+        if (source) {
+            std::call_once(current.once, [&]() -> void { decode(c, current); });
+        }
+        return current;
+    }
+
+    void decode(size_t c, Chunk& current) const {
+        size_t start = c * chunk_size, n = chunk_length(c);
+        std::vector<T> values(n);
+        std::vector<unsigned char> missing(n);
+
+        if (ends.empty()) {
+            for (size_t i = 0; i < n; ++i) {
+                const auto& x = (*source)[start + i];
+                if (x.is_null()) {
+                    missing[i] = 1;
+                } else {
+                    values[i] = lazy::Decoder<tt>::decode(x, start + i, path);
+                }
+            }
+
+        } else {
+            // Each run value is only decoded once per chunk, regardless of the run length.
+            size_t r = std::upper_bound(ends.begin(), ends.end(), start) - ends.begin();
+            size_t i = 0;
+            while (i < n) {
+                size_t end = std::min(ends[r] - start, n);
+                const auto& x = (*source)[r];
+                if (x.is_null()) {
+                    std::fill(missing.begin() + i, missing.begin() + end, 1);
+                } else {
+                    std::fill(values.begin() + i, values.begin() + end, lazy::Decoder<tt>::decode(x, r, path));
+                }
+                i = end;
+                ++r;
+            }
+        }
+
+        // Only publishing the chunk once decoding succeeds, so that a failed call_once can be retried.
+        current.values.swap(values);
+        current.missing.swap(missing);
+        ++loaded;
+    }
+};
+
+/**
+ * @brief Vector that defers decoding of its values until first access.
+ *
+ * This is intended for use in a `Provisioner` that declares `static constexpr bool lazy_values = true`,
+ * see `parse()` for details.
+ *
+ * @tparam T Type of the decoded values.
+ * @tparam tt `Type` of the vector.
+ * @tparam Json A [`nlohmann::json`](https://github.com/nlohmann/json)-compatible representation of JSON data.
+ */
+template<typename T, Type tt, class Json>
+struct LazyVector : public TypedVector<T, tt> {
+    /**
+     * @param l Length of the vector.
+     * @param chunk Number of values in each chunk.
+     */
+    LazyVector(size_t l, size_t chunk = 4096) : values(l, chunk) {}
+
+    /**
+     * @cond
+     */
+    size_t size() const { return values.size(); }
+
+    void set(size_t i, T v) { values.set(i, std::move(v)); }
+
+    void set_missing(size_t i) { values.set_missing(i); }
+
+    void use_names() {
+        has_names = true;
+        names.resize(values.size());
+    }
+
+    void set_name(size_t i, std::string n) { names[i] = std::move(n); }
+
+    void bind(const Json* v, const std::vector<size_t>* l, const std::string& sofar) { values.bind(v, l, sofar); }
+    /**
+     * @endcond
+     */
+
+    /**
+     * Lazily decoded values of the vector.
+     */
+    LazyValues<T, tt, Json> values;
+
+    /**
+     * Whether the vector is named.
+     */
+    bool has_names = false;
+
+    /**
+     * Names of the vector elements, if `has_names = true`.
+     */
+    std::vector<std::string> names;
+};
+
+/**
+ * @brief Array that defers decoding of its values until first access.
+ *
+ * This is intended for use in a `Provisioner` that declares `static constexpr bool lazy_values = true`,
+ * see `parse()` for details.
+ *
+ * @tparam T Type of the decoded values.
+ * @tparam tt `Type` of the array.
+ * @tparam Json A [`nlohmann::json`](https://github.com/nlohmann/json)-compatible representation of JSON data.
+ */
+template<typename T, Type tt, class Json>
+struct LazyArray : public TypedArray<T, tt> {
+    /**
+     * @param d Dimensions of the array.
+     * @param chunk Number of values in each chunk.
+     */
+    LazyArray(std::vector<size_t> d, size_t chunk = 4096) : dimensions(std::move(d)), values(product(dimensions), chunk), names(dimensions.size()) {}
+
+    /**
+     * @cond
+     */
+    size_t first_dim() const { return dimensions.front(); }
+
+    void set(size_t i, T v) { values.set(i, std::move(v)); }
+
+    void set_missing(size_t i) { values.set_missing(i); }
+
+    void use_names(size_t d) { names[d].resize(dimensions[d]); }
+
+    void set_name(size_t d, size_t i, std::string n) { names[d][i] = std::move(n); }
+
+    void bind(const Json* v, const std::vector<size_t>* l, const std::string& sofar) { values.bind(v, l, sofar); }
+    /**
+     * @endcond
+     */
+
+    /**
+     * Dimensions of the array.
+     */
+    std::vector<size_t> dimensions;
+
+    /**
+     * Lazily decoded values of the array, in column-major order.
+     */
+    LazyValues<T, tt, Json> values;
+
+    /**
+     * Names for each dimension.
+     * Each entry is empty if the corresponding dimension is unnamed.
+     */
+    std::vector<std::vector<std::string> > names;
+
+private:
+    static size_t product(const std::vector<size_t>& d) {
+        size_t prod = 1;
+        for (auto x : d) {
+            prod *= x;
+        }
+        return prod;
+    }
+};
+
+}
+
+#endif
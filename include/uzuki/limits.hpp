@@ -0,0 +1,308 @@
+#ifndef UZUKI_LIMITS_HPP
+#define UZUKI_LIMITS_HPP
+
+#include <string>
+#include <vector>
+#include <utility>
+#include <limits>
+#include <algorithm>
+#include <cstdint>
+#include <cmath>
+
+/**
+ * @file limits.hpp
+ *
+ * @brief Resource limits and cost estimation for untrusted documents.
+ */
+
+namespace uzuki {
+
+/**
+ * @brief Resource limits to enforce during parsing.
+ *
+ * These limits are checked during the traversal, before the relevant objects are created by the `Provisioner`,
+ * so that hostile documents can be rejected before they cause excessive memory allocations.
+ * All limits are unbounded by default.
+ */
+struct Limits {
+    /**
+     * Maximum nesting depth of lists.
+     * The top-level list has a depth of 1.
+     */
+    size_t max_depth = std::numeric_limits<size_t>::max();
+
+    /**
+     * Maximum total number of elements across all vectors, arrays and lists in the document.
+     * For encoded vectors and arrays, this considers the number of elements after decoding.
+     */
+    size_t max_total_elements = std::numeric_limits<size_t>::max();
+
+    /**
+     * Maximum total number of bytes across all strings that are passed to the `Provisioner`,
+     * i.e., string and date values, names and factor levels.
+     */
+    size_t max_string_bytes = std::numeric_limits<size_t>::max();
+
+    /**
+     * Maximum number of elements to allocate for a single object, 
+     * i.e., the length of a vector or list, the product of the dimensions of an array, or the number of rows of a data frame.
+     */
+    size_t max_node_elements = std::numeric_limits<size_t>::max();
+
+    /**
+     * Maximum number of levels for a single factor.
+     */
+    size_t max_factor_levels = std::numeric_limits<size_t>::max();
+};
+
+/**
+ * @brief Estimated cost of materializing a document.
+ */
+struct Cost {
+    /**
+     * Number of objects, i.e., lists, vectors, arrays, data frames and others.
+     */
+    size_t nodes = 0;
+
+    /**
+     * Maximum nesting depth of lists.
+     */
+    size_t depth = 0;
+
+    /**
+     * Total number of elements across all vectors, arrays and lists, after decoding.
+     */
+    size_t elements = 0;
+
+    /**
+     * Total number of bytes across all strings in values, names and levels, after decoding.
+     */
+    size_t string_bytes = 0;
+
+    /**
+     * Estimated number of bytes required to hold the materialized result.
+     * This assumes that each element is stored contiguously with its natural type
+     * (`int32_t` for integers, `double` for numbers, `unsigned char` for booleans, `size_t` for factor codes, `std::string` for strings and dates),
+     * along with a fixed overhead for each object.
+     */
+    size_t bytes = 0;
+};
+
+/**
+ * @cond
+ */
+namespace cost {
+
+constexpr size_t node_overhead = 64;
+
+inline size_t saturating_add(size_t a, size_t b) {
+    return (b > std::numeric_limits<size_t>::max() - a ? std::numeric_limits<size_t>::max() : a + b);
+}
+
+inline size_t saturating_mult(size_t a, size_t b) {
+    return (a && b > std::numeric_limits<size_t>::max() / a ? std::numeric_limits<size_t>::max() : a * b);
+}
+
+inline size_t to_count(double val) {
+    if (!(val >= 0)) {
+        return 0;
+    } else if (val >= static_cast<double>(std::numeric_limits<size_t>::max())) {
+        return std::numeric_limits<size_t>::max();
+    }
+    return val;
+}
+
+template<class Json>
+size_t string_bytes(const Json& x) {
+    size_t total = 0;
+    if (x.is_array()) {
+        for (const auto& y : x) {
+            if (y.is_string()) {
+                total = saturating_add(total, y.template get_ref<const typename Json::string_t&>().size());
+            }
+        }
+    }
+    return total;
+}
+
+inline size_t element_size(const std::string& type) {
+    if (type == "integer") {
+        return sizeof(int32_t);
+    } else if (type == "number") {
+        return sizeof(double);
+    } else if (type == "boolean") {
+        return 1;
+    } else if (type == "factor" || type == "ordered") {
+        return sizeof(size_t);
+    }
+    return sizeof(std::string);
+}
+
+template<class Json>
+void simple_object(const std::string& type, const Json& j, Cost& output) {
+    std::string encoding;
+    auto eIt = j.find("encoding");
+    if (eIt != j.end() && eIt->is_string()) {
+        encoding = eIt->template get<std::string>();
+    }
+    auto vIt = j.find("values");
+    bool is_string = (type == "string" || type == "date");
+
+    size_t len = 0, strbytes = 0;
+    if (encoding == "sequence") {
+        auto lIt = j.find("length");
+        if (lIt != j.end() && lIt->is_number()) {
+            len = to_count(lIt->template get<double>());
+        }
+
+    } else if (encoding == "base64") {
+        if (vIt != j.end() && vIt->is_string()) {
+            size_t width = (type == "number" ? sizeof(double) : (type == "integer" ? sizeof(int32_t) : 1));
+            len = vIt->template get_ref<const typename Json::string_t&>().size() / 4 * 3 / width;
+        }
+
+    } else if (encoding == "rle") {
+        auto rIt = j.find("lengths");
+        if (rIt != j.end() && rIt->is_array() && vIt != j.end() && vIt->is_array()) {
+            for (size_t r = 0, end = std::min(rIt->size(), vIt->size()); r < end; ++r) {
+                const auto& l = (*rIt)[r];
+                if (!l.is_number()) {
+                    continue;
+                }
+                size_t runlen = to_count(l.template get<double>());
+                len = saturating_add(len, runlen);
+                const auto& v = (*vIt)[r];
+                if (is_string && v.is_string()) {
+                    strbytes = saturating_add(strbytes, saturating_mult(runlen, v.template get_ref<const typename Json::string_t&>().size()));
+                }
+            }
+        }
+
+    } else if (vIt != j.end()) {
+        const auto& values = (vIt->is_object() && vIt->contains("_ArrayData_") ? (*vIt)["_ArrayData_"] : *vIt);
+        if (values.is_array()) {
+            len = values.size();
+            if (is_string) {
+                strbytes = string_bytes(values);
+            }
+        }
+    }
+
+    auto nIt = j.find("names");
+    if (nIt != j.end() && nIt->is_array()) {
+        size_t nbytes = 0, nnames = 0;
+        if (j.contains("dimensions")) {
+            for (const auto& dn : *nIt) {
+                nbytes = saturating_add(nbytes, string_bytes(dn));
+                nnames += (dn.is_array() ? dn.size() : 0);
+            }
+        } else {
+            nbytes = string_bytes(*nIt);
+            nnames = nIt->size();
+        }
+        strbytes = saturating_add(strbytes, nbytes);
+        output.bytes = saturating_add(output.bytes, saturating_mult(nnames, sizeof(std::string)));
+    }
+
+    if (type == "factor" || type == "ordered") {
+        auto lIt = j.find("levels");
+        if (lIt != j.end() && lIt->is_array()) {
+            strbytes = saturating_add(strbytes, string_bytes(*lIt));
+            output.bytes = saturating_add(output.bytes, saturating_mult(lIt->size(), sizeof(std::string)));
+        }
+    }
+
+    output.elements = saturating_add(output.elements, len);
+    output.string_bytes = saturating_add(output.string_bytes, strbytes);
+    output.bytes = saturating_add(output.bytes, saturating_add(saturating_mult(len, element_size(type)), strbytes));
+}
+
+template<class Json>
+void estimate(const Json& root, Cost& output) {
+    // Using an explicit stack so that deeply nested documents do not overflow the call stack.
+    std::vector<std::pair<const Json*, size_t> > pending;
+    pending.emplace_back(&root, 0);
+
+    while (!pending.empty()) {
+        const Json& j = *(pending.back().first);
+        size_t depth = pending.back().second;
+        pending.pop_back();
+
+        output.nodes = saturating_add(output.nodes, 1);
+        output.bytes = saturating_add(output.bytes, node_overhead);
+
+        if (j.is_object()) {
+            auto tIt = j.find("type");
+            if (tIt != j.end() && tIt->is_string()) {
+                const auto& type = tIt->template get_ref<const typename Json::string_t&>();
+                if (type == "data.frame") {
+                    auto cIt = j.find("columns");
+                    if (cIt != j.end() && cIt->is_object()) {
+                        for (const auto& x : cIt->items()) {
+                            const auto& col = x.value();
+                            auto ctIt = col.find("type");
+                            if (ctIt != col.end() && ctIt->is_string()) {
+                                output.nodes = saturating_add(output.nodes, 1);
+                                output.bytes = saturating_add(output.bytes, node_overhead + sizeof(std::string) + x.key().size());
+                                simple_object(ctIt->template get<std::string>(), col, output);
+                            }
+                        }
+                    }
+                    auto nIt = j.find("names");
+                    if (nIt != j.end()) {
+                        size_t nbytes = string_bytes(*nIt);
+                        output.string_bytes = saturating_add(output.string_bytes, nbytes);
+                        output.bytes = saturating_add(output.bytes, saturating_add(saturating_mult(nIt->size(), sizeof(std::string)), nbytes));
+                    }
+                } else if (type != "other" && type != "nothing") {
+                    simple_object(type, j, output);
+                }
+                continue;
+            }
+        }
+
+        if (j.is_array() || j.is_object()) {
+            output.depth = std::max(output.depth, depth + 1);
+            output.elements = saturating_add(output.elements, j.size());
+            output.bytes = saturating_add(output.bytes, saturating_mult(j.size(), sizeof(void*) * 2));
+            if (j.is_object()) {
+                for (const auto& x : j.items()) {
+                    output.string_bytes = saturating_add(output.string_bytes, x.key().size());
+                    output.bytes = saturating_add(output.bytes, sizeof(std::string) + x.key().size());
+                    pending.emplace_back(&(x.value()), depth + 1);
+                }
+            } else {
+                for (const auto& x : j) {
+                    pending.emplace_back(&x, depth + 1);
+                }
+            }
+        }
+    }
+}
+
+}
+/**
+ * @endcond
+ */
+
+/**
+ * Estimate the cost of materializing a document, without performing any validation or calling a `Provisioner`.
+ * This only inspects the lengths of arrays and strings, so it is much cheaper than a full `parse()`.
+ * It can be used to decide whether a document should be parsed at all, or where to schedule the parsing.
+ * Invalid content is skipped rather than reported, so the estimate may be inaccurate for invalid documents.
+ *
+ * @tparam Json A [`nlohmann::json`](https://github.com/nlohmann/json)-compatible representation of JSON data.
+ * @param contents Parsed contents of the JSON file.
+ *
+ * @return The estimated cost.
+ */
+template<class Json>
+Cost estimate_cost(const Json& contents) {
+    Cost output;
+    cost::estimate(contents, output);
+    return output;
+}
+
+}
+
+#endif
@@ -0,0 +1,58 @@
+#ifndef UZUKI_OPTIONS_HPP
+#define UZUKI_OPTIONS_HPP
+
+#include "fingerprint.hpp"
+#include "limits.hpp"
+#include "projection.hpp"
+#include "statistics.hpp"
+
+/**
+ * @file options.hpp
+ *
+ * @brief Options for parsing and validation.
+ */
+
+namespace uzuki {
+
+/**
+ * @brief Options for parsing and validation.
+ */
+struct Options {
+    /**
+     * Side table in which to store the structural fingerprints of the document and each of its nodes.
+     * These are computed in the same traversal used for parsing, see `Fingerprints` for details.
+     * If `NULL`, no fingerprints are computed.
+     */
+    Fingerprints* fingerprints = nullptr;
+
+    /**
+     * Side table in which to store summary statistics for each vector, array and factor.
+     * These are computed while each value is converted, see `Statistics` for details.
+     * If `NULL`, no statistics are computed.
+     */
+    Statistics* statistics = nullptr;
+
+    /**
+     * Whether to share a single node between identical vectors, arrays and factors.
+     * Each such object is hashed, and if it is identical to a previously parsed object, the previous node is returned instead of provisioning a new one.
+     * Identical subtrees are also only validated once, though they are not counted towards the `limits` after their first occurrence.
+     * Factors with identical levels are given the same level table via `FactorBase::share_levels()`.
+     */
+    bool deduplicate = false;
+
+    /**
+     * Resource limits to enforce during parsing.
+     * Violations will cause an error to be thrown.
+     */
+    Limits limits;
+
+    /**
+     * Subtrees to be materialized by the `Provisioner`, see `Projection` for details.
+     * By default, the entire document is materialized.
+     */
+    Projection projection;
+};
+
+}
+
+#endif
@@ -3,11 +3,14 @@
 
 #include <vector>
 #include <memory>
-#include <algorithm>
+#include <string>
+#include <utility>
+#include <type_traits>
 #include <cstdint>
 #include <limits>
 
 #include "unpack.hpp"
+#include "error.hpp"
 #include "Dummy.hpp"
 
 /**
@@ -21,36 +24,180 @@ namespace uzuki {
 /**
  * @cond
  */
+template<class E, typename = void>
+struct has_get_batch : std::false_type {};
+
+template<class E>
+struct has_get_batch<E, decltype(static_cast<void>(std::declval<E&>().get_batch(std::declval<const std::vector<size_t>&>())))> : std::true_type {};
+
+template<class E, typename = void>
+struct has_get_async : std::false_type {};
+
+template<class E>
+struct has_get_async<E, decltype(static_cast<void>(std::declval<E&>().get_async(std::declval<size_t>())))> : std::true_type {};
+
 template<class CustomExternals>
 struct ExternalTracker {
-    ExternalTracker(CustomExternals e) : getter(std::move(e)) {}
+    ExternalTracker(CustomExternals e, ExternalIndices& store, std::vector<ExternalSite>& s) : getter(std::move(e)), indices(store), sites(s) {
+        indices.clear();
+        sites.clear();
+    }
+
+    static constexpr bool deferred = has_get_batch<CustomExternals>::value || has_get_async<CustomExternals>::value;
+
+    bool record(size_t i, const std::string& sofar, Result& status) {
+        if (!indices.add(i)) {
+            return status.fail(ErrorCode::DUPLICATE_EXTERNAL, sofar + ".index", "\"%p\" for type \"other\" is duplicated (%i)", i);
+        }
+        return true;
+    }
 
-    void* operator()(size_t i) {
-        indices.push_back(i);
+    void* get(size_t i, const std::string& sofar, Result& status) {
+        if (!record(i, sofar, status)) {
+            return nullptr;
+        }
+        return get(i, std::integral_constant<bool, deferred>());
+    }
+
+    void* get(size_t i, std::false_type) {
         return getter.get(i);
-    };
+    }
+
+    void* get(size_t i, std::true_type) {
+        sites.push_back(ExternalSite{ nullptr, 0, i, nullptr });
+        return nullptr;
+    }
+
+    // Called by the traversal once the parent list of the latest deferred site is known.
+    void place(List* list, size_t position) {
+        auto& last = sites.back();
+        last.list = list;
+        last.position = position;
+    }
 
     size_t size() const {
         return getter.size();
     }
 
+    template<class Provisioner>
+    void resolve(Result& status) {
+        if (!sites.empty()) {
+            resolve<Provisioner>(status, has_get_batch<CustomExternals>(), has_get_async<CustomExternals>());
+        }
+    }
+
+    template<class Provisioner, class Async>
+    void resolve(Result& status, std::true_type, Async) {
+        std::vector<size_t> requested;
+        requested.reserve(sites.size());
+        for (const auto& s : sites) {
+            requested.push_back(s.index);
+        }
+
+        auto resolved = getter.get_batch(requested);
+        if (resolved.size() != sites.size()) {
+            status.fail(ErrorCode::UNKNOWN, "", "batched retrieval of external references should return %n objects", Result::no_index, sites.size());
+            return;
+        }
+        for (size_t s = 0; s < sites.size(); ++s) {
+            fill(sites[s], std::shared_ptr<Base>(Provisioner::new_Other(resolved[s])));
+        }
+    }
+
+    template<class Provisioner>
+    void resolve(Result&, std::false_type, std::true_type) {
+        // Launching all requests before waiting on any of them.
+        std::vector<decltype(getter.get_async(0))> futures;
+        futures.reserve(sites.size());
+        for (const auto& s : sites) {
+            futures.push_back(getter.get_async(s.index));
+        }
+        for (size_t s = 0; s < sites.size(); ++s) {
+            fill(sites[s], std::shared_ptr<Base>(Provisioner::new_Other(futures[s].get())));
+        }
+    }
+
+    static void fill(ExternalSite& site, std::shared_ptr<Base> ptr) {
+        if (site.list) {
+            site.list->set(site.position, std::move(ptr));
+        } else {
+            *(site.slot) = std::move(ptr);
+        }
+    }
+
+    template<class Provisioner>
+    void resolve(Result&, std::false_type, std::false_type) {}
+
     CustomExternals getter;
-    std::vector<size_t> indices;
+    ExternalIndices& indices;
+    std::vector<ExternalSite>& sites;
 };
 
-inline void check_external_indices(std::vector<size_t>& other_indices) {
-    std::sort(other_indices.begin(), other_indices.end());
-    int nother = other_indices.size();
-    for (int i = 0; i < nother; ++i) {
-        if (i != other_indices[i]) {
-            throw std::runtime_error("set of \"index\" values for type \"other\" should be consecutive starting from zero");
+// Failures are reported in 'status', in which case the returned pointer is null.
+template<class Provisioner, class Json, class Externals>
+std::shared_ptr<Base> parse(const Json& contents, Externals ext, const Options& options, Workspace<Json>& work, Result& status, bool consume = false) {
+    ExternalTracker<Externals> etrack(ext, work.scratch.externals, work.scratch.sites);
+    auto ptr = unpack<Provisioner>(contents, etrack, options, work, status, consume);
+    if (!status.ok()) {
+        return nullptr;
+    }
+
+    // Checking that the external indices match up, unless we skipped some of them.
+    if (options.projection.paths.empty() || !options.projection.trust) {
+        if (!etrack.indices.check_deferred(status)) {
+            return nullptr;
+        }
+        if (etrack.indices.count != ext.size()) {
+            status.fail(ErrorCode::EXTERNAL_COUNT, "", "fewer instances of type \"other\" than expected (%n)", Result::no_index, ext.size());
+            return nullptr;
+        }
+        if (!etrack.indices.finish(status)) {
+            return nullptr;
         }
     }
+
+    etrack.template resolve<Provisioner>(status);
+    if (!status.ok()) {
+        return nullptr;
+    }
+    return ptr;
+}
+
+template<class Provisioner, class Json, class Externals>
+std::shared_ptr<Base> parse(const Json& contents, Externals ext, const Options& options, Workspace<Json>& work, bool consume = false) {
+    Result status;
+    auto ptr = parse<Provisioner>(contents, std::move(ext), options, work, status, consume);
+    if (!status.ok()) {
+        throw_error(status);
+    }
+    return ptr;
 }
 /**
  * @endcond
  */
 
+/**
+ * Parse JSON file contents using the **uzuki** specification with additional options.
+ *
+ * @tparam Provisioner A class namespace defining static methods for creating new `Base` objects, see below for details.
+ * @tparam Json A [`nlohmann::json`](https://github.com/nlohmann/json)-compatible representation of JSON data.
+ * @tparam Externals Class describing how to resolve external references for type `OTHER`, see below for details.
+ *
+ * @param contents Parsed contents of the JSON file.
+ * @param ext Instance of an external reference resolver class.
+ * @param options Further options for parsing.
+ *
+ * @return Pointer to the root `Base` object.
+ * Depending on `Provisioner`, this may contain references to all nested objects. 
+ * 
+ * Any invalid representations in `contents` will cause an error to be thrown.
+ */
+template<class Provisioner, class Json, class Externals>
+std::shared_ptr<Base> parse(const Json& contents, Externals ext, const Options& options) {
+    Workspace<Json> work;
+    return parse<Provisioner>(contents, std::move(ext), options, work);
+}
+
 /**
  * Parse JSON file contents using the **uzuki** specification.
  *
@@ -86,7 +233,35 @@ inline void check_external_indices(std::vector<size_t>& other_indices) {
  * - `StringArray* new_String(std::vector<size_t> d)`, which returns a new instance of a `StringArray` subclass of dimensions `d`.
  * - `BooleanArray* new_Boolean(std::vector<size_t> d)`, which returns a new instance of a `BooleanArray` subclass of dimensions `d`.
  * - `DateArray* new_Date(std::vector<size_t> d)`, which returns a new instance of a `DateArray` subclass of dimensions `d`.
- * - `FactorArray* new_Factor(std::vector<size_t> d, std::vector<size_t> dl)`, which returns a new instance of a `FactorArray` subclass of dimensions `d` and with `ll` unique levels.
+ * - `FactorArray* new_Factor(std::vector<size_t> d, size_t ll)`, which returns a new instance of a `FactorArray` subclass of dimensions `d` and with `ll` unique levels.
+ *
+ * As the number of levels is known before any factor codes are set, a `Provisioner` can use it to choose a narrow storage type for the codes, see `CompactFactor` for an example.
+ *
+ * The `Provisioner` may optionally provide any of the following methods for vectors of length 1 with a non-missing value, i.e., R's "scalars":
+ *
+ * - `IntegerVector* new_IntegerScalar(int32_t v)`
+ * - `NumberVector* new_NumberScalar(double v)`
+ * - `StringVector* new_StringScalar(std::string v)`
+ * - `BooleanVector* new_BooleanScalar(unsigned char v)`
+ * - `DateVector* new_DateScalar(std::string v)`
+ *
+ * Each of these returns a new instance of the corresponding subclass of length 1 with `v` as its only value, and is called instead of the usual `new_*` method followed by `set()`.
+ * This allows the value to be stored inline, see `ScalarVector` for an example.
+ * Names are still set by `use_names()` and `set_name()` on the returned instance.
+ * These methods are not used for arrays, factors or non-default encodings.
+ *
+ * The `Provisioner` may declare `static constexpr bool row_major = true` to receive the values of multi-dimensional arrays in row-major order.
+ * In that case, the index passed to `set()` and `set_missing()` treats the array as a contiguous 1-dimensional vector where the last dimension is the fastest-changing,
+ * e.g., for C or NumPy consumers; the dimensions and their names are otherwise unchanged.
+ * Values are transposed from the column-major order of the document in cache-friendly blocks, which requires a temporary copy of each array.
+ * This cannot be combined with `skip_values` or `lazy_values`.
+ *
+ * The `Provisioner` may also declare `static constexpr bool lazy_values = true` to defer decoding of the `values` of non-factor vectors and arrays.
+ * In that case, the corresponding `new_*` methods should return pointers to classes with a `bind(const Json* values, const std::vector<size_t>* lengths, const std::string& path)` method,
+ * which is called instead of `set()` and `set_missing()` with a pointer to the `values` in `contents` and the run lengths for "rle" encoding (or `NULL`).
+ * The values are still validated before binding unless the `Provisioner` also declares `static constexpr bool defer_validation = true`.
+ * Sequences and base64-encoded values are always filled by `set()` and `set_missing()`.
+ * See `LazyVector` and `LazyArray` for suitable implementations, which require `contents` to outlive the returned objects.
  *
  * @section external-contract Externals requirements
  * The `Externals` class is expected to provide the following `const` methods:
@@ -94,19 +269,20 @@ inline void check_external_indices(std::vector<size_t>& other_indices) {
  * - `void* get(size_t i)`, which returns a pointer to an "other" object, given the index of that object.
  *   This will be stored in the corresponding `Other` subclass generated by `Provisioner::new_Other`.
  * - `size_t size()`, which returns the number of available external references.
+ *
+ * Optionally, the `Externals` class may provide one of the following methods to resolve all references at once, e.g., to load them in parallel:
+ *
+ * - `std::vector<void*> get_batch(const std::vector<size_t>& indices)`, which returns a vector of pointers to the "other" objects for all `indices`.
+ *   This is called once after the entire document has been validated, and takes precedence over `get()` and `get_async()`.
+ * - `F get_async(size_t i)`, which returns a future-like object `F` (e.g., `std::future<void*>`) with a `get()` method that returns a pointer to the "other" object for index `i`.
+ *   All requests are launched after the document has been validated, before waiting on any of them.
+ *
+ * In both cases, `Provisioner::new_Other` is only called after resolution and the resulting objects are then inserted into their parent lists via `List::set()`.
+ * The `get()` method is not required if either of these methods are available.
  */
 template<class Provisioner, class Json, class Externals>
 std::shared_ptr<Base> parse(const Json& contents, Externals ext) {
-    ExternalTracker etrack(ext);
-    auto ptr = unpack<Provisioner>(contents, etrack);
-
-    // Checking that the external indices match up.
-    if (etrack.indices.size() != ext.size()) {
-        throw std::runtime_error("fewer instances of type \"other\" than expected (" + std::to_string(ext.size()) + ")");
-    }
-    check_external_indices(etrack.indices);
-
-    return ptr;
+    return parse<Provisioner>(contents, std::move(ext), Options());
 }
 
 /**
@@ -128,6 +304,87 @@ std::shared_ptr<Base> parse(const Json& contents) {
     return parse<Provisioner>(contents, DummyExternals(0));
 }
 
+/**
+ * Parse JSON file contents using the **uzuki** specification with additional options, consuming the contents in the process.
+ * Strings for values, names and levels are moved out of `contents` into the `Provisioner`,
+ * and each subtree of `contents` is released as soon as it has been provisioned.
+ * This reduces the peak memory usage compared to holding both the JSON document and its parsed representation.
+ * On return, `contents` is set to `null`.
+ *
+ * Strings are not moved if `Options::fingerprints` is set, as fingerprints are computed from `contents` after each node is provisioned.
+ * Similarly, nothing is moved or released if `Options::deduplicate` is set, as each node is compared to previously parsed parts of `contents`.
+ * Keys of JSON objects (i.e., list names and data frame column names) are always copied.
+ *
+ * @tparam Provisioner A class namespace defining static methods for creating new `Base` objects, see `parse()` for details.
+ * This should not declare `lazy_values`, as the values are not retained in `contents`.
+ * @tparam Json A [`nlohmann::json`](https://github.com/nlohmann/json)-compatible representation of JSON data.
+ * @tparam Externals Class describing how to resolve external references for type `OTHER`, see `parse()` for details.
+ *
+ * @param contents Parsed contents of the JSON file, as an rvalue.
+ * @param ext Instance of an external reference resolver class.
+ * @param options Further options for parsing.
+ *
+ * @return Pointer to the root `Base` object.
+ * Any invalid representations in `contents` will cause an error to be thrown.
+ */
+template<class Provisioner, class Json, class Externals, typename std::enable_if<!std::is_reference<Json>::value && !std::is_const<Json>::value, int>::type = 0>
+std::shared_ptr<Base> parse(Json&& contents, Externals ext, const Options& options) {
+    static_assert(!lazy_values<Provisioner>::value, "lazy provisioners cannot be used when consuming the contents");
+    Workspace<Json> work;
+    auto output = parse<Provisioner>(static_cast<const Json&>(contents), std::move(ext), options, work, true);
+    contents = nullptr;
+    return output;
+}
+
+/**
+ * Parse JSON file contents using the **uzuki** specification, consuming the contents in the process.
+ * See the `parse()` overload with `Options` for details.
+ *
+ * @tparam Provisioner A class namespace defining static methods for creating new `Base` objects.
+ * @tparam Json A [`nlohmann::json`](https://github.com/nlohmann/json)-compatible representation of JSON data.
+ * @tparam Externals Class describing how to resolve external references for type `OTHER`.
+ *
+ * @param contents Parsed contents of the JSON file, as an rvalue.
+ * @param ext Instance of an external reference resolver class.
+ *
+ * @return Pointer to the root `Base` object.
+ * Any invalid representations in `contents` will cause an error to be thrown.
+ */
+template<class Provisioner, class Json, class Externals, typename std::enable_if<!std::is_reference<Json>::value && !std::is_const<Json>::value, int>::type = 0>
+std::shared_ptr<Base> parse(Json&& contents, Externals ext) {
+    return parse<Provisioner>(std::move(contents), std::move(ext), Options());
+}
+
+/**
+ * Parse JSON file contents using the **uzuki** specification without throwing.
+ * Invalid documents are reported through the returned `Result`, without unwinding or rendering a message, see `validate_nothrow()` for details.
+ *
+ * @tparam Provisioner A class namespace defining static methods for creating new `Base` objects, see `parse()` for details.
+ * @tparam Json A [`nlohmann::json`](https://github.com/nlohmann/json)-compatible representation of JSON data.
+ * @tparam Externals Class describing how to resolve external references for type `OTHER`, see `parse()` for details.
+ *
+ * @param contents Parsed contents of the JSON file.
+ * @param ext Instance of an external reference resolver class.
+ * @param[out] output Pointer to the root `Base` object.
+ * This is only set if parsing was successful.
+ * @param options Further options for parsing.
+ *
+ * @return Result of the parsing.
+ * If exceptions are enabled, any exceptions thrown by the `Provisioner` or `Externals` are reported as `ErrorCode::UNKNOWN`.
+ */
+template<class Provisioner, class Json, class Externals>
+Result parse_nothrow(const Json& contents, Externals ext, std::shared_ptr<Base>& output, const Options& options = Options()) noexcept {
+    Result res;
+    guard(res, [&]() -> void {
+        Workspace<Json> work;
+        auto ptr = parse<Provisioner>(contents, std::move(ext), options, work, res);
+        if (res.ok()) {
+            output = std::move(ptr);
+        }
+    });
+    return res;
+}
+
 }
 
 #endif
@@ -0,0 +1,153 @@
+#ifndef UZUKI_PARSER_HPP
+#define UZUKI_PARSER_HPP
+
+#include "parse.hpp"
+#include "validate.hpp"
+#include "Dummy.hpp"
+#include "error.hpp"
+
+#include "nlohmann/json.hpp"
+
+#include <memory>
+
+/**
+ * @file parser.hpp
+ *
+ * @brief Reusable parser that amortizes allocations across documents.
+ */
+
+namespace uzuki {
+
+/**
+ * @brief Reusable parser for **uzuki** documents.
+ *
+ * This provides the same functionality as the free `parse()` and `validate()` functions,
+ * but retains its internal work space (traversal stack, path buffer, factor level maps, decoding buffers, etc.) across calls.
+ * Repeated parsing of many documents with a single `Parser` instance avoids re-allocating these structures for each document.
+ *
+ * A `Parser` instance is not thread-safe, but different instances can be used in different threads.
+ * Applications should generally create one instance per worker thread.
+ *
+ * @tparam Json A [`nlohmann::json`](https://github.com/nlohmann/json)-compatible representation of JSON data.
+ */
+template<class Json = nlohmann::json>
+class Parser {
+public:
+    /**
+     * @param options Further options for parsing and validation.
+     */
+    Parser(Options options = Options()) : opts(std::move(options)) {}
+
+    /**
+     * @return Options for parsing and validation.
+     * These can be modified between calls.
+     */
+    Options& options() {
+        return opts;
+    }
+
+public:
+    /**
+     * Parse JSON file contents using the **uzuki** specification.
+     * This is equivalent to the free `parse()` function with the stored options.
+     *
+     * @tparam Provisioner A class namespace defining static methods for creating new `Base` objects.
+     * @tparam Externals Class describing how to resolve external references for type `OTHER`.
+     *
+     * @param contents Parsed contents of the JSON file.
+     * @param ext Instance of an external reference resolver class.
+     *
+     * @return Pointer to the root `Base` object.
+     * Any invalid representations in `contents` will cause an error to be thrown.
+     */
+    template<class Provisioner, class Externals>
+    std::shared_ptr<Base> parse(const Json& contents, Externals ext) {
+        return uzuki::parse<Provisioner>(contents, std::move(ext), opts, work);
+    }
+
+    /**
+     * Parse JSON file contents using the **uzuki** specification, consuming the contents in the process.
+     * This is equivalent to the free `parse()` function for rvalues with the stored options.
+     *
+     * @tparam Provisioner A class namespace defining static methods for creating new `Base` objects.
+     * @tparam Externals Class describing how to resolve external references for type `OTHER`.
+     *
+     * @param contents Parsed contents of the JSON file, as an rvalue.
+     * This is set to `null` on return.
+     * @param ext Instance of an external reference resolver class.
+     *
+     * @return Pointer to the root `Base` object.
+     * Any invalid representations in `contents` will cause an error to be thrown.
+     */
+    template<class Provisioner, class Externals>
+    std::shared_ptr<Base> parse(Json&& contents, Externals ext) {
+        static_assert(!lazy_values<Provisioner>::value, "lazy provisioners cannot be used when consuming the contents");
+        auto output = uzuki::parse<Provisioner>(static_cast<const Json&>(contents), std::move(ext), opts, work, true);
+        contents = nullptr;
+        return output;
+    }
+
+    /**
+     * Parse JSON file contents using the **uzuki** specification,
+     * assuming that there are no external references to "other" objects.
+     *
+     * @tparam Provisioner A class namespace defining static methods for creating new `Base` objects.
+     *
+     * @param contents Parsed contents of the JSON file.
+     *
+     * @return Pointer to the root `Base` object.
+     * Any invalid representations in `contents` will cause an error to be thrown.
+     */
+    template<class Provisioner>
+    std::shared_ptr<Base> parse(const Json& contents) {
+        return parse<Provisioner>(contents, DummyExternals(0));
+    }
+
+    /**
+     * Validate JSON file contents against the **uzuki** specification.
+     * Any invalid representations will cause an error to be thrown.
+     *
+     * @param contents Parsed contents of the JSON file.
+     * @param num_external Expected number of external references to "other" objects.
+     */
+    void validate(const Json& contents, size_t num_external) {
+        parse<DummyProvisioner>(contents, DummyExternals(num_external));
+    }
+
+    /**
+     * Validate JSON file contents against the **uzuki** specification with an unknown number of external references.
+     * Any invalid representations will cause an error to be thrown.
+     *
+     * @param contents Parsed contents of the JSON file.
+     *
+     * @return Number of external references.
+     */
+    size_t validate(const Json& contents) {
+        return uzuki::validate(contents, opts, work);
+    }
+
+    /**
+     * Validate JSON file contents against the **uzuki** specification without throwing.
+     * See the free `validate_nothrow()` function for details.
+     *
+     * @param contents Parsed contents of the JSON file.
+     * @param num_external Expected number of external references to "other" objects.
+     *
+     * @return Result of the validation.
+     */
+    Result validate_nothrow(const Json& contents, size_t num_external) noexcept {
+        Result output;
+        guard(output, [&]() -> void {
+            uzuki::parse<DummyProvisioner>(contents, DummyExternals(num_external), opts, work, output);
+        });
+        return output;
+    }
+
+private:
+    Options opts;
+    Workspace<Json> work;
+};
+
+}
+
+#endif
@@ -0,0 +1,82 @@
+#ifndef UZUKI_PROJECTION_HPP
+#define UZUKI_PROJECTION_HPP
+
+#include <string>
+#include <vector>
+
+/**
+ * @file projection.hpp
+ *
+ * @brief Select subtrees to be materialized during parsing.
+ */
+
+namespace uzuki {
+
+/**
+ * @brief Selection of subtrees to be materialized during parsing.
+ *
+ * Each path uses the same syntax as error messages, e.g., `.foo[0].columns.bar` refers to the column `bar` of the data frame in the first element of the list `foo`.
+ * A node is materialized by the `Provisioner` if its path is one of `paths` or lies inside one of `paths`.
+ * Lists and data frames along the way to a selected node are also materialized, but only contain the selected children;
+ * other positions of a list are left unset, and unselected columns are omitted from a data frame.
+ *
+ * Unselected subtrees are still fully validated (without calling the `Provisioner`) so that invalid documents are always rejected.
+ * If `trust = true`, unselected subtrees are skipped entirely, which is faster but assumes that the document is already known to be valid.
+ */
+struct Projection {
+    /**
+     * Paths to the selected subtrees.
+     * If empty, the entire document is materialized.
+     */
+    std::vector<std::string> paths;
+
+    /**
+     * Whether to skip unselected subtrees without validating them.
+     * In this mode, fingerprints and resource limits do not account for the skipped subtrees,
+     * and the number and contiguity of the external references are not checked.
+     */
+    bool trust = false;
+};
+
+/**
+ * @cond
+ */
+namespace projection {
+
+enum class Mode : unsigned char {
+    NONE,    // not selected; only validated, or skipped in trust mode.
+    PARTIAL, // along the way to a selected node.
+    FULL     // selected, along with all of its children.
+};
+
+inline bool is_prefix(const std::string& prefix, const std::string& path) {
+    if (prefix.size() > path.size() || path.compare(0, prefix.size(), prefix) != 0) {
+        return false;
+    }
+    if (prefix.size() == path.size()) {
+        return true;
+    }
+    char next = path[prefix.size()];
+    return next == '.' || next == '[';
+}
+
+inline Mode classify(const Projection& proj, const std::string& path) {
+    Mode output = Mode::NONE;
+    for (const auto& p : proj.paths) {
+        if (is_prefix(p, path)) {
+            return Mode::FULL;
+        } else if (is_prefix(path, p)) {
+            output = Mode::PARTIAL;
+        }
+    }
+    return output;
+}
+
+}
+/**
+ * @endcond
+ */
+
+}
+
+#endif
@@ -0,0 +1,100 @@
+#ifndef UZUKI_SCALAR_HPP
+#define UZUKI_SCALAR_HPP
+
+#include "interfaces.hpp"
+
+#include <string>
+#include <memory>
+
+/**
+ * @file scalar.hpp
+ *
+ * @brief Length-1 vectors that store their value inline.
+ */
+
+namespace uzuki {
+
+/**
+ * @brief Length-1 vector that stores its value inline.
+ *
+ * This is intended to be returned by the optional `new_*Scalar()` methods of a `Provisioner`, see `parse()` for details.
+ * It avoids the separate allocation of a one-element buffer for the very common R "scalars".
+ *
+ * @tparam T Type of the value.
+ * @tparam tt `Type` of the vector.
+ */
+template<typename T, Type tt>
+struct ScalarVector : public TypedVector<T, tt> {
+    /**
+     * @param v Value of the only element.
+     */
+    ScalarVector(T v = T()) : value(std::move(v)) {}
+
+    /**
+     * @cond
+     */
+    size_t size() const { return 1; }
+
+    void set(size_t, T v) {
+        value = std::move(v);
+        missing = false;
+    }
+
+    void set_missing(size_t) { missing = true; }
+
+    void use_names() { has_names = true; }
+
+    void set_name(size_t, std::string n) { name = std::move(n); }
+    /**
+     * @endcond
+     */
+
+    /**
+     * Value of the only element.
+     */
+    T value;
+
+    /**
+     * Whether the only element is missing.
+     */
+    bool missing = false;
+
+    /**
+     * Whether the vector is named.
+     */
+    bool has_names = false;
+
+    /**
+     * Name of the only element, if `has_names = true`.
+     */
+    std::string name;
+};
+
+/**
+ * Inline length-1 integer vector.
+ */
+typedef ScalarVector<int32_t, INTEGER> IntegerScalarVector;
+
+/**
+ * Inline length-1 double-precision vector.
+ */
+typedef ScalarVector<double, NUMBER> NumberScalarVector;
+
+/**
+ * Inline length-1 string vector.
+ */
+typedef ScalarVector<std::string, STRING> StringScalarVector;
+
+/**
+ * Inline length-1 boolean vector.
+ */
+typedef ScalarVector<unsigned char, BOOLEAN> BooleanScalarVector;
+
+/**
+ * Inline length-1 date-formatted vector.
+ */
+typedef ScalarVector<std::string, DATE> DateScalarVector;
+
+}
+
+#endif
@@ -0,0 +1,224 @@
+#ifndef UZUKI_STATISTICS_HPP
+#define UZUKI_STATISTICS_HPP
+
+#include "hash.hpp"
+
+#include <string>
+#include <vector>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <unordered_map>
+
+/**
+ * @file statistics.hpp
+ *
+ * @brief Summary statistics computed during parsing.
+ */
+
+namespace uzuki {
+
+/**
+ * @brief Summary statistics for a single vector or array.
+ *
+ * Missing values are only counted in `missing` and are ignored by all other statistics.
+ */
+struct Summary {
+    /**
+     * Number of non-missing values.
+     */
+    size_t count = 0;
+
+    /**
+     * Number of missing values.
+     */
+    size_t missing = 0;
+
+    /**
+     * Smallest non-missing value for integer, number and boolean types.
+     * This is NaN for other types or if there are no non-missing values.
+     */
+    double min = std::numeric_limits<double>::quiet_NaN();
+
+    /**
+     * Largest non-missing value for integer, number and boolean types.
+     * This is NaN for other types or if there are no non-missing values.
+     */
+    double max = std::numeric_limits<double>::quiet_NaN();
+
+    /**
+     * Sum of non-missing values for integer, number and boolean types, i.e., the number of true values for the latter.
+     * This is zero for other types.
+     * NaNs are ignored.
+     */
+    double sum = 0;
+
+    /**
+     * Whether the non-missing values are sorted in non-decreasing order.
+     * Strings and dates are compared lexicographically, while factors are compared by their level indices.
+     * NaNs are ignored.
+     */
+    bool sorted = true;
+
+    /**
+     * Number of distinct non-missing values.
+     * For strings and dates, this is a HyperLogLog estimate with a relative error of around 3%.
+     * For factors, this is the exact number of levels that are used.
+     * It is zero for other types.
+     */
+    double distinct = 0;
+
+    /**
+     * Number of occurrences of each level for factors.
+     * This is empty for other types.
+     */
+    std::vector<size_t> level_counts;
+};
+
+/**
+ * @brief Summary statistics computed during parsing.
+ *
+ * Statistics are computed in the same pass that converts each value for the `Provisioner`,
+ * so that consumers do not need a second scan over the parsed vectors and arrays.
+ * They are not computed for `Provisioner`s that skip or defer the processing of values.
+ */
+struct Statistics {
+    /**
+     * Statistics for each vector, array or factor.
+     * Each key is the path to the node, using the same syntax as error messages, e.g., `.foo[0].columns.bar`.
+     */
+    std::unordered_map<std::string, Summary> nodes;
+};
+
+/**
+ * @cond
+ */
+namespace statistics {
+
+/*
+ * HyperLogLog sketch with 2^10 registers, which has a standard error of
+ * 1.04/sqrt(1024) ~ 3% and is small enough to allocate for each node.
+ */
+class Distinct {
+public:
+    static constexpr int precision = 10;
+    static constexpr size_t size = static_cast<size_t>(1) << precision;
+
+    void add(uint64_t hash) {
+        if (registers.empty()) {
+            registers.resize(size); // only allocated for string-like nodes.
+        }
+        size_t index = hash >> (64 - precision);
+        uint64_t rest = hash << precision;
+        unsigned char rank = 1;
+        constexpr unsigned char max_rank = 64 - precision + 1;
+        constexpr uint64_t top = static_cast<uint64_t>(1) << 63;
+        while (rank < max_rank && !(rest & top)) {
+            rest <<= 1;
+            ++rank;
+        }
+        if (rank > registers[index]) {
+            registers[index] = rank;
+        }
+    }
+
+    double estimate() const {
+        double total = 0;
+        size_t zeros = 0;
+        for (auto r : registers) {
+            total += std::ldexp(1.0, -static_cast<int>(r));
+            zeros += (r == 0);
+        }
+
+        constexpr double m = size;
+        double raw = (0.7213 / (1 + 1.079 / m)) * m * m / total;
+        if (raw <= 2.5 * m && zeros) {
+            // Linear counting is more accurate for small cardinalities.
+            return m * std::log(m / static_cast<double>(zeros));
+        }
+        return raw;
+    }
+
+private:
+    std::vector<unsigned char> registers;
+};
+
+class Tracker {
+public:
+    Tracker(Summary& s) : summary(s) {}
+
+    void add(double x) {
+        ++summary.count;
+        if (std::isnan(x)) {
+            return;
+        }
+        summary.sum += x;
+        if (!started) {
+            summary.min = x;
+            summary.max = x;
+            started = true;
+        } else {
+            if (x < last) {
+                summary.sorted = false;
+            }
+            if (x < summary.min) {
+                summary.min = x;
+            } else if (x > summary.max) {
+                summary.max = x;
+            }
+        }
+        last = x;
+    }
+
+    // 'previous' should point to the last non-missing string, if any, so that we don't have to keep a copy.
+    void add(const std::string& x, const std::string* previous = nullptr) {
+        ++summary.count;
+        if (summary.sorted && previous && x < *previous) {
+            summary.sorted = false;
+        }
+        distinct.add(hash_bytes(x));
+        strings = true;
+    }
+
+    void add_level(size_t code) {
+        ++summary.count;
+        ++summary.level_counts[code];
+        if (started && static_cast<double>(code) < last) {
+            summary.sorted = false;
+        }
+        last = code;
+        started = true;
+    }
+
+    void add_missing() {
+        ++summary.missing;
+    }
+
+    void finish() {
+        if (strings) {
+            summary.distinct = distinct.estimate();
+        } else if (!summary.level_counts.empty()) {
+            size_t used = 0;
+            for (auto c : summary.level_counts) {
+                used += (c > 0);
+            }
+            summary.distinct = used;
+        }
+    }
+
+private:
+    Summary& summary;
+    bool started = false;
+    bool strings = false;
+    double last = 0;
+    Distinct distinct;
+};
+
+}
+/**
+ * @endcond
+ */
+
+}
+
+#endif
@@ -2,10 +2,20 @@
 #define UZUKI_UNPACK_HPP
 
 #include "interfaces.hpp"
+#include "base64.hpp"
+#include "options.hpp"
+#include "error.hpp"
+#include "Dummy.hpp"
 
 #include <string>
+#include <vector>
 #include <unordered_map>
 #include <stdexcept>
+#include <limits>
+#include <cmath>
+#include <cstdint>
+#include <algorithm>
+#include <type_traits>
 
 namespace uzuki {
 
@@ -14,6 +24,11 @@ bool is_integer(T val) {
     return std::floor(val) == val;
 }
 
+inline bool fits_size(double val) {
+    // Strict inequality as the cast of the maximum rounds up to 2^64.
+    return val >= 0 && val < static_cast<double>(std::numeric_limits<size_t>::max());
+}
+
 inline bool is_date(const std::string& val) {
     if (val.size() != 10) {
         return false;
@@ -42,189 +57,1444 @@ inline bool is_date(const std::string& val) {
     return true;
 }
 
+/*
+ * Dense bitmap of the "other" indices seen so far. Duplicates are detected
+ * as soon as they are added, and contiguity only requires that the largest
+ * index is less than the number of indices, as N distinct indices in
+ * [0, N) must cover the entire range. Indices far beyond the number seen so
+ * far are deferred to the end to avoid allocating a huge bitmap for a single
+ * outlier when the expected number of references is unknown.
+ */
+struct ExternalIndices {
+    std::vector<uint64_t> seen;
+    std::vector<size_t> deferred;
+    size_t count = 0;
+    size_t max_index = 0;
+
+    void clear() {
+        seen.clear();
+        deferred.clear();
+        count = 0;
+        max_index = 0;
+    }
+
+    // Returns false if 'i' is already present.
+    bool add(size_t i) {
+        size_t word = i / 64;
+        uint64_t bit = static_cast<uint64_t>(1) << (i % 64);
+
+        if (word >= seen.size()) {
+            if (i / 2 > count + 2048) {
+                deferred.push_back(i);
+                word = std::numeric_limits<size_t>::max();
+            } else {
+                seen.resize(word + 1);
+            }
+        }
+
+        if (word != std::numeric_limits<size_t>::max()) {
+            if (seen[word] & bit) {
+                return false;
+            }
+            seen[word] |= bit;
+        }
+
+        ++count;
+        max_index = std::max(max_index, i);
+        return true;
+    }
+
+    bool merge(const ExternalIndices& other, Result& status) {
+        if (other.seen.size() > seen.size()) {
+            seen.resize(other.seen.size());
+        }
+        for (size_t w = 0; w < other.seen.size(); ++w) {
+            uint64_t overlap = seen[w] & other.seen[w];
+            if (overlap) {
+                size_t b = 0;
+                while (!(overlap & (static_cast<uint64_t>(1) << b))) {
+                    ++b;
+                }
+                return status.fail(ErrorCode::DUPLICATE_EXTERNAL, "", "\"index\" value of %i for type \"other\" is duplicated", w * 64 + b);
+            }
+            seen[w] |= other.seen[w];
+        }
+
+        deferred.insert(deferred.end(), other.deferred.begin(), other.deferred.end());
+        count += other.count;
+        max_index = std::max(max_index, other.max_index);
+        return true;
+    }
+
+    // Checks the deferred outliers for duplicates, which should be reported before any problems with the count.
+    // Outliers within the range of the bitset are then folded into it.
+    bool check_deferred(Result& status) {
+        if (deferred.empty()) {
+            return true;
+        }
+
+        std::sort(deferred.begin(), deferred.end());
+        for (size_t d = 1; d < deferred.size(); ++d) {
+            if (deferred[d] == deferred[d - 1]) {
+                return status.fail(ErrorCode::DUPLICATE_EXTERNAL, "", "\"index\" value of %i for type \"other\" is duplicated", deferred[d]);
+            }
+        }
+
+        seen.resize(std::max(seen.size(), (count + 63) / 64));
+        for (auto i : deferred) {
+            size_t word = i / 64;
+            if (word >= seen.size()) {
+                break; // sorted, so all remaining outliers are also beyond the bitset.
+            }
+            uint64_t bit = static_cast<uint64_t>(1) << (i % 64);
+            if (seen[word] & bit) {
+                return status.fail(ErrorCode::DUPLICATE_EXTERNAL, "", "\"index\" value of %i for type \"other\" is duplicated", i);
+            }
+            seen[word] |= bit;
+        }
+
+        deferred.clear();
+        return true;
+    }
+
+    bool finish(Result& status) {
+        if (!check_deferred(status)) {
+            return false;
+        }
+        if (count && max_index >= count) {
+            return status.fail(ErrorCode::EXTERNAL_COUNT, "", "set of \"index\" values for type \"other\" should be consecutive starting from zero");
+        }
+        return true;
+    }
+};
+
+/*
+ * Location of an "other" object whose external reference is resolved after
+ * the traversal, for Externals that support batched or asynchronous loading.
+ */
+struct ExternalSite {
+    List* list;
+    size_t position;
+    size_t index;
+    std::shared_ptr<Base>* slot; // used instead of 'list' when the "other" object is the root of a subtree.
+};
+
+/*
+ * Previously parsed nodes and level tables for deduplication, keyed by the
+ * hash of their JSON. Pointers to the JSON are retained so that identical
+ * hashes can be confirmed with a full comparison.
+ */
+struct SharedNode {
+    const void* json;
+    std::shared_ptr<Base> node;
+    bool materialized;
+    std::string path;
+};
+
+struct SharedLevels {
+    const void* json;
+    std::shared_ptr<const std::vector<std::string> > levels;
+    std::unordered_map<std::string, size_t> lookup;
+};
+
+/*
+ * Scratch space that is reused across documents by a long-lived Parser.
+ * Each member is only used by one function at a time, so we can just
+ * clear (or resize) it on entry and retain its capacity on exit. The
+ * exceptions are the deduplication tables, which are cleared when the
+ * Context is destroyed so that shared nodes are not kept alive.
+ */
+struct Scratch {
+    std::unordered_map<std::string, size_t> levels;
+    std::vector<size_t> lengths, typed_sizes;
+    std::vector<unsigned char> bytes, validity;
+    ExternalIndices externals;
+    std::vector<ExternalSite> sites;
+    std::unordered_multimap<uint64_t, SharedNode> shared;
+    std::unordered_multimap<uint64_t, SharedLevels> shared_levels;
+};
+
+/*
+ * Failures are recorded in 'status' rather than thrown, so each function
+ * returns early (with a null pointer or false) once 'failed()' is true.
+ * This avoids the cost of unwinding and building messages for documents
+ * that are expected to be invalid, and works without exceptions.
+ */
+struct Context {
+    Context(const Options& o, Scratch& s, Result& r, bool c = false) : options(o), scratch(s), status(r), consume(c && o.fingerprints == nullptr && !o.deduplicate) {}
+
+    ~Context() {
+        scratch.shared.clear();
+        scratch.shared_levels.clear();
+    }
+
+    Context(const Context&) = delete;
+    Context& operator=(const Context&) = delete;
+
+    const Options& options;
+    Scratch& scratch;
+    Result& status;
+
+    bool failed() const {
+        return status.code != ErrorCode::OK;
+    }
+
+    // Whether the document is owned by the parser, such that strings can be
+    // moved out and subtrees released once they are provisioned. This is
+    // disabled when fingerprints are requested, as they are computed from
+    // the document after each node is provisioned, or for deduplication,
+    // which compares each node against previously parsed parts of the document.
+    bool consume;
+
+    size_t depth = 0;
+    size_t elements = 0;
+    size_t string_bytes = 0;
+
+    // Dimensions of the array being filled, if its values should be delivered in row-major order.
+    const std::vector<size_t>* row_major = nullptr;
+
+    // Whether the values being filled are a temporary copy rather than part of the document, in which case they cannot be bound lazily.
+    bool transient_values = false;
+
+    // The suffix is only appended upon failure, to avoid building paths in the common case.
+    bool add_elements(size_t n, const std::string& sofar, const char* suffix = "") {
+        const auto& limit = options.limits.max_total_elements;
+        if (n > limit - elements) {
+            return status.fail(ErrorCode::LIMIT_EXCEEDED, sofar + suffix, "total number of elements exceeds the limit (%n) at \"%p\"", Result::no_index, limit);
+        }
+        elements += n;
+        return true;
+    }
+
+    bool add_string_bytes(size_t n, const std::string& sofar, const char* suffix = "") {
+        const auto& limit = options.limits.max_string_bytes;
+        if (n > limit - string_bytes) {
+            return status.fail(ErrorCode::LIMIT_EXCEEDED, sofar + suffix, "total number of string bytes exceeds the limit (%n) at \"%p\"", Result::no_index, limit);
+        }
+        string_bytes += n;
+        return true;
+    }
+
+    bool limits_string_bytes() const {
+        return options.limits.max_string_bytes != std::numeric_limits<size_t>::max();
+    }
+
+    bool check_node_elements(size_t n, const std::string& sofar) {
+        const auto& limit = options.limits.max_node_elements;
+        if (n > limit) {
+            return status.fail(ErrorCode::LIMIT_EXCEEDED, sofar, "number of elements in \"%p\" exceeds the limit (%n)", Result::no_index, limit);
+        }
+        return true;
+    }
+
+    bool enter_list(size_t n, const std::string& sofar) {
+        ++depth;
+        const auto& limit = options.limits.max_depth;
+        if (depth > limit) {
+            return status.fail(ErrorCode::LIMIT_EXCEEDED, sofar, "nesting depth of \"%p\" exceeds the limit (%n)", Result::no_index, limit);
+        }
+        return check_node_elements(n, sofar) && add_elements(n, sofar);
+    }
+};
+
+template<class Json>
+std::string take_string(const Json& x, bool consume) {
+    if (consume) {
+        return std::move(const_cast<Json&>(x).template get_ref<typename Json::string_t&>());
+    } else {
+        return x.template get<std::string>();
+    }
+}
+
+template<class Json>
+void release(const Json& x, bool consume) {
+    if (consume) {
+        const_cast<Json&>(x) = nullptr;
+    }
+}
+
+// As in Context, the path to the names is only built upon failure.
 template<class Json, class Thing>
-void check_names(const Json& j, size_t n, Thing* vec, const std::string& sofar) {
+bool check_names(const Json& j, size_t n, Thing* vec, const std::string& sofar, Context& ctx) {
     if (!j.is_array() || j.size() != n) {
-        throw std::runtime_error("\"" + sofar + "\" should be an array of length " + std::to_string(n));
+        return ctx.status.fail(ErrorCode::INVALID_NAMES, sofar + ".names", "\"%p\" should be an array of length %n", Result::no_index, n);
+    }
+
+    for (size_t i = 0; i < n; ++i) {
+        if (!j[i].is_string()) {
+            return ctx.status.fail(ErrorCode::INVALID_NAMES, sofar + ".names", "\"%p[%i]\" should be a string", i);
+        }
+        auto name = take_string(j[i], ctx.consume);
+        if (!ctx.add_string_bytes(name.size(), sofar, ".names")) {
+            return false;
+        }
+        vec->set_name(i, std::move(name));
+    }
+    return true;
+}
+
+/* 
+ * BJData/UBJSON optimized N-dimensional containers are decoded by nlohmann::json
+ * into an annotated object with the _ArrayType_, _ArraySize_ and _ArrayData_ fields.
+ * Any input can contain such an object, so the declared element type is not
+ * trusted and each element is still checked as usual.
+ */
+template<class Json>
+const Json* unwrap_typed_array(const Json& values, std::vector<size_t>& sizes, const std::string& sofar, Result& status) {
+    auto tIt = values.find("_ArrayType_");
+    auto sIt = values.find("_ArraySize_");
+    auto dIt = values.find("_ArrayData_");
+    if (tIt == values.end() || !tIt->is_string() || sIt == values.end() || !sIt->is_array() || dIt == values.end() || !dIt->is_array()) {
+        status.fail(ErrorCode::INVALID_VALUES, sofar + ".values", "\"%p\" should be an array");
+        return nullptr;
+    }
+
+    size_t prod = 1;
+    sizes.clear();
+    for (const auto& s : *sIt) {
+        if (!s.is_number_integer() || (!s.is_number_unsigned() && s.template get<int64_t>() < 0)) {
+            status.fail(ErrorCode::INVALID_VALUES, sofar + ".values", "\"%p._ArraySize_\" should contain non-negative integers");
+            return nullptr;
+        }
+        auto current = s.template get<uint64_t>();
+        if (current > std::numeric_limits<size_t>::max()) {
+            status.fail(ErrorCode::SIZE_OVERFLOW, sofar + ".values", "\"%p._ArraySize_\" contains an overflowing size");
+            return nullptr;
+        }
+        if (current && prod > std::numeric_limits<size_t>::max() / current) {
+            status.fail(ErrorCode::SIZE_OVERFLOW, sofar + ".values", "product of \"%p._ArraySize_\" overflows");
+            return nullptr;
+        }
+        prod *= current;
+        sizes.push_back(current);
+    }
+    if (sizes.empty() || prod != dIt->size()) {
+        status.fail(ErrorCode::INVALID_VALUES, sofar + ".values", "product of \"%p._ArraySize_\" should be equal to the length of \"%p._ArrayData_\"");
+        return nullptr;
+    }
+
+    return &(*dIt);
+}
+
+/*
+ * BJData stores N-dimensional containers in row-major order, so the data is
+ * copied into column-major order before it is used as the array's values.
+ */
+template<class Json>
+void reorder_typed_array(const Json& values, const std::vector<size_t>& dims, Json& output) {
+    size_t ndims = dims.size();
+    std::vector<size_t> strides(ndims, 1); 
+    for (size_t d = ndims - 1; d > 0; --d) {
+        strides[d - 1] = strides[d] * dims[d];
+    }
+
+    output = Json::array();
+    auto& arr = output.template get_ref<typename Json::array_t&>();
+    arr.reserve(values.size());
+    std::vector<size_t> position(ndims);
+    size_t offset = 0;
+
+    for (size_t i = 0; i < values.size(); ++i) {
+        arr.push_back(values[offset]);
+        for (size_t d = 0; d < ndims; ++d) {
+            ++position[d];
+            offset += strides[d];
+            if (position[d] < dims[d]) {
+                break;
+            }
+            offset -= strides[d] * position[d];
+            position[d] = 0;
+        }
+    }
+}
+
+/*
+ * Wrapper that writes values directly into the buffer supplied by a
+ * vector or array, if any, to avoid a virtual call (and usually a copy)
+ * per element. Otherwise, we fall back to 'set()' and 'set_missing()'.
+ */
+template<typename T, class Pointer>
+struct Destination {
+    Destination(Pointer* p) : ptr(p), direct(p->buffer()), bitmap(direct ? p->validity() : nullptr) {}
+
+    void set(size_t i, T v) {
+        if (direct) {
+            direct[i] = std::move(v);
+            if (bitmap) {
+                bitmap[i / 8] |= static_cast<unsigned char>(1u << (i % 8));
+            }
+        } else {
+            ptr->set(i, std::move(v));
+        }
+    }
+
+    void set_missing(size_t i) {
+        if (bitmap) {
+            bitmap[i / 8] &= static_cast<unsigned char>(~(1u << (i % 8)));
+        } else {
+            ptr->set_missing(i);
+        }
+    }
+
+    Pointer* ptr;
+    T* direct;
+    unsigned char* bitmap;
+};
+
+template<typename T, class Pointer>
+Destination<T, Pointer> destination(Pointer* p) {
+    return Destination<T, Pointer>(p);
+}
+
+/*
+ * Wrapper that updates the summary statistics for a node as each value is
+ * written, so that no second pass is required. Factor codes are tracked
+ * separately as they are indices into the levels.
+ */
+template<typename T, class Pointer, bool codes = false>
+struct Collector {
+    Collector(Pointer* p, Summary& s) : ptr(p), tracker(s) {}
+
+    void set(size_t i, T v) {
+        record(v, std::integral_constant<bool, codes>());
+        ptr->set(i, std::move(v));
+    }
+
+    void set_missing(size_t i) {
+        tracker.add_missing();
+        ptr->set_missing(i);
+    }
+
+    template<typename V>
+    void record(const V& v, std::false_type) {
+        tracker.add(v);
+    }
+
+    void record(size_t v, std::true_type) {
+        tracker.add_level(v);
+    }
+
+    void flush() {}
+
+    Pointer* ptr;
+    statistics::Tracker tracker;
+};
+
+/*
+ * For strings, the latest value is held back until the next one arrives,
+ * so that the two can be compared without copying either of them.
+ */
+template<class Pointer>
+struct Collector<std::string, Pointer, false> {
+    Collector(Pointer* p, Summary& s) : ptr(p), tracker(s) {}
+
+    void set(size_t i, std::string v) {
+        tracker.add(v, held ? &pending : nullptr);
+        flush();
+        pending = std::move(v);
+        pending_index = i;
+        held = true;
+    }
+
+    void set_missing(size_t i) {
+        tracker.add_missing();
+        ptr->set_missing(i);
+    }
+
+    void flush() {
+        if (held) {
+            ptr->set(pending_index, std::move(pending));
+            held = false;
+        }
+    }
+
+    Pointer* ptr;
+    statistics::Tracker tracker;
+    std::string pending;
+    size_t pending_index = 0;
+    bool held = false;
+};
+
+template<typename T, bool codes, class Pointer, class Function>
+void gather(Pointer* ptr, const std::string& sofar, Context& ctx, Function fill, size_t nlevels) {
+    auto stats = ctx.options.statistics;
+    if (stats == nullptr) {
+        fill(ptr);
+        return;
+    }
+
+    auto& summary = stats->nodes[sofar];
+    summary = Summary();
+    summary.level_counts.resize(nlevels);
+    Collector<T, Pointer, codes> col(ptr, summary);
+    fill(&col);
+    col.flush();
+    col.tracker.finish();
+}
+
+/*
+ * Holding area for the values of an array in column-major order, so that
+ * they can be transposed in cache-friendly blocks into row-major order.
+ */
+template<typename T>
+struct Staging {
+    Staging(size_t n) : values(n), missing(n) {}
+
+    void set(size_t i, T v) {
+        values[i] = std::move(v);
+    }
+
+    void set_missing(size_t i) {
+        missing[i] = 1;
+    }
+
+    std::vector<T> values;
+    std::vector<unsigned char> missing;
+};
+
+/*
+ * Converting column-major to row-major order is equivalent to reversing the
+ * dimensions. For each combination of indices in the middle dimensions, we
+ * transpose the 2-dimensional slab formed by the first and last dimensions,
+ * i.e., the fastest-changing dimension in the source and destination,
+ * respectively. This is done in square tiles so that both the reads and
+ * writes for each tile stay within a small number of cache lines.
+ */
+template<typename T, class Pointer>
+void transpose(Staging<T>& staged, const std::vector<size_t>& dims, Pointer* ptr) {
+    size_t total = staged.values.size();
+    auto store = [&](size_t s, size_t d) -> void {
+        if (staged.missing[s]) {
+            ptr->set_missing(d);
+        } else {
+            ptr->set(d, std::move(staged.values[s]));
+        }
+    };
+
+    size_t ndims = dims.size();
+    if (ndims < 2 || total == 0) {
+        for (size_t i = 0; i < total; ++i) {
+            store(i, i);
+        }
+        return;
+    }
+
+    std::vector<size_t> src_strides(ndims), dst_strides(ndims);
+    src_strides[0] = 1;
+    for (size_t d = 1; d < ndims; ++d) {
+        src_strides[d] = src_strides[d - 1] * dims[d - 1];
+    }
+    dst_strides[ndims - 1] = 1;
+    for (size_t d = ndims - 1; d > 0; --d) {
+        dst_strides[d - 1] = dst_strides[d] * dims[d];
+    }
+
+    constexpr size_t block = 32;
+    size_t first = dims.front(), last = dims.back();
+    size_t src_last = src_strides.back(), dst_first = dst_strides.front();
+    size_t nslabs = total / (first * last);
+    std::vector<size_t> position(ndims);
+    size_t src_base = 0, dst_base = 0;
+
+    for (size_t m = 0; m < nslabs; ++m) {
+        for (size_t b0 = 0; b0 < first; b0 += block) {
+            size_t e0 = std::min(first, b0 + block);
+            for (size_t bk = 0; bk < last; bk += block) {
+                size_t ek = std::min(last, bk + block);
+                for (size_t i0 = b0; i0 < e0; ++i0) {
+                    size_t s = src_base + i0 + bk * src_last;
+                    size_t d = dst_base + i0 * dst_first + bk;
+                    for (size_t ik = bk; ik < ek; ++ik, s += src_last, ++d) {
+                        store(s, d);
+                    }
+                }
+            }
+        }
+
+        // Moving to the next slab along the middle dimensions.
+        for (size_t j = 1; j + 1 < ndims; ++j) {
+            ++position[j];
+            src_base += src_strides[j];
+            dst_base += dst_strides[j];
+            if (position[j] < dims[j]) {
+                break;
+            }
+            src_base -= src_strides[j] * dims[j];
+            dst_base -= dst_strides[j] * dims[j];
+            position[j] = 0;
+        }
+    }
+}
+
+template<typename T, bool codes = false, class Pointer, class Function>
+void collect(Pointer* ptr, const std::string& sofar, Context& ctx, Function fill, size_t nlevels = 0) {
+    if (ctx.row_major == nullptr) {
+        gather<T, codes>(ptr, sofar, ctx, fill, nlevels);
+        return;
+    }
+
+    size_t total = 1;
+    for (auto d : *(ctx.row_major)) {
+        total *= d;
+    }
+    Staging<T> staged(total);
+    gather<T, codes>(&staged, sofar, ctx, fill, nlevels);
+    if (!ctx.failed()) {
+        transpose(staged, *(ctx.row_major), ptr);
+    }
+}
+
+// Stops at the first value that fails conversion, as recorded in 'status'.
+template<class Json, class Pointer, class Function>
+void fill_values(const Json& values, const std::vector<size_t>* lengths, Pointer* ptr, const Result& status, Function convert) {
+    if (lengths == nullptr) {
+        for (size_t i = 0; i < values.size(); ++i) {
+            const auto& x = values[i];
+            if (x.is_null()) {
+                ptr->set_missing(i);
+            } else {
+                auto val = convert(x, i);
+                if (!status.ok()) {
+                    return;
+                }
+                ptr->set(i, std::move(val));
+            }
+        }
+        return;
+    }
+
+    // Each run value is only checked and converted once, regardless of the run length.
+    size_t pos = 0;
+    for (size_t r = 0; r < values.size(); ++r) {
+        const auto& x = values[r];
+        size_t end = pos + (*lengths)[r];
+        if (x.is_null()) {
+            for (; pos < end; ++pos) {
+                ptr->set_missing(pos);
+            }
+        } else {
+            auto val = convert(x, r);
+            if (!status.ok()) {
+                return;
+            }
+            for (; pos < end; ++pos) {
+                ptr->set(pos, val);
+            }
+        }
+    }
+}
+
+/*
+ * Provisioners can declare 'static constexpr bool skip_values = true' if
+ * they only care about the shape of each object. In that case, we don't
+ * check or convert individual values and only report the missing ones.
+ */
+template<class Provisioner, typename = void>
+struct skips_values : std::false_type {};
+
+template<class Provisioner>
+struct skips_values<Provisioner, typename std::enable_if<Provisioner::skip_values>::type> : std::true_type {};
+
+template<class Json, class Pointer>
+void fill_missing(const Json& values, const std::vector<size_t>* lengths, Pointer* ptr) {
+    size_t pos = 0;
+    for (size_t r = 0; r < values.size(); ++r) {
+        size_t end = pos + (lengths ? (*lengths)[r] : 1);
+        if (values[r].is_null()) {
+            for (; pos < end; ++pos) {
+                ptr->set_missing(pos);
+            }
+        } else {
+            pos = end;
+        }
+    }
+}
+
+template<class Provisioner, class Json, typename... Ts>
+std::shared_ptr<Base> check_shape(const std::string& type, const Json& values, const std::vector<size_t>* lengths, const Json& j, const std::string& sofar, Context& ctx, Ts... args) {
+    std::shared_ptr<Base> output;
+    auto create = [&](auto ptr) -> void {
+        output.reset(ptr);
+        fill_missing(values, lengths, ptr);
+    };
+
+    if (type == "string") {
+        create(Provisioner::new_String(args...));
+    } else if (type == "date") {
+        create(Provisioner::new_Date(args...));
+    } else if (type == "integer") {
+        create(Provisioner::new_Integer(args...));
+    } else if (type == "number") {
+        create(Provisioner::new_Number(args...));
+    } else if (type == "boolean") {
+        create(Provisioner::new_Boolean(args...));
+    } else if (type == "factor" || type == "ordered") {
+        auto lIt = j.find("levels");
+        if (lIt == j.end() || !lIt->is_array()) {
+            ctx.status.fail(ErrorCode::INVALID_LEVELS, sofar + ".levels", "\"%p\" should be an array"); 
+            return nullptr;
+        }
+        auto fptr = Provisioner::new_Factor(args..., lIt->size());
+        create(fptr);
+        if (type == "ordered") {
+            fptr->is_ordered();
+        }
+    } else {
+        ctx.status.fail(ErrorCode::INVALID_TYPE, sofar, "unrecognized \"%p.type\" of \"%s\"", Result::no_index, 0, type);
+    }
+
+    return output;
+}
+
+/*
+ * Provisioners can declare 'static constexpr bool lazy_values = true' to
+ * receive a reference to the JSON values instead of the decoded values.
+ * The vectors and arrays returned by such a Provisioner should have a 'bind()'
+ * method that accepts a pointer to the values, the run lengths (or NULL) and
+ * the path for error messages. Validation is still performed up front unless
+ * the Provisioner declares 'static constexpr bool defer_validation = true'.
+ */
+template<class Provisioner, typename = void>
+struct lazy_values : std::false_type {};
+
+template<class Provisioner>
+struct lazy_values<Provisioner, typename std::enable_if<Provisioner::lazy_values>::type> : std::true_type {};
+
+template<class Provisioner, typename = void>
+struct defers_validation : std::false_type {};
+
+template<class Provisioner>
+struct defers_validation<Provisioner, typename std::enable_if<Provisioner::defer_validation>::type> : std::true_type {};
+
+/*
+ * Provisioners can declare 'static constexpr bool row_major = true' to
+ * receive array values in row-major order, i.e., with the last dimension
+ * changing fastest, rather than the column-major order of the document.
+ */
+template<class Provisioner, typename = void>
+struct row_major_arrays : std::false_type {};
+
+template<class Provisioner>
+struct row_major_arrays<Provisioner, typename std::enable_if<Provisioner::row_major>::type> : std::true_type {};
+
+template<class Provisioner, class Json, typename... Ts>
+std::shared_ptr<Base> bind_lazy(std::true_type, const std::string& type, const Json& values, const std::vector<size_t>* lengths, const std::string& sofar, Context& ctx, Ts... args) {
+    std::shared_ptr<Base> output;
+    auto bind = [&](auto ptr) -> void {
+        output.reset(ptr);
+        ptr->bind(&values, lengths, sofar);
+    };
+
+    if (type == "string") {
+        bind(Provisioner::new_String(args...));
+    } else if (type == "date") {
+        bind(Provisioner::new_Date(args...));
+    } else if (type == "integer") {
+        bind(Provisioner::new_Integer(args...));
+    } else if (type == "number") {
+        bind(Provisioner::new_Number(args...));
+    } else if (type == "boolean") {
+        bind(Provisioner::new_Boolean(args...));
+    } else {
+        ctx.status.fail(ErrorCode::INVALID_TYPE, sofar, "unrecognized \"%p.type\" of \"%s\"", Result::no_index, 0, type);
+    }
+
+    return output;
+}
+
+template<class Provisioner, class Json, typename... Ts>
+std::shared_ptr<Base> bind_lazy(std::false_type, const std::string&, const Json&, const std::vector<size_t>*, const std::string&, Context&, Ts...) {
+    return nullptr;
+}
+
+template<class Json, class Function>
+bool check_levels(const Json& levels, const std::string& sofar, std::unordered_map<std::string, size_t>& lookup, Result& status, Function store) {
+    lookup.clear();
+    for (size_t i = 0; i < levels.size(); ++i) {
+        const auto& l = levels[i];
+        if (!l.is_string()) {
+            return status.fail(ErrorCode::INVALID_LEVELS, sofar + ".levels", "\"%p[%i]\" should be a string", i);
+        }
+
+        const auto& curlev = l.template get_ref<const typename Json::string_t&>();
+        if (!lookup.emplace(curlev, i).second) {
+            return status.fail(ErrorCode::INVALID_LEVELS, sofar + ".levels", "\"%p[%i]\" is duplicated (%s)", i, 0, curlev);
+        }
+        store(i, l);
+    }
+    return true;
+}
+
+/*
+ * Identical levels are only validated once, and the same level table and
+ * lookup are reused for all factors that have those levels.
+ */
+// Returns NULL if the levels are invalid.
+template<class Json>
+const SharedLevels* share_levels(const Json& levels, const std::string& sofar, Context& ctx) {
+    auto& shared = ctx.scratch.shared_levels;
+    uint64_t hash = hash_json(levels);
+    auto range = shared.equal_range(hash);
+    for (auto it = range.first; it != range.second; ++it) {
+        if (fingerprint::equal(*static_cast<const Json*>(it->second.json), levels)) {
+            return &(it->second);
+        }
+    }
+
+    SharedLevels entry;
+    entry.json = &levels;
+    auto levvec = std::make_shared<std::vector<std::string> >(levels.size());
+    bool ok = check_levels(levels, sofar, entry.lookup, ctx.status, [&](size_t i, const Json& l) -> void {
+        (*levvec)[i] = l.template get_ref<const typename Json::string_t&>();
+    });
+    if (!ok) {
+        return nullptr;
+    }
+    entry.levels = std::move(levvec);
+    return &(shared.emplace(hash, std::move(entry))->second);
+}
+
+template<class Provisioner, class Json, typename... Ts>
+std::shared_ptr<Base> check_factors(const Json& j, const Json& values, const std::vector<size_t>* lengths, const std::string& sofar, bool ordered, Context& ctx, Ts... args) {
+    auto lIt = j.find("levels");
+    if (lIt == j.end() || !lIt->is_array()) {
+        ctx.status.fail(ErrorCode::INVALID_LEVELS, sofar + ".levels", "\"%p\" should be an array"); 
+        return nullptr;
+    }
+    const auto& levels = *lIt;
+
+    const auto& max_levels = ctx.options.limits.max_factor_levels;
+    if (levels.size() > max_levels) {
+        ctx.status.fail(ErrorCode::LIMIT_EXCEEDED, sofar + ".levels", "number of levels in \"%p\" exceeds the limit (%n)", Result::no_index, max_levels);
+        return nullptr;
+    }
+    if (!ctx.add_elements(levels.size(), sofar, ".levels")) {
+        return nullptr;
+    }
+    if (ctx.limits_string_bytes()) {
+        for (const auto& l : levels) {
+            if (l.is_string() && !ctx.add_string_bytes(l.template get_ref<const typename Json::string_t&>().size(), sofar, ".levels")) {
+                return nullptr;
+            }
+        }
+    }
+
+    auto fptr = Provisioner::new_Factor(args..., levels.size());
+    std::shared_ptr<Base> output(fptr);
+
+    const std::unordered_map<std::string, size_t>* lookup;
+    if (ctx.options.deduplicate) {
+        auto shared = share_levels(levels, sofar, ctx);
+        if (shared == nullptr) {
+            return nullptr;
+        }
+        if (!fptr->share_levels(shared->levels)) {
+            const auto& levvec = *(shared->levels);
+            for (size_t i = 0; i < levvec.size(); ++i) {
+                fptr->set_level(i, levvec[i]);
+            }
+        }
+        lookup = &(shared->lookup);
+
+    } else {
+        auto& levs = ctx.scratch.levels;
+        bool ok = check_levels(levels, sofar, levs, ctx.status, [&](size_t i, const Json& l) -> void {
+            fptr->set_level(i, take_string(l, ctx.consume));
+        });
+        if (!ok) {
+            return nullptr;
+        }
+        lookup = &levs;
+    }
+
+    if (ordered) {
+        fptr->is_ordered();
+    }
+
+    collect<size_t, true>(fptr, sofar, ctx, [&](auto* out) {
+        fill_values(values, lengths, out, ctx.status, [&](const Json& x, size_t i) -> size_t {
+            if (!x.is_string()) {
+                ctx.status.fail(ErrorCode::INVALID_VALUE, sofar + ".values", "\"%p[%i]\" should be a string", i);
+                return 0;
+            }
+            auto levIt = lookup->find(x.template get_ref<const typename Json::string_t&>());
+            if (levIt == lookup->end()) {
+                ctx.status.fail(ErrorCode::UNKNOWN_LEVEL, sofar + ".values", "\"%p[%i]\" should be present in \"%s.levels\"", i, 0, sofar);
+                return 0;
+            }
+            return levIt->second;
+        });
+    }, levels.size());
+
+    return output;
+}
+
+/*
+ * Converters for individual values, shared between eager parsing and lazy
+ * decoding. These assume that the value is not null. Upon failure, they
+ * record the error in 'status' and return a placeholder value.
+ */
+template<class Json>
+std::string convert_string(const Json& x, size_t i, const std::string& sofar, Result& status, bool consume = false) {
+    if (!x.is_string()) {
+        status.fail(ErrorCode::INVALID_VALUE, sofar + ".values", "\"%p[%i]\" should be a string", i);
+        return std::string();
+    }
+    return take_string(x, consume);
+}
+
+template<class Json>
+std::string convert_date(const Json& x, size_t i, const std::string& sofar, Result& status, bool consume = false) {
+    if (!x.is_string()) {
+        status.fail(ErrorCode::INVALID_VALUE, sofar + ".values", "\"%p[%i]\" should be a string", i);
+        return std::string();
+    }
+    if (!is_date(x.template get_ref<const typename Json::string_t&>())) {
+        status.fail(ErrorCode::INVALID_DATE, sofar + ".values", "\"%p[%i]\" should use a YYYY-MM-DD format", i);
+        return std::string();
+    }
+    return take_string(x, consume);
+}
+
+template<class Json>
+int32_t convert_integer(const Json& x, size_t i, const std::string& sofar, Result& status) {
+    // Integers stored as such (e.g., from BJData typed arrays) skip the conversion to double.
+    if (x.is_number_unsigned()) {
+        auto val = x.template get<uint64_t>();
+        if (val > static_cast<uint64_t>(std::numeric_limits<int32_t>::max())) {
+            status.fail(ErrorCode::OUT_OF_RANGE, sofar + ".values", "\"%p[%i]\" is out of 32-bit integer range", i);
+            return 0;
+        }
+        return val;
+    } else if (x.is_number_integer()) {
+        auto val = x.template get<int64_t>();
+        if (val < std::numeric_limits<int32_t>::min() || val > std::numeric_limits<int32_t>::max()) {
+            status.fail(ErrorCode::OUT_OF_RANGE, sofar + ".values", "\"%p[%i]\" is out of 32-bit integer range", i);
+            return 0;
+        }
+        return val;
+    }
+
+    if (!x.is_number()) {
+        status.fail(ErrorCode::INVALID_VALUE, sofar + ".values", "\"%p[%i]\" should be an integer", i);
+        return 0;
+    }
+    double val = x.template get<double>();
+
+    constexpr double upper_limit = std::numeric_limits<int32_t>::max();
+    constexpr double lower_limit = std::numeric_limits<int32_t>::min();
+    if (val < lower_limit || val > upper_limit) {
+        status.fail(ErrorCode::OUT_OF_RANGE, sofar + ".values", "\"%p[%i]\" is out of 32-bit integer range", i);
+        return 0;
+    }
+
+    if (!is_integer(val)) {
+        status.fail(ErrorCode::INVALID_VALUE, sofar + ".values", "\"%p[%i]\" should be an integer", i);
+        return 0;
+    }
+    return val;
+}
+
+template<class Json>
+double convert_number(const Json& x, size_t i, const std::string& sofar, Result& status) {
+    if (!x.is_number()) {
+        status.fail(ErrorCode::INVALID_VALUE, sofar + ".values", "\"%p[%i]\" should be a number", i);
+        return 0;
+    }
+    return x.template get<double>();
+}
+
+template<class Json>
+unsigned char convert_boolean(const Json& x, size_t i, const std::string& sofar, Result& status) {
+    if (!x.is_boolean()) {
+        status.fail(ErrorCode::INVALID_VALUE, sofar + ".values", "\"%p[%i]\" should be a boolean", i);
+        return 0;
+    }
+    return x.template get<bool>();
+}
+
+template<class Provisioner, class Json, typename... Ts>
+std::shared_ptr<Base> check_values(const std::string& type, const Json& values, const std::vector<size_t>* lengths, const Json& j, const std::string& sofar, Context& ctx, Ts... args) {
+    if (skips_values<Provisioner>::value) {
+        return check_shape<Provisioner>(type, values, lengths, j, sofar, ctx, args...);
+    }
+
+    if (lazy_values<Provisioner>::value && type != "factor" && type != "ordered" && !ctx.transient_values) {
+        if (!defers_validation<Provisioner>::value) {
+            check_values<DummyProvisioner>(type, values, lengths, j, sofar, ctx, args...);
+            if (ctx.failed()) {
+                return nullptr;
+            }
+        }
+        return bind_lazy<Provisioner>(lazy_values<Provisioner>(), type, values, lengths, sofar, ctx, args...);
+    }
+
+    std::shared_ptr<Base> output;
+
+    // Checking values.
+    if (type == "string") {
+        auto ptr = Provisioner::new_String(args...);
+        output.reset(ptr);
+        auto dest = destination<std::string>(ptr);
+        collect<std::string>(&dest, sofar, ctx, [&](auto* out) {
+            fill_values(values, lengths, out, ctx.status, [&](const Json& x, size_t i) -> std::string {
+                return convert_string(x, i, sofar, ctx.status, ctx.consume);
+            });
+        });
+
+    } else if (type == "date") {
+        auto ptr = Provisioner::new_Date(args...);
+        output.reset(ptr);
+        auto dest = destination<std::string>(ptr);
+        collect<std::string>(&dest, sofar, ctx, [&](auto* out) {
+            fill_values(values, lengths, out, ctx.status, [&](const Json& x, size_t i) -> std::string {
+                return convert_date(x, i, sofar, ctx.status, ctx.consume);
+            });
+        });
+
+    } else if (type == "factor" || type == "ordered") {
+        output = check_factors<Provisioner>(j, values, lengths, sofar, (type == "ordered"), ctx, args...);
+
+    } else if (type == "integer") {
+        auto ptr = Provisioner::new_Integer(args...);
+        output.reset(ptr);
+        auto dest = destination<int32_t>(ptr);
+        collect<int32_t>(&dest, sofar, ctx, [&](auto* out) {
+            fill_values(values, lengths, out, ctx.status, [&](const Json& x, size_t i) -> int32_t {
+                return convert_integer(x, i, sofar, ctx.status);
+            });
+        });
+
+    } else if (type == "number") {
+        auto ptr = Provisioner::new_Number(args...);
+        output.reset(ptr);
+        auto dest = destination<double>(ptr);
+        collect<double>(&dest, sofar, ctx, [&](auto* out) {
+            fill_values(values, lengths, out, ctx.status, [&](const Json& x, size_t i) -> double {
+                return convert_number(x, i, sofar, ctx.status);
+            });
+        });
+
+    } else if (type == "boolean") {
+        auto ptr = Provisioner::new_Boolean(args...);
+        output.reset(ptr);
+        auto dest = destination<unsigned char>(ptr);
+        collect<unsigned char>(&dest, sofar, ctx, [&](auto* out) {
+            fill_values(values, lengths, out, ctx.status, [&](const Json& x, size_t i) -> unsigned char {
+                return convert_boolean(x, i, sofar, ctx.status);
+            });
+        });
+
+    } else {
+        ctx.status.fail(ErrorCode::INVALID_TYPE, sofar, "unrecognized \"%p.type\" of \"%s\"", Result::no_index, 0, type);
+    }
+
+    return output;
+}
+
+template<class Json>
+bool check_sequence_field(const Json& j, const char* field, const std::string& sofar, double& output, Result& status) {
+    auto fIt = j.find(field);
+    if (fIt == j.end() || !fIt->is_number()) {
+        return status.fail(ErrorCode::INVALID_ENCODING, sofar + "." + field, "\"%p\" should be a number for \"sequence\" encoding");
+    }
+    output = fIt->template get<double>();
+    return true;
+}
+
+template<class Provisioner, typename... Ts>
+std::shared_ptr<Base> check_sequence(const std::string& type, double start, double step, size_t len, const std::string& sofar, Context& ctx, Ts... args) {
+    std::shared_ptr<Base> output;
+
+    if (type == "integer") {
+        if (!is_integer(start) || !is_integer(step)) {
+            ctx.status.fail(ErrorCode::INVALID_ENCODING, sofar, "\"%p.start\" and \"%p.step\" should be integers for an integer sequence");
+            return nullptr;
+        }
+
+        // Only the endpoints need to be checked, as the sequence is monotonic.
+        double last = (len ? start + step * static_cast<double>(len - 1) : start);
+        constexpr double upper_limit = std::numeric_limits<int32_t>::max();
+        constexpr double lower_limit = std::numeric_limits<int32_t>::min();
+        if (start < lower_limit || start > upper_limit || last < lower_limit || last > upper_limit) {
+            ctx.status.fail(ErrorCode::OUT_OF_RANGE, sofar, "\"%p\" sequence is out of 32-bit integer range");
+            return nullptr;
+        }
+
+        auto ptr = Provisioner::new_Integer(args...);
+        output.reset(ptr);
+        auto dest = destination<int32_t>(ptr);
+        collect<int32_t>(&dest, sofar, ctx, [&](auto* out) {
+            int64_t current = start, istep = step;
+            for (size_t i = 0; i < len; ++i, current += istep) {
+                out->set(i, current);
+            }
+        });
+
+    } else if (type == "number") {
+        auto ptr = Provisioner::new_Number(args...);
+        output.reset(ptr);
+        auto dest = destination<double>(ptr);
+        collect<double>(&dest, sofar, ctx, [&](auto* out) {
+            for (size_t i = 0; i < len; ++i) {
+                out->set(i, start + step * static_cast<double>(i));
+            }
+        });
+
+    } else {
+        ctx.status.fail(ErrorCode::INVALID_ENCODING, sofar + ".encoding", "\"%p\" of \"sequence\" is only supported for \"integer\" or \"number\" types");
+    }
+
+    return output;
+}
+
+// Returns zero for unsupported types.
+inline size_t binary_width(const std::string& type, const std::string& sofar, Result& status) {
+    if (type == "integer") {
+        return sizeof(int32_t);
+    } else if (type == "number") {
+        return sizeof(double);
+    } else if (type == "boolean") {
+        return 1;
     }
+    status.fail(ErrorCode::INVALID_ENCODING, sofar + ".encoding", "\"%p\" of \"base64\" is only supported for \"integer\", \"number\" or \"boolean\" types");
+    return 0;
+}
 
-    for (size_t i = 0; i < n; ++i) {
-        if (!j[i].is_string()) {
-            throw std::runtime_error("\"" + sofar + "[" + std::to_string(i) + "]\" should be a string");
+template<typename T, class Pointer, class Function>
+void fill_binary(const std::vector<unsigned char>& bytes, const std::vector<unsigned char>* validity, Pointer* ptr, Function check) {
+    size_t n = bytes.size() / sizeof(T);
+    const unsigned char* src = bytes.data();
+    for (size_t i = 0; i < n; ++i, src += sizeof(T)) {
+        if (validity && !((*validity)[i / 8] & (1u << (i % 8)))) {
+            ptr->set_missing(i);
+        } else {
+            T val = read_little_endian<T>(src);
+            if (!check(val, i)) {
+                return;
+            }
+            ptr->set(i, val);
         }
-        vec->set_name(i, j[i].template get<std::string>());
     }
 }
 
-template<class Provisioner, class Json, typename... Ts>
-std::shared_ptr<Base> check_factors(const Json& j, const Json& values, const std::string& sofar, bool ordered, Ts... args) {
-    auto lIt = j.find("levels");
-    if (lIt == j.end() || !lIt->is_array()) {
-        throw std::runtime_error("\"" + sofar + ".levels\" should be an array"); 
-    }
-    const auto& levels = *lIt;
+template<class Provisioner, typename... Ts>
+std::shared_ptr<Base> check_binary(const std::string& type, const std::vector<unsigned char>& bytes, const std::vector<unsigned char>* validity, const std::string& sofar, Context& ctx, Ts... args) {
+    std::shared_ptr<Base> output;
 
-    auto fptr = Provisioner::new_Factor(args..., levels.size());
-    std::shared_ptr<Base> output(fptr);
+    if (type == "integer") {
+        auto ptr = Provisioner::new_Integer(args...);
+        output.reset(ptr);
+        auto dest = destination<int32_t>(ptr);
+        collect<int32_t>(&dest, sofar, ctx, [&](auto* out) {
+            fill_binary<int32_t>(bytes, validity, out, [](int32_t, size_t) -> bool { return true; });
+        });
 
-    std::unordered_map<std::string, size_t> levs;
-    for (size_t i = 0; i < levels.size(); ++i) {
-        const auto& l = levels[i];
-        if (!l.is_string()) {
-            throw std::runtime_error("\"" + sofar + ".levels[" + std::to_string(i) + "]\" should be a string");
-        }
+    } else if (type == "number") {
+        auto ptr = Provisioner::new_Number(args...);
+        output.reset(ptr);
+        auto dest = destination<double>(ptr);
+        collect<double>(&dest, sofar, ctx, [&](auto* out) {
+            fill_binary<double>(bytes, validity, out, [](double, size_t) -> bool { return true; });
+        });
 
-        auto curlev = l.template get<std::string>();
-        if (levs.find(curlev) != levs.end()) {
-            throw std::runtime_error("\"" + sofar + ".levels[" + std::to_string(i) + "]\" is duplicated (" + curlev + ")");
-        }
+    } else {
+        auto ptr = Provisioner::new_Boolean(args...);
+        output.reset(ptr);
+        auto dest = destination<unsigned char>(ptr);
+        collect<unsigned char>(&dest, sofar, ctx, [&](auto* out) {
+            fill_binary<unsigned char>(bytes, validity, out, [&](unsigned char val, size_t i) -> bool {
+                if (val > 1) {
+                    return ctx.status.fail(ErrorCode::INVALID_VALUE, sofar + ".values", "\"%p[%i]\" should be a boolean (0 or 1)", i);
+                }
+                return true;
+            });
+        });
+    }
+
+    return output;
+}
 
-        levs[curlev] = i;
-        fptr->set_level(i, curlev); 
+/*
+ * Provisioners can optionally provide 'new_*Scalar(value)' methods to
+ * create length-1 vectors with the value already in place, avoiding the
+ * separate allocation of a one-element buffer and the per-element calls.
+ * Each hook is detected separately so that any subset can be provided.
+ */
+struct IntegerScalar {
+    typedef int32_t value_type;
+    template<class Provisioner>
+    static auto create(int32_t v) -> decltype(Provisioner::new_IntegerScalar(v)) { return Provisioner::new_IntegerScalar(v); }
+};
+
+struct NumberScalar {
+    typedef double value_type;
+    template<class Provisioner>
+    static auto create(double v) -> decltype(Provisioner::new_NumberScalar(v)) { return Provisioner::new_NumberScalar(v); }
+};
+
+struct BooleanScalar {
+    typedef unsigned char value_type;
+    template<class Provisioner>
+    static auto create(unsigned char v) -> decltype(Provisioner::new_BooleanScalar(v)) { return Provisioner::new_BooleanScalar(v); }
+};
+
+struct StringScalar {
+    typedef std::string value_type;
+    template<class Provisioner>
+    static auto create(std::string v) -> decltype(Provisioner::new_StringScalar(std::move(v))) { return Provisioner::new_StringScalar(std::move(v)); }
+};
+
+struct DateScalar {
+    typedef std::string value_type;
+    template<class Provisioner>
+    static auto create(std::string v) -> decltype(Provisioner::new_DateScalar(std::move(v))) { return Provisioner::new_DateScalar(std::move(v)); }
+};
+
+template<class Provisioner, class Hook, typename = void>
+struct has_scalar : std::false_type {};
+
+template<class Provisioner, class Hook>
+struct has_scalar<Provisioner, Hook, decltype((void)Hook::template create<Provisioner>(std::declval<typename Hook::value_type>()))> : std::true_type {};
+
+template<class Provisioner>
+struct has_any_scalar : std::integral_constant<bool,
+    has_scalar<Provisioner, IntegerScalar>::value ||
+    has_scalar<Provisioner, NumberScalar>::value ||
+    has_scalar<Provisioner, BooleanScalar>::value ||
+    has_scalar<Provisioner, StringScalar>::value ||
+    has_scalar<Provisioner, DateScalar>::value
+> {};
+
+template<class Provisioner, class Hook, class Function>
+std::shared_ptr<Base> new_scalar(std::true_type, const std::string& sofar, Context& ctx, Function convert) {
+    auto val = convert();
+    if (ctx.failed()) {
+        return nullptr;
     }
+    auto stats = ctx.options.statistics;
+    if (stats) {
+        auto& summary = stats->nodes[sofar];
+        summary = Summary();
+        statistics::Tracker tracker(summary);
+        tracker.add(val);
+        tracker.finish();
+    }
+    return std::shared_ptr<Base>(Hook::template create<Provisioner>(std::move(val)));
+}
 
-    if (ordered) {
-        fptr->is_ordered();
+template<class Provisioner, class Hook, class Function>
+std::shared_ptr<Base> new_scalar(std::false_type, const std::string&, Context&, Function) {
+    return nullptr;
+}
+
+template<class Provisioner, class Json>
+std::shared_ptr<Base> check_scalar(const std::string& type, const Json& x, const std::string& sofar, Context& ctx) {
+    if (x.is_null()) {
+        return nullptr;
     }
 
-    for (size_t i = 0; i < values.size(); ++i) {
-        const auto& x = values[i];
-        if (x.is_null()) {
-            fptr->set_missing(i);
-        } else if (x.is_string()) {
-            std::string val = x.template get<std::string>();
-            auto levIt = levs.find(val);
-            if (levIt == levs.end()) {
-                throw std::runtime_error("\"" + sofar + ".values[" + std::to_string(i) + "]\" should be present in \"" + sofar + ".levels\"");
-            }
-            fptr->set(i, levIt->second);
-        } else {
-            throw std::runtime_error("\"" + sofar + ".values[" + std::to_string(i) + "]\" should be a string");
-        }
+    if (type == "integer") {
+        return new_scalar<Provisioner, IntegerScalar>(has_scalar<Provisioner, IntegerScalar>(), sofar, ctx, [&]() -> int32_t { return convert_integer(x, 0, sofar, ctx.status); });
+    } else if (type == "number") {
+        return new_scalar<Provisioner, NumberScalar>(has_scalar<Provisioner, NumberScalar>(), sofar, ctx, [&]() -> double { return convert_number(x, 0, sofar, ctx.status); });
+    } else if (type == "boolean") {
+        return new_scalar<Provisioner, BooleanScalar>(has_scalar<Provisioner, BooleanScalar>(), sofar, ctx, [&]() -> unsigned char { return convert_boolean(x, 0, sofar, ctx.status); });
+    } else if (type == "string") {
+        return new_scalar<Provisioner, StringScalar>(has_scalar<Provisioner, StringScalar>(), sofar, ctx, [&]() -> std::string { return convert_string(x, 0, sofar, ctx.status, ctx.consume); });
+    } else if (type == "date") {
+        return new_scalar<Provisioner, DateScalar>(has_scalar<Provisioner, DateScalar>(), sofar, ctx, [&]() -> std::string { return convert_date(x, 0, sofar, ctx.status, ctx.consume); });
     }
 
-    return output;
+    return nullptr;
 }
 
-template<class Provisioner, class Json, typename... Ts>
-std::shared_ptr<Base> check_values(const std::string& type, const Json& values, const Json& j, const std::string& sofar, Ts... args) {
-    std::shared_ptr<Base> output;
+template<class Provisioner, class Json>
+inline std::shared_ptr<Base> check_simple_object(const std::string& type, const Json& j, const std::string& sofar, Context& ctx) {
+    // Figuring out the encoding of the values.
+    std::string encoding = "none";
+    auto eIt = j.find("encoding");
+    if (eIt != j.end()) {
+        if (!eIt->is_string()) {
+            ctx.status.fail(ErrorCode::INVALID_ENCODING, sofar + ".encoding", "\"%p\" should be a string");
+            return nullptr;
+        }
+        encoding = eIt->template get<std::string>();
+    }
 
-    // Checking values.
-    if (type == "string") {
-        auto ptr = Provisioner::new_String(args...);
-        output.reset(ptr);
-        for (size_t i = 0; i < values.size(); ++i) {
-            const auto& x = values[i];
-            if (x.is_null()) {
-                ptr->set_missing(i);
-            } else if (x.is_string()) {
-                ptr->set(i, x.template get<std::string>());
-            } else {
-                throw std::runtime_error("\"" + sofar + ".values[" + std::to_string(i) + "]\" should be a string");
+    const Json* values = nullptr;
+    auto& lengths = ctx.scratch.lengths;
+    const std::vector<size_t>* lptr = nullptr;
+    double start = 0, step = 0;
+    auto& bytes = ctx.scratch.bytes;
+    auto& validity = ctx.scratch.validity;
+    bool binary = false, has_validity = false;
+    auto& typed_sizes = ctx.scratch.typed_sizes;
+    bool typed = false;
+    size_t len = 0;
+
+    if (encoding == "base64") {
+        size_t width = binary_width(type, sofar, ctx.status);
+        if (width == 0) {
+            return nullptr;
+        }
+        auto vIt = j.find("values");
+        if (vIt == j.end() || !vIt->is_string()) {
+            ctx.status.fail(ErrorCode::INVALID_VALUES, sofar + ".values", "\"%p\" should be a string for \"base64\" encoding");
+            return nullptr;
+        }
+        if (!base64_decode(vIt->template get_ref<const std::string&>(), bytes)) {
+            ctx.status.fail(ErrorCode::INVALID_VALUES, sofar + ".values", "\"%p\" should be a valid base64 string");
+            return nullptr;
+        }
+        if (bytes.size() % width != 0) {
+            ctx.status.fail(ErrorCode::INVALID_VALUES, sofar + ".values", "\"%p\" should decode to a multiple of %n bytes", Result::no_index, width);
+            return nullptr;
+        }
+        len = bytes.size() / width;
+        binary = true;
+
+        auto mIt = j.find("validity");
+        if (mIt != j.end()) {
+            if (!mIt->is_string() || !base64_decode(mIt->template get_ref<const std::string&>(), validity)) {
+                ctx.status.fail(ErrorCode::INVALID_VALUES, sofar + ".validity", "\"%p\" should be a valid base64 string");
+                return nullptr;
+            }
+            if (validity.size() != (len + 7) / 8) {
+                ctx.status.fail(ErrorCode::INVALID_VALUES, sofar + ".validity", "\"%p\" should decode to %n bytes", Result::no_index, (len + 7) / 8);
+                return nullptr;
             }
+            has_validity = true;
         }
 
-    } else if (type == "date") {
-        auto ptr = Provisioner::new_Date(args...);
-        output.reset(ptr);
-        for (size_t i = 0; i < values.size(); ++i) {
-            const auto& x = values[i];
-            if (x.is_null()) {
-                ptr->set_missing(i);
-            } else if (x.is_string()) {
-                std::string val = x.template get<std::string>();
-                if (!is_date(val)) {
-                    throw std::runtime_error("\"" + sofar + ".values[" + std::to_string(i) + "]\" should use a YYYY-MM-DD format");
-                }
-                ptr->set(i, val);
-            } else {
-                throw std::runtime_error("\"" + sofar + ".values[" + std::to_string(i) + "]\" should be a string");
+    } else if (encoding == "sequence") {
+        double l = 0;
+        if (!check_sequence_field(j, "start", sofar, start, ctx.status) || !check_sequence_field(j, "step", sofar, step, ctx.status) || !check_sequence_field(j, "length", sofar, l, ctx.status)) {
+            return nullptr;
+        }
+        if (!is_integer(l) || !fits_size(l)) {
+            ctx.status.fail(ErrorCode::INVALID_ENCODING, sofar + ".length", "\"%p\" should be a non-negative integer for \"sequence\" encoding");
+            return nullptr;
+        }
+        len = l;
+
+    } else {
+        auto vIt = j.find("values");
+        if (vIt == j.end()) {
+            ctx.status.fail(ErrorCode::INVALID_VALUES, sofar + ".values", "\"%p\" should be an array");
+            return nullptr;
+        } else if (vIt->is_object()) {
+            values = unwrap_typed_array(*vIt, typed_sizes, sofar, ctx.status);
+            if (values == nullptr) {
+                return nullptr;
             }
+            typed = true;
+        } else if (vIt->is_array()) {
+            values = &(*vIt);
+        } else {
+            ctx.status.fail(ErrorCode::INVALID_VALUES, sofar + ".values", "\"%p\" should be an array");
+            return nullptr;
         }
 
-    } else if (type == "factor" || type == "ordered") {
-        output = check_factors<Provisioner>(j, values, sofar, (type == "ordered"), args...);
+        if (encoding == "none") {
+            len = values->size();
 
-    } else if (type == "integer") {
-        auto ptr = Provisioner::new_Integer(args...);
-        output.reset(ptr);
-        for (size_t i = 0; i < values.size(); ++i) {
-            const auto& x = values[i];
-            if (x.is_null()) {
-                ptr->set_missing(i);
-            } else if (x.is_number()) {
-                double val = x.template get<double>();
+        } else if (encoding == "rle") {
+            auto rIt = j.find("lengths");
+            if (rIt == j.end() || !rIt->is_array() || rIt->size() != values->size()) {
+                ctx.status.fail(ErrorCode::INVALID_LENGTHS, sofar + ".lengths", "\"%p\" should be an array of length equal to \"%s.values\" for \"rle\" encoding", Result::no_index, 0, sofar);
+                return nullptr;
+            }
 
-                constexpr double upper_limit = std::numeric_limits<int32_t>::max();
-                constexpr double lower_limit = std::numeric_limits<int32_t>::min();
-                if (val < lower_limit || val > upper_limit) {
-                    throw std::runtime_error("\"" + sofar + ".values[" + std::to_string(i) + "]\" is out of 32-bit integer range");
+            lengths.resize(values->size());
+            for (size_t r = 0; r < lengths.size(); ++r) {
+                const auto& current = (*rIt)[r];
+                bool fail = true;
+                if (current.is_number()) {
+                    double val = current.template get<double>();
+                    if (is_integer(val) && fits_size(val)) {
+                        lengths[r] = val;
+                        fail = false;
+                    }
                 }
-
-                if (!is_integer(val)) {
-                    throw std::runtime_error("\"" + sofar + ".values[" + std::to_string(i) + "]\" should be an integer");
+                if (fail) {
+                    ctx.status.fail(ErrorCode::INVALID_LENGTHS, sofar + ".lengths", "\"%p[%i]\" should be a non-negative integer", r);
+                    return nullptr;
                 }
-                ptr->set(i, val);
-            } else {
-                throw std::runtime_error("\"" + sofar + ".values[" + std::to_string(i) + "]\" should be an integer");
+                if (lengths[r] > std::numeric_limits<size_t>::max() - len) {
+                    ctx.status.fail(ErrorCode::SIZE_OVERFLOW, sofar + ".lengths", "sum of \"%p\" overflows");
+                    return nullptr;
+                }
+                len += lengths[r];
             }
-        }
+            lptr = &lengths;
 
-    } else if (type == "number") {
-        auto ptr = Provisioner::new_Number(args...);
-        output.reset(ptr);
-        for (size_t i = 0; i < values.size(); ++i) {
-            const auto& x = values[i];
-            if (x.is_null()) {
-                ptr->set_missing(i);
-            } else if (x.is_number()) {
-                ptr->set(i, x.template get<double>());
-            } else {
-                throw std::runtime_error("\"" + sofar + ".values[" + std::to_string(i) + "]\" should be a number");
-            }
+        } else {
+            ctx.status.fail(ErrorCode::INVALID_ENCODING, sofar + ".encoding", "unrecognized \"%p\" of \"%s\"", Result::no_index, 0, encoding);
+            return nullptr;
         }
+    }
 
-    } else if (type == "boolean") {
-        auto ptr = Provisioner::new_Boolean(args...);
-        output.reset(ptr);
-        for (size_t i = 0; i < values.size(); ++i) {
-            const auto& x = values[i];
-            if (x.is_null()) {
-                ptr->set_missing(i);
-            } else if (x.is_boolean()) {
-                ptr->set(i, x.template get<bool>());
-            } else {
-                throw std::runtime_error("\"" + sofar + ".values[" + std::to_string(i) + "]\" should be a boolean");
+    // A typed array must be 1-dimensional unless it holds the values of an array, see below.
+    bool typed_nd = typed && encoding == "none" && j.find("dimensions") != j.end();
+    if (typed && !typed_nd && typed_sizes.size() != 1) {
+        ctx.status.fail(ErrorCode::INVALID_VALUES, sofar + ".values", "\"%p._ArraySize_\" should have length 1");
+        return nullptr;
+    }
+
+    // Enforcing limits before any allocation by the provisioner.
+    if (!ctx.check_node_elements(len, sofar) || !ctx.add_elements(len, sofar)) {
+        return nullptr;
+    }
+    if (values && ctx.limits_string_bytes() && (type == "string" || type == "date")) {
+        for (size_t r = 0; r < values->size(); ++r) {
+            const auto& x = (*values)[r];
+            if (x.is_string()) {
+                size_t nbytes = x.template get_ref<const typename Json::string_t&>().size();
+                size_t copies = (lptr ? lengths[r] : 1);
+                if (copies && nbytes > std::numeric_limits<size_t>::max() / copies) {
+                    nbytes = std::numeric_limits<size_t>::max();
+                } else {
+                    nbytes *= copies;
+                }
+                if (!ctx.add_string_bytes(nbytes, sofar, ".values")) {
+                    return nullptr;
+                }
             }
         }
-
-    } else {
-        throw std::runtime_error("unrecognized \"" + sofar + ".type\" of \"" + type + "\"");
     }
 
-    return output;
-}
-
-template<class Provisioner, class Json>
-inline std::shared_ptr<Base> check_simple_object(const std::string& type, const Json& j, const std::string& sofar) {
-    auto vIt = j.find("values");
-    if (vIt == j.end() || !vIt->is_array()) {
-        throw std::runtime_error("\"" + sofar + ".values\" should be an array");
-    }
-    const auto& values = *vIt;
-    size_t len = values.size();
+    auto populate = [&](auto... args) -> std::shared_ptr<Base> {
+        if (binary) {
+            return check_binary<Provisioner>(type, bytes, (has_validity ? &validity : nullptr), sofar, ctx, args...);
+        } else if (values == nullptr) {
+            return check_sequence<Provisioner>(type, start, step, len, sofar, ctx, args...);
+        } else {
+            return check_values<Provisioner>(type, *values, lptr, j, sofar, ctx, args...);
+        }
+    };
 
     // Checking if we're dealing with an array.
     auto dimIt = j.find("dimensions");
     if (dimIt == j.end()) {
-        auto ptr = check_values<Provisioner>(type, values, j, sofar, len);
+        std::shared_ptr<Base> ptr;
+        if (has_any_scalar<Provisioner>::value && !skips_values<Provisioner>::value && len == 1 && values && lptr == nullptr) {
+            ptr = check_scalar<Provisioner>(type, (*values)[0], sofar, ctx);
+        }
+        if (!ptr && !ctx.failed()) {
+            ptr = populate(len);
+        }
+        if (ctx.failed()) {
+            return nullptr;
+        }
         Vector* vptr = static_cast<Vector*>(ptr.get());
 
         auto namIt = j.find("names");
         if (namIt != j.end()) {
             vptr->use_names();
-            check_names(*namIt, values.size(), vptr, sofar + ".names");
+            if (!check_names(*namIt, len, vptr, sofar, ctx)) {
+                return nullptr;
+            }
         }
 
         return ptr;
@@ -232,7 +1502,8 @@ inline std::shared_ptr<Base> check_simple_object(const std::string& type, const
 
     // Storing the dimensions.
     if (!dimIt->is_array() || dimIt->size() == 0) {
-        throw std::runtime_error("\"" + sofar + ".dimensions\" should be an non-empty array");
+        ctx.status.fail(ErrorCode::INVALID_DIMENSIONS, sofar + ".dimensions", "\"%p\" should be an non-empty array");
+        return nullptr;
     }
     const auto& dimensions = *dimIt;
 
@@ -244,28 +1515,58 @@ inline std::shared_ptr<Base> check_simple_object(const std::string& type, const
 
         if (current.is_number()) {
             double val = current.template get<double>();
-            if (is_integer(val) && val >= 0) {
+            if (is_integer(val) && fits_size(val)) {
                 dims[d] = val;
-                prod *= val;
                 fail = false;
             }
         }
         if (fail) {
-            throw std::runtime_error("\"" + sofar + ".dimensions[" + std::to_string(d) + "]\" should be a non-negative integer");
+            ctx.status.fail(ErrorCode::INVALID_DIMENSIONS, sofar + ".dimensions", "\"%p[%i]\" should be a non-negative integer", d);
+            return nullptr;
+        }
+
+        if (dims[d] && prod > std::numeric_limits<size_t>::max() / dims[d]) {
+            ctx.status.fail(ErrorCode::SIZE_OVERFLOW, sofar + ".dimensions", "product of \"%p\" overflows");
+            return nullptr;
         }
+        prod *= dims[d];
     }
     if (prod != len) {
-        throw std::runtime_error("product of \"" + sofar + ".dimensions\" should be equal to length of \"" + sofar + ".values\"");
+        ctx.status.fail(ErrorCode::INVALID_DIMENSIONS, sofar + ".dimensions", "product of \"%p\" should be equal to length of \"%s.values\"", Result::no_index, 0, sofar);
+        return nullptr;
+    }
+
+    Json reordered;
+    if (typed_nd) {
+        if (typed_sizes != dims) {
+            ctx.status.fail(ErrorCode::INVALID_DIMENSIONS, sofar + ".dimensions", "\"%s.values._ArraySize_\" should be equal to \"%p\"", Result::no_index, 0, sofar);
+            return nullptr;
+        }
+        if (dims.size() > 1) {
+            reorder_typed_array(*values, dims, reordered);
+            values = &reordered;
+            ctx.transient_values = true;
+        }
     }
 
-    auto ptr = check_values<Provisioner>(type, values, j, sofar, dims);
+    static_assert(!row_major_arrays<Provisioner>::value || (!skips_values<Provisioner>::value && !lazy_values<Provisioner>::value), "row-major order is not supported for provisioners that skip or lazily decode values");
+    if (row_major_arrays<Provisioner>::value) {
+        ctx.row_major = &dims;
+    }
+    auto ptr = populate(dims);
+    ctx.row_major = nullptr;
+    ctx.transient_values = false;
+    if (ctx.failed()) {
+        return nullptr;
+    }
     Array* aptr = static_cast<Array*>(ptr.get());
 
     // Checking if we need to check the names.
     auto namIt = j.find("names");
     if (namIt != j.end()) {
         if (!namIt->is_array() || namIt->size() != dims.size()) {
-            throw std::runtime_error("\"" + sofar + ".names\" should be an array of length equal to \"" + sofar + ".dimensions\"");
+            ctx.status.fail(ErrorCode::INVALID_NAMES, sofar + ".names", "\"%p\" should be an array of length equal to \"%s.dimensions\"", Result::no_index, 0, sofar);
+            return nullptr;
         }
         const auto& names = *namIt;
 
@@ -274,162 +1575,568 @@ inline std::shared_ptr<Base> check_simple_object(const std::string& type, const
             if (!dimname.is_null()) {
                 aptr->use_names(d);
                 if (!dimname.is_array() || dimname.size() != dims[d]) {
-                    auto xpath = sofar + ".names[" + std::to_string(d) + "]";
-                    throw std::runtime_error("\"" + xpath + "\" should be an array of length " + std::to_string(dims[d]));
+                    ctx.status.fail(ErrorCode::INVALID_NAMES, sofar + ".names[" + std::to_string(d) + "]", "\"%p\" should be an array of length %n", Result::no_index, dims[d]);
+                    return nullptr;
                 }
 
                 for (size_t i = 0; i < dimname.size(); ++i) {
                     const auto& x = dimname[i];
                     if (!x.is_string()) {
-                        auto xpath = sofar + ".names[" + std::to_string(d) + "]";
-                        throw std::runtime_error("\"" + xpath + "[" + std::to_string(i) + "]\" should be a string");
+                        ctx.status.fail(ErrorCode::INVALID_NAMES, sofar + ".names[" + std::to_string(d) + "]", "\"%p[%i]\" should be a string", i);
+                        return nullptr;
+                    }
+                    auto name = take_string(x, ctx.consume);
+                    if (!ctx.add_string_bytes(name.size(), sofar, ".names")) {
+                        return nullptr;
                     }
-                    aptr->set_name(d, i, x.template get<std::string>());
+                    aptr->set_name(d, i, std::move(name));
+                }
+            }
+        }
+    }
+
+    return ptr;
+}
+
+/*
+ * Only comparing the keys that are used by the validator, consistent with
+ * hash_node(). This never recurses, regardless of what is in 'j'.
+ */
+template<class Json>
+bool same_node(const Json& previous, const Json& j) {
+    for (const auto& field : fingerprint::node_fields()) {
+        auto pIt = previous.find(field);
+        auto jIt = j.find(field);
+        bool pfound = (pIt != previous.end()), jfound = (jIt != j.end());
+        if (pfound != jfound) {
+            return false;
+        }
+        if (pfound && !fingerprint::equal(*pIt, *jIt)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/*
+ * Returning a previously parsed node if it is identical to 'j', otherwise
+ * creating a new node and remembering it for later. Nodes created by the
+ * DummyProvisioner (e.g., in unselected subtrees) are not shared with
+ * the actual Provisioner. Keys that are ignored by the validator are
+ * neither hashed nor compared.
+ */
+template<class Provisioner, class Json, class Function>
+std::shared_ptr<Base> deduplicate(const Json& j, const std::string& sofar, Context& ctx, uint64_t& hash, Function create) {
+    hash = hash_node(j);
+    constexpr bool materialized = !std::is_same<Provisioner, DummyProvisioner>::value;
+    auto& shared = ctx.scratch.shared;
+
+    auto range = shared.equal_range(hash);
+    for (auto it = range.first; it != range.second; ++it) {
+        const auto& entry = it->second;
+        if (entry.materialized == materialized && same_node(*static_cast<const Json*>(entry.json), j)) {
+            auto stats = ctx.options.statistics;
+            if (stats) {
+                auto sIt = stats->nodes.find(entry.path);
+                if (sIt != stats->nodes.end()) {
+                    auto copy = sIt->second;
+                    stats->nodes[sofar] = std::move(copy);
                 }
             }
+            return entry.node;
+        }
+    }
+
+    auto output = create();
+    if (ctx.failed()) { // nothing worth remembering.
+        return output;
+    }
+    SharedNode entry;
+    entry.json = &j;
+    entry.node = output;
+    entry.materialized = materialized;
+    if (ctx.options.statistics) { // only needed to copy the statistics, so we don't pay for the path otherwise.
+        entry.path = sofar;
+    }
+    shared.emplace(hash, std::move(entry));
+    return output;
+}
+
+template<class Provisioner, class Json>
+std::shared_ptr<Base> check_column(const Json& curobj, const std::string& curpath, size_t nr, const std::string& sofar, Context& ctx) {
+    auto tIt = curobj.find("type");
+    if (tIt == curobj.end() || !tIt->is_string()) {
+        ctx.status.fail(ErrorCode::INVALID_TYPE, curpath, "\"%p.type\" should be a string");
+        return nullptr;
+    }
+
+    std::shared_ptr<Base> ptr;
+    if (ctx.options.deduplicate) {
+        uint64_t hash;
+        ptr = deduplicate<Provisioner>(curobj, curpath, ctx, hash, [&]() -> std::shared_ptr<Base> {
+            return check_simple_object<Provisioner>(tIt->template get<std::string>(), curobj, curpath, ctx);
+        });
+    } else {
+        ptr = check_simple_object<Provisioner>(tIt->template get<std::string>(), curobj, curpath, ctx);
+    }
+    if (ctx.failed()) {
+        return nullptr;
+    }
+
+    if (is_vector(ptr->type())) {
+        auto vptr = static_cast<Vector*>(ptr.get());
+        if (vptr->size() != nr) {
+            ctx.status.fail(ErrorCode::INVALID_DATA_FRAME, curpath, "size of \"%p\" is not consistent with \"%s.rows\"", Result::no_index, 0, sofar);
+            return nullptr;
+        }
+    } else if (is_array(ptr->type())) {
+        auto aptr = static_cast<Array*>(ptr.get());
+        if (aptr->first_dim() != nr) {
+            ctx.status.fail(ErrorCode::INVALID_DATA_FRAME, curpath, "first dimension of \"%p\" is not consistent with \"%s.rows\"", Result::no_index, 0, sofar);
+            return nullptr;
         }
+    } else {
+        ctx.status.fail(ErrorCode::INVALID_TYPE, curpath, "unsupported type"); // this should really be handled by check_simple_object.
+        return nullptr;
     }
 
     return ptr;
 }
 
 template<class Provisioner, class Json, class Externals>
-inline std::shared_ptr<Base> terminal_validator(const Json& j, std::string sofar, Externals& others) {
+inline std::shared_ptr<Base> terminal_validator(const Json& j, const std::string& sofar, Externals& others, Context& ctx, uint64_t& hash, projection::Mode mode) {
     std::shared_ptr<Base> output;
+    auto fingerprints = ctx.options.fingerprints;
 
     auto tIt = j.find("type");
     if (tIt == j.end() || !tIt->is_string()) {
-        throw std::runtime_error("\"" + sofar + ".type\" should be a string field");
+        ctx.status.fail(ErrorCode::INVALID_TYPE, sofar, "\"%p.type\" should be a string field");
+        return nullptr;
     }
 
     std::string type = tIt->template get<std::string>();
     if (type == "other") {
         auto iIt = j.find("index");
         if (iIt == j.end() || !iIt->is_number()) {
-            throw std::runtime_error("\"" + sofar + ".index\" should be a number for type \"other\"");
+            ctx.status.fail(ErrorCode::INVALID_EXTERNAL, sofar + ".index", "\"%p\" should be a number for type \"other\"");
+            return nullptr;
         }
 
         double val = iIt->template get<double>();
         if (val < 0 || !is_integer(val)) {
-            throw std::runtime_error("\"" + sofar + ".index\" should be a non-negative integer for type \"other\"");
+            ctx.status.fail(ErrorCode::INVALID_EXTERNAL, sofar + ".index", "\"%p\" should be a non-negative integer for type \"other\"");
+            return nullptr;
+        }
+
+        if (!fits_size(val) || static_cast<size_t>(val) >= others.size()) {
+            ctx.status.fail(ErrorCode::INVALID_EXTERNAL, sofar + ".index", "\"%p\" for type \"other\" is out of range (%n objects available)", Result::no_index, others.size());
+            return nullptr;
+        }
+        void* ptr = others.get(static_cast<size_t>(val), sofar, ctx.status);
+        if (ctx.failed()) {
+            return nullptr;
+        }
+        if (!Externals::deferred) {
+            output.reset(Provisioner::new_Other(ptr));
         }
 
-        size_t idx = val;
-        if (idx >= others.size()) {
-            throw std::runtime_error("\"" + sofar + ".index\" for type \"other\" is out of range (" + std::to_string(others.size()) + " objects available)");
+        if (fingerprints) {
+            hash = hash_node(j);
         }
-        output.reset(Provisioner::new_Other(others(idx)));
 
     } else if (type == "data.frame") {
         auto rIt = j.find("rows");
         if (rIt == j.end() || !rIt->is_number() || !is_integer(rIt->template get<double>())) {
-            throw std::runtime_error("\"" + sofar + ".rows\" should be an integer for type \"data.frame\"");
+            ctx.status.fail(ErrorCode::INVALID_DATA_FRAME, sofar + ".rows", "\"%p\" should be an integer for type \"data.frame\"");
+            return nullptr;
+        }
+        if (!fits_size(rIt->template get<double>())) {
+            ctx.status.fail(ErrorCode::INVALID_DATA_FRAME, sofar + ".rows", "\"%p\" should be non-negative for type \"data.frame\"");
+            return nullptr;
         }
         size_t nr = rIt->template get<double>();
+        if (!ctx.check_node_elements(nr, sofar)) {
+            return nullptr;
+        }
 
         auto cIt = j.find("columns");
         if (cIt == j.end() || !cIt->is_object()) {
-            throw std::runtime_error("\"" + sofar + ".columns\" should be an object for type \"data.frame\"");
+            ctx.status.fail(ErrorCode::INVALID_DATA_FRAME, sofar + ".columns", "\"%p\" should be an object for type \"data.frame\"");
+            return nullptr;
         }
         size_t nc = cIt->size();
 
-        auto dptr = Provisioner::new_DataFrame(nr, nc);
+        // Only keeping the selected columns if we're on the way to a selected node.
+        const auto& proj = ctx.options.projection;
+        bool partial = (mode == projection::Mode::PARTIAL);
+        std::vector<unsigned char> keep;
+        size_t nkeep = nc;
+        // Reusing a single buffer for the column paths, to avoid copying 'sofar' for each column.
+        std::string curpath = sofar + ".columns.";
+        const size_t prefix_size = curpath.size();
+
+        if (partial) {
+            keep.reserve(nc);
+            nkeep = 0;
+            for (const auto& x : cIt->items()) {
+                curpath.resize(prefix_size);
+                curpath += x.key();
+                bool k = projection::classify(proj, curpath) != projection::Mode::NONE;
+                keep.push_back(k);
+                nkeep += k;
+            }
+        }
+
+        auto dptr = Provisioner::new_DataFrame(nr, nkeep);
         output.reset(dptr);
 
-        size_t i = 0;
-        for (const auto& x : cIt->items()) {
-            auto curpath = sofar + ".columns." + x.key();
-            const auto& curobj = x.value();
+        // Columns are hashed individually and combined in order, so each column is only traversed once.
+        uint64_t dfhash = fingerprint::combine(fingerprint::combine(fingerprint::DATA_FRAME_TAG, nr), nc);
 
-            auto tIt = curobj.find("type");
-            if (tIt == curobj.end() || !tIt->is_string()) {
-                throw std::runtime_error("\"" + curpath + ".type\" should be a string");
+        size_t i = 0, c = 0;
+        for (const auto& x : cIt->items()) {
+            bool materialize = !partial || keep[c];
+            ++c;
+            if (!materialize && proj.trust) {
+                continue;
             }
 
-            auto ptr = check_simple_object<Provisioner>(tIt->template get<std::string>(), curobj, curpath);
-            if (is_vector(ptr->type())) {
-                auto vptr = static_cast<Vector*>(ptr.get());
-                if (vptr->size() != nr) {
-                    throw std::runtime_error("size of \"" + curpath + "\" is not consistent with \"" + sofar + ".rows\"");
-                }
-            } else if (is_array(ptr->type())) {
-                auto aptr = static_cast<Array*>(ptr.get());
-                if (aptr->first_dim() != nr) {
-                    throw std::runtime_error("first dimension of \"" + curpath + "\" is not consistent with \"" + sofar + ".rows\"");
+            curpath.resize(prefix_size);
+            curpath += x.key();
+            const auto& curobj = x.value();
+            if (materialize) {
+                auto col = check_column<Provisioner>(curobj, curpath, nr, sofar, ctx);
+                if (ctx.failed()) {
+                    return nullptr;
                 }
+                dptr->set(i, x.key(), std::move(col));
+                ++i;
             } else {
-                throw std::runtime_error("unsupported type"); // this should really be handled by check_simple_object.
+                check_column<DummyProvisioner>(curobj, curpath, nr, sofar, ctx);
+                if (ctx.failed()) {
+                    return nullptr;
+                }
             }
 
-            dptr->set(i, x.key(), ptr);
-            ++i;
+            if (fingerprints) {
+                uint64_t colhash = hash_node(curobj);
+                fingerprints->nodes[curpath] = colhash;
+                dfhash = fingerprint::combine(fingerprint::combine(dfhash, fingerprint::string(x.key())), colhash);
+            }
+            release(curobj, ctx.consume);
         }
 
         auto namIt = j.find("names");
         if (namIt != j.end()) {
             dptr->use_names();
-            check_names(*namIt, nr, dptr, sofar + ".names");
+            if (!check_names(*namIt, nr, dptr, sofar, ctx)) {
+                return nullptr;
+            }
+            if (fingerprints) {
+                dfhash = fingerprint::combine(dfhash, hash_json(*namIt));
+            }
         }
 
+        hash = fingerprint::finish(dfhash);
+
     } else if (type == "nothing") {
         output.reset(Provisioner::new_Nothing());
+        if (fingerprints) {
+            hash = hash_node(j);
+        }
+
+    } else if (ctx.options.deduplicate) {
+        // The hash is computed for deduplication anyway, so it can be used as the fingerprint.
+        output = deduplicate<Provisioner>(j, sofar, ctx, hash, [&]() -> std::shared_ptr<Base> {
+            return check_simple_object<Provisioner>(type, j, sofar, ctx);
+        });
 
     } else {
-        output = check_simple_object<Provisioner>(type, j, sofar);
+        output = check_simple_object<Provisioner>(type, j, sofar, ctx);
+        if (fingerprints) {
+            hash = hash_node(j);
+        }
     }
 
     return output;
 }
 
-template<class Provisioner, class Json, class Externals>
-inline std::shared_ptr<Base> recursive_validator(const Json& j, std::string sofar, Externals& others) {
+/*
+ * Lists are traversed with an explicit stack rather than by recursion, so
+ * that arbitrarily nested documents can be parsed on small thread stacks.
+ * Each frame only holds an iterator into its JSON container and the length
+ * of its own path in the shared path buffer, which is truncated and
+ * extended as we move between siblings.
+ */
+template<class Json>
+struct ListFrame {
+    typename Json::const_iterator current, end;
     std::shared_ptr<Base> output;
+    List* list;
+    size_t index;
+    size_t path_size;
+    uint64_t hash;
+    bool named;
+    projection::Mode mode;
+};
+
+/*
+ * Wrapper for the external tracker in unselected subtrees, where we only
+ * need to record the indices for validation without retrieving anything.
+ */
+template<class Tracker>
+struct SkippedExternals {
+    SkippedExternals(Tracker& t) : tracker(t) {}
+
+    static constexpr bool deferred = false;
+
+    void* get(size_t i, const std::string& sofar, Result& status) {
+        tracker.record(i, sofar, status);
+        return nullptr;
+    }
+
+    size_t size() const {
+        return tracker.size();
+    }
 
-    if (j.is_array()) {
-        auto lptr = Provisioner::new_List(j.size());
-        output.reset(lptr);
-        for (size_t i = 0; i < j.size(); ++i) {
-            lptr->set(i, recursive_validator<Provisioner>(j[i], sofar + "[" + std::to_string(i) + "]", others));
+    Tracker& tracker;
+};
+
+template<class Json>
+struct Traversal {
+    std::vector<ListFrame<Json> > stack;
+    std::string path;
+};
+
+template<class Json>
+struct Workspace {
+    Scratch scratch;
+    Traversal<Json> traversal;
+};
+
+template<class Provisioner, class Json, class Externals>
+std::shared_ptr<Base> structural_validator(const Json& root, const std::string& prefix, Externals& others, Context& ctx, Traversal<Json>& work, uint64_t& hash) {
+    auto fingerprints = ctx.options.fingerprints;
+    const auto& proj = ctx.options.projection;
+    SkippedExternals<Externals> skipped(others);
+    auto& stack = work.stack;
+    auto& path = work.path;
+    stack.clear();
+    path = prefix;
+
+    // Holds the most recently completed node, its hash and whether it was materialized by the Provisioner.
+    std::shared_ptr<Base> finished;
+    uint64_t child = 0;
+    projection::Mode finished_mode = projection::Mode::FULL;
+
+    auto open_list = [&](const Json& j, bool named, projection::Mode mode) -> bool {
+        if (!ctx.enter_list(j.size(), path)) {
+            return false;
+        }
+        List* lptr;
+        if (mode == projection::Mode::NONE) {
+            lptr = DummyProvisioner::new_List(j.size());
+        } else {
+            lptr = Provisioner::new_List(j.size());
         }
-        
-    } else if (j.is_object()) {
-        auto tIt = j.find("type");
-        bool terminated = false;
 
+        stack.emplace_back();
+        auto& frame = stack.back();
+        frame.output.reset(lptr);
+        frame.list = lptr;
+        frame.current = j.begin();
+        frame.end = j.end();
+        frame.index = 0;
+        frame.path_size = path.size();
+        frame.named = named;
+        frame.mode = mode;
+        if (named) {
+            lptr->use_names();
+            frame.hash = fingerprint::combine(fingerprint::NAMED_LIST_TAG, j.size());
+        } else {
+            frame.hash = fingerprint::combine(fingerprint::UNNAMED_LIST_TAG, j.size());
+        }
+        return true;
+    };
+
+    // Either opens a new list frame, or validates a terminal node and stores it in 'finished'.
+    // Any failure is left in 'ctx.status' for the caller to check.
+    auto visit = [&](const Json& j, projection::Mode mode) -> bool {
+        if (j.is_array()) {
+            return open_list(j, false, mode);
+        } else if (!j.is_object()) {
+            ctx.status.fail(ErrorCode::INVALID_STRUCTURE, path, "structural elements should JSON arrays or objects");
+            return false;
+        }
+
+        auto tIt = j.find("type");
         if (tIt != j.end()) {
             if (tIt->is_string()) {
-                if (sofar == "") {
-                    throw std::runtime_error("top-level \".type\" should be an object or array");
+                if (stack.empty()) {
+                    ctx.status.fail(ErrorCode::INVALID_STRUCTURE, "", "top-level \".type\" should be an object or array");
+                    return false;
+                }
+                if (mode == projection::Mode::NONE) {
+                    finished = terminal_validator<DummyProvisioner>(j, path, skipped, ctx, child, mode);
+                } else {
+                    finished = terminal_validator<Provisioner>(j, path, others, ctx, child, mode);
                 }
-                terminated = true;
-                output = terminal_validator<Provisioner>(j, sofar, others);
+                finished_mode = mode;
+                if (fingerprints) {
+                    fingerprints->nodes[path] = child;
+                }
+                return false;
             } else if (!tIt->is_object() && !tIt->is_array()) {
-                throw std::runtime_error("\"" + sofar + ".type\" should be an object, array or string");
+                ctx.status.fail(ErrorCode::INVALID_STRUCTURE, path, "\"%p.type\" should be an object, array or string");
+                return false;
             }
         }
 
-        if (!terminated) {
-            auto lptr = Provisioner::new_List(j.size());
-            output.reset(lptr);
-            lptr->use_names();
+        return open_list(j, true, mode);
+    };
 
-            size_t i = 0;
-            for (const auto& x : j.items()) {
-                lptr->set(i, recursive_validator<Provisioner>(x.value(), sofar + "." + x.key(), others));
-                lptr->set_name(i, x.key());
-                ++i;
+    auto advance = [&](ListFrame<Json>& parent) -> void {
+        ++parent.index;
+        ++parent.current;
+    };
+
+    auto attach = [&](ListFrame<Json>& parent) -> void {
+        if (parent.mode == projection::Mode::NONE || finished_mode != projection::Mode::NONE) {
+            if (finished) {
+                parent.list->set(parent.index, std::move(finished));
+            } else {
+                others.place(parent.list, parent.index); // deferred "other" object, to be filled in later.
+            }
+        } // otherwise, unselected children are left unset in a materialized list.
+
+        if (parent.named) {
+            const auto& key = parent.current.key();
+            parent.list->set_name(parent.index, key);
+            if (fingerprints) {
+                parent.hash = fingerprint::combine(fingerprint::combine(parent.hash, fingerprint::string(key)), child);
             }
+        } else if (fingerprints) {
+            parent.hash = fingerprint::combine(parent.hash, child);
         }
-    } else {
-        throw std::runtime_error("structural elements should JSON arrays or objects");
+
+        // Releasing each subtree as soon as it is provisioned, to reduce peak memory usage.
+        release(*(parent.current), ctx.consume);
+        advance(parent);
+    };
+
+    // The root is always materialized, even if nothing is selected.
+    auto root_mode = projection::Mode::FULL;
+    if (!proj.paths.empty()) {
+        root_mode = projection::classify(proj, path);
+        if (root_mode == projection::Mode::NONE) {
+            root_mode = projection::Mode::PARTIAL;
+        }
+    }
+    visit(root, root_mode);
+
+    while (!stack.empty() && !ctx.failed()) {
+        auto& frame = stack.back();
+        path.resize(frame.path_size);
+
+        if (frame.current == frame.end) {
+            child = fingerprint::finish(frame.hash);
+            finished = std::move(frame.output);
+            finished_mode = frame.mode;
+            --ctx.depth;
+            if (fingerprints) {
+                fingerprints->nodes[path] = child;
+            }
+            stack.pop_back();
+            if (!stack.empty()) {
+                attach(stack.back());
+            }
+            continue;
+        }
+
+        if (frame.named) {
+            path += ".";
+            path += frame.current.key();
+        } else {
+            path += "[";
+            path += std::to_string(frame.index);
+            path += "]";
+        }
+
+        auto mode = frame.mode;
+        if (mode == projection::Mode::PARTIAL) {
+            mode = projection::classify(proj, path);
+        }
+        if (mode == projection::Mode::NONE && proj.trust) {
+            if (frame.named) {
+                frame.list->set_name(frame.index, frame.current.key());
+            }
+            advance(frame);
+            continue;
+        }
+
+        // 'frame' may be invalidated if a new list is opened.
+        if (!visit(*(frame.current), mode) && !ctx.failed()) {
+            attach(stack.back());
+        }
+    }
+
+    if (ctx.failed()) {
+        stack.clear();
+        return nullptr;
     }
+    hash = child;
+    return finished;
+}
 
+template<class Provisioner, class Json, class Externals>
+std::shared_ptr<Base> unpack(const Json& j, Externals& others, const Options& options, Workspace<Json>& work, Result& status, bool consume = false) {
+    uint64_t hash = 0;
+    Context ctx(options, work.scratch, status, consume);
+    auto output = structural_validator<Provisioner>(j, "", others, ctx, work.traversal, hash);
+    if (status.ok() && options.fingerprints) {
+        options.fingerprints->document = hash;
+    }
     return output;
 }
 
+/*
+ * Unpacking a subtree that was extracted from a larger document, where
+ * 'sofar' is the path to the subtree in the original document. Data frame
+ * columns need the path and number of rows of the parent data frame.
+ */
 template<class Provisioner, class Json, class Externals>
-std::shared_ptr<Base> unpack(const Json& j, Externals& others) {
-    return recursive_validator<Provisioner>(j, "", others);
+std::shared_ptr<Base> unpack_subtree(const Json& j, const std::string& sofar, const std::string* parent, size_t nrows, Externals& others, const Options& options, Workspace<Json>& work, Result& status) {
+    uint64_t hash = 0;
+    Context ctx(options, work.scratch, status);
+    auto fingerprints = options.fingerprints;
+
+    if (parent) {
+        auto output = check_column<Provisioner>(j, sofar, nrows, *parent, ctx);
+        if (status.ok() && fingerprints) {
+            fingerprints->nodes[sofar] = hash_node(j);
+        }
+        return output;
+    }
+
+    if (j.is_object()) {
+        auto tIt = j.find("type");
+        if (tIt != j.end() && tIt->is_string()) {
+            auto mode = projection::Mode::FULL;
+            if (!options.projection.paths.empty()) {
+                mode = projection::classify(options.projection, sofar);
+                if (mode == projection::Mode::NONE) {
+                    mode = projection::Mode::PARTIAL;
+                }
+            }
+            auto output = terminal_validator<Provisioner>(j, sofar, others, ctx, hash, mode);
+            if (status.ok() && fingerprints) {
+                fingerprints->nodes[sofar] = hash;
+            }
+            return output;
+        }
+    }
+
+    return structural_validator<Provisioner>(j, sofar, others, ctx, work.traversal, hash);
 }
 
 }
@@ -4,10 +4,10 @@
 #include "unpack.hpp"
 #include "Dummy.hpp"
 #include "parse.hpp"
+#include "error.hpp"
 
 #include <vector>
 #include <algorithm>
-#include <stdexcept>
 
 /**
  * @file validate.hpp
@@ -17,6 +17,49 @@
 
 namespace uzuki {
 
+/**
+ * @cond
+ */
+template<class Json>
+size_t validate(const Json& contents, const Options& options, Workspace<Json>& work, Result& status) {
+    ExternalTracker<DummyExternals> etrack(DummyExternals(-1), work.scratch.externals, work.scratch.sites);
+    unpack<DummyProvisioner>(contents, etrack, options, work, status);
+    if (status.ok() && (options.projection.paths.empty() || !options.projection.trust)) {
+        etrack.indices.finish(status);
+    }
+    return etrack.indices.count;
+}
+
+template<class Json>
+size_t validate(const Json& contents, const Options& options, Workspace<Json>& work) {
+    Result status;
+    size_t n = validate(contents, options, work, status);
+    if (!status.ok()) {
+        throw_error(status);
+    }
+    return n;
+}
+/**
+ * @endcond
+ */
+
+/**
+ * Validate JSON file contents against the **uzuki** specification with additional options.
+ * Any invalid representations will cause an error to be thrown.
+ *
+ * @tparam Json A [`nlohmann::json`](https://github.com/nlohmann/json)-compatible representation of JSON data.
+ *
+ * @param contents Parsed contents of the JSON file.
+ * @param num_external Expected number of external references to "other" objects.
+ * @param options Further options for validation.
+ */
+template<class Json>
+void validate(const Json& contents, size_t num_external, const Options& options) {
+    DummyExternals others(num_external);
+    parse<DummyProvisioner>(contents, std::move(others), options);
+    return;
+}
+
 /**
  * Validate JSON file contents against the **uzuki** specification.
  * Any invalid representations will cause an error to be thrown.
@@ -28,11 +71,27 @@ namespace uzuki {
  */
 template<class Json>
 void validate(const Json& contents, size_t num_external) {
-    DummyExternals others(num_external);
-    parse<DummyProvisioner>(contents, std::move(others));
+    validate(contents, num_external, Options());
     return;
 }
 
+/**
+ * Validate JSON file contents against the **uzuki** specification with an unknown number of external references and additional options.
+ * Any invalid representations will cause an error to be thrown.
+ *
+ * @tparam Json A [`nlohmann::json`](https://github.com/nlohmann/json)-compatible representation of JSON data.
+ *
+ * @param contents Parsed contents of the JSON file.
+ * @param options Further options for validation.
+ *
+ * @return Number of external references.
+ */
+template<class Json>
+size_t validate(const Json& contents, const Options& options) {
+    Workspace<Json> work;
+    return validate(contents, options, work);
+}
+
 /**
  * Validate JSON file contents against the **uzuki** specification with an unknown number of external references.
  * Any invalid representations will cause an error to be thrown.
@@ -43,11 +102,58 @@ void validate(const Json& contents, size_t num_external) {
  */
 template<class Json>
 size_t validate(const Json& contents) {
-    DummyExternals others(-1);
-    ExternalTracker etrack(std::move(others));
-    unpack<DummyProvisioner>(contents, etrack);
-    check_external_indices(etrack.indices);
-    return etrack.indices.size();
+    return validate(contents, Options());
+}
+
+/**
+ * Validate JSON file contents against the **uzuki** specification without throwing.
+ * This is intended for workloads where invalid documents are common, e.g., fuzzing or triage.
+ * Failures are reported as an `ErrorCode` and location in the returned `Result` without unwinding,
+ * and the human-readable message is only rendered if `Result::message()` is called.
+ * This function can also be used when compiling without exception support.
+ *
+ * @tparam Json A [`nlohmann::json`](https://github.com/nlohmann/json)-compatible representation of JSON data.
+ *
+ * @param contents Parsed contents of the JSON file.
+ * @param num_external Expected number of external references to "other" objects.
+ * @param options Further options for validation.
+ *
+ * @return Result of the validation.
+ */
+template<class Json>
+Result validate_nothrow(const Json& contents, size_t num_external, const Options& options = Options()) noexcept {
+    Result output;
+    guard(output, [&]() -> void {
+        Workspace<Json> work;
+        parse<DummyProvisioner>(contents, DummyExternals(num_external), options, work, output);
+    });
+    return output;
+}
+
+/**
+ * Validate JSON file contents against the **uzuki** specification with an unknown number of external references, without throwing.
+ * See the other `validate_nothrow()` overload for details.
+ *
+ * @tparam Json A [`nlohmann::json`](https://github.com/nlohmann/json)-compatible representation of JSON data.
+ *
+ * @param contents Parsed contents of the JSON file.
+ * @param options Further options for validation.
+ * @param[out] num_external Number of external references to "other" objects.
+ * This is only set if validation was successful.
+ *
+ * @return Result of the validation.
+ */
+template<class Json>
+Result validate_nothrow(const Json& contents, const Options& options, size_t& num_external) noexcept {
+    Result output;
+    guard(output, [&]() -> void {
+        Workspace<Json> work;
+        size_t n = validate(contents, options, work, output);
+        if (output.ok()) {
+            num_external = n;
+        }
+    });
+    return output;
 }
 
 }
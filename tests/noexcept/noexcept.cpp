@@ -0,0 +1,28 @@
+#include "uzuki/validate.hpp"
+#include "nlohmann/json.hpp"
+
+#include <iostream>
+
+/*
+ * Checks that validate_nothrow() is usable when compiling without exceptions,
+ * which requires that nothing in its include graph throws or catches.
+ */
+
+int main() {
+    auto contents = nlohmann::json::parse("[ { \"type\": \"integer\", \"values\": [ 1, 2 ] }, { \"type\": \"other\", \"index\": 0 } ]", nullptr, false);
+    size_t num_external = 0;
+    auto res = uzuki::validate_nothrow(contents, uzuki::Options(), num_external);
+    if (!res.ok() || num_external != 1) {
+        std::cerr << "failed to validate a valid document: " << res.message() << std::endl;
+        return 1;
+    }
+
+    contents = nlohmann::json::parse("[ { \"type\": \"integer\", \"values\": [ 1, \"foo\" ] } ]", nullptr, false);
+    res = uzuki::validate_nothrow(contents, 0);
+    if (res.code != uzuki::ErrorCode::INVALID_VALUE || res.path != "[0].values" || res.index != 1) {
+        std::cerr << "unexpected result for an invalid document: " << res.message() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,453 @@
+#include "uzuki/validate.hpp"
+#include "uzuki/parse.hpp"
+#include "nlohmann/json.hpp"
+
+#include "test_subclass.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <new>
+#include <string>
+#include <vector>
+
+/**
+ * Performance regression tests for validate() and parse().
+ *
+ * Each workload is a deterministic synthetic document. For each pass over
+ * the document, we record the number and total size of allocations, the
+ * peak number of live heap bytes and the time relative to nlohmann::json's
+ * own parsing of the same document. The latter normalizes for the speed of
+ * the machine and is compared against the baseline with a generous
+ * tolerance, whereas the allocation counts are deterministic and make for
+ * much tighter gates. We don't check the resident set size as it depends on
+ * everything else that the process has done, e.g., earlier workloads.
+ *
+ * Allocation counts depend on the compiler and standard library, so the
+ * baseline holds separate entries for each toolchain. If there is no entry
+ * for the current toolchain, the checks are skipped with exit code 77.
+ *
+ * Usage: perftest BASELINE [--update] [WORKLOAD...]
+ *
+ * If no workloads are named, all of them are run. With --update, the
+ * current measurements are written to BASELINE instead of being checked.
+ */
+
+/*
+ * Counting allocations by replacing the global operator new. The size of
+ * each allocation is stored in a header so that we can also track the
+ * peak number of live bytes.
+ */
+namespace {
+
+std::atomic<size_t> allocation_count(0);
+std::atomic<size_t> allocation_bytes(0);
+std::atomic<size_t> live_bytes(0);
+std::atomic<size_t> peak_live_bytes(0);
+
+constexpr size_t header_size = alignof(std::max_align_t);
+
+void* counted_allocate(size_t n) {
+    auto base = static_cast<unsigned char*>(std::malloc(n + header_size));
+    if (!base) {
+        throw std::bad_alloc();
+    }
+    std::memcpy(base, &n, sizeof(size_t));
+
+    allocation_count.fetch_add(1, std::memory_order_relaxed);
+    allocation_bytes.fetch_add(n, std::memory_order_relaxed);
+    size_t current = live_bytes.fetch_add(n, std::memory_order_relaxed) + n;
+    if (current > peak_live_bytes.load(std::memory_order_relaxed)) {
+        peak_live_bytes.store(current, std::memory_order_relaxed);
+    }
+    return base + header_size;
+}
+
+void counted_free(void* ptr) {
+    if (!ptr) {
+        return;
+    }
+    auto base = static_cast<unsigned char*>(ptr) - header_size;
+    size_t n;
+    std::memcpy(&n, base, sizeof(size_t));
+    live_bytes.fetch_sub(n, std::memory_order_relaxed);
+    std::free(base);
+}
+
+}
+
+void* operator new(size_t n) {
+    return counted_allocate(n);
+}
+
+void* operator new[](size_t n) {
+    return counted_allocate(n);
+}
+
+void operator delete(void* ptr) noexcept {
+    counted_free(ptr);
+}
+
+void operator delete[](void* ptr) noexcept {
+    counted_free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept {
+    counted_free(ptr);
+}
+
+void operator delete[](void* ptr, size_t) noexcept {
+    counted_free(ptr);
+}
+
+namespace {
+
+/*
+ * Tolerances for each metric, as the maximum allowed ratio to the baseline.
+ * Allocation counts and sizes only change with the code, while the relative
+ * time is noisy even when taking the fastest of many runs.
+ */
+constexpr double count_tolerance = 1.05;
+constexpr double bytes_tolerance = 1.1;
+constexpr double time_tolerance = 1.5;
+
+/*
+ * Runs are repeated until both the minimum number of repetitions and the
+ * time budget are reached, so that fast workloads get more chances to
+ * record an undisturbed run.
+ */
+constexpr int min_repetitions = 10;
+constexpr int max_repetitions = 1000;
+constexpr double time_budget = 1; // in seconds.
+
+constexpr int skip_code = 77;
+
+std::string toolchain() {
+    std::string output;
+#if defined(__clang__)
+    output = "clang-" + std::to_string(__clang_major__) + "." + std::to_string(__clang_minor__) + "." + std::to_string(__clang_patchlevel__);
+#elif defined(__GNUC__)
+    output = "gcc-" + std::to_string(__GNUC__) + "." + std::to_string(__GNUC_MINOR__) + "." + std::to_string(__GNUC_PATCHLEVEL__);
+#elif defined(_MSC_VER)
+    output = "msvc-" + std::to_string(_MSC_FULL_VER);
+#else
+    output = "unknown";
+#endif
+
+#if defined(_LIBCPP_VERSION)
+    output += "/libc++-" + std::to_string(_LIBCPP_VERSION);
+#elif defined(__GLIBCXX__)
+    output += "/libstdc++-" + std::to_string(__GLIBCXX__);
+#endif
+    return output;
+}
+
+struct Measurement {
+    size_t allocations = 0;
+    size_t bytes = 0;
+    size_t peak_heap_bytes = 0;
+    double seconds = 0;
+    double relative_time = 0;
+};
+
+double elapsed(const std::function<void()>& fun) {
+    auto start = std::chrono::steady_clock::now();
+    fun();
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+/*
+ * Each timed run of 'fun' is interleaved with a run of 'reference', so that
+ * both are timed under the same conditions. The fastest run of each is used
+ * for the ratio, as interference from the rest of the machine only ever
+ * makes a run slower.
+ */
+Measurement measure(const std::function<void()>& fun, const std::function<void()>& reference) {
+    Measurement output;
+
+    // First run to collect allocations.
+    size_t start_count = allocation_count.load(std::memory_order_relaxed);
+    size_t start_bytes = allocation_bytes.load(std::memory_order_relaxed);
+    size_t start_live = live_bytes.load(std::memory_order_relaxed);
+    peak_live_bytes.store(start_live, std::memory_order_relaxed);
+    fun();
+    output.allocations = allocation_count.load(std::memory_order_relaxed) - start_count;
+    output.bytes = allocation_bytes.load(std::memory_order_relaxed) - start_bytes;
+    output.peak_heap_bytes = peak_live_bytes.load(std::memory_order_relaxed) - start_live;
+
+    output.seconds = std::numeric_limits<double>::infinity();
+    double best_ref = std::numeric_limits<double>::infinity();
+    double total = 0;
+    for (int r = 0; r < max_repetitions && (r < min_repetitions || total < time_budget); ++r) {
+        double ref = elapsed(reference);
+        double cur = elapsed(fun);
+        best_ref = std::min(best_ref, ref);
+        output.seconds = std::min(output.seconds, cur);
+        total += ref + cur;
+    }
+    output.relative_time = output.seconds / best_ref;
+
+    return output;
+}
+
+/** Workloads. **/
+
+nlohmann::json wide_list() {
+    nlohmann::json output = nlohmann::json::object();
+    for (int i = 0; i < 50000; ++i) {
+        output["x" + std::to_string(i)] = {{ "type", "integer" }, { "values", { i, i + 1 } }};
+    }
+    return output;
+}
+
+nlohmann::json deep_list() {
+    nlohmann::json output = nlohmann::json::array();
+    for (int i = 0; i < 2000; ++i) {
+        nlohmann::json values = nlohmann::json::array();
+        for (int j = 0; j < 20; ++j) {
+            values.push_back(i * 0.5 + j);
+        }
+        nlohmann::json level = nlohmann::json::array();
+        level.push_back({{ "type", "number" }, { "values", std::move(values) }});
+        level.push_back(std::move(output));
+        output = std::move(level);
+    }
+    return output;
+}
+
+nlohmann::json large_matrix() {
+    nlohmann::json values = nlohmann::json::array();
+    for (int i = 0; i < 500 * 400; ++i) {
+        if (i % 97 == 0) {
+            values.push_back(nullptr);
+        } else {
+            values.push_back(static_cast<double>(i % 1000) / 7);
+        }
+    }
+
+    nlohmann::json rownames = nlohmann::json::array();
+    for (int i = 0; i < 500; ++i) {
+        rownames.push_back("gene" + std::to_string(i));
+    }
+
+    return {{ "matrix", {
+        { "type", "number" },
+        { "values", std::move(values) },
+        { "dimensions", { 500, 400 } },
+        { "names", { std::move(rownames), nullptr } }
+    }}};
+}
+
+nlohmann::json string_data_frame() {
+    constexpr int nrows = 20000;
+    nlohmann::json columns = nlohmann::json::object();
+    for (int c = 0; c < 5; ++c) {
+        nlohmann::json values = nlohmann::json::array();
+        for (int r = 0; r < nrows; ++r) {
+            if ((r + c) % 50 == 0) {
+                values.push_back(nullptr);
+            } else {
+                values.push_back("column" + std::to_string(c) + "_value_" + std::to_string(r));
+            }
+        }
+        columns["col" + std::to_string(c)] = {{ "type", "string" }, { "values", std::move(values) }};
+    }
+
+    nlohmann::json rownames = nlohmann::json::array();
+    for (int r = 0; r < nrows; ++r) {
+        rownames.push_back("row" + std::to_string(r));
+    }
+
+    return {{ "df", {
+        { "type", "data.frame" },
+        { "rows", nrows },
+        { "columns", std::move(columns) },
+        { "names", std::move(rownames) }
+    }}};
+}
+
+nlohmann::json factor_heavy() {
+    nlohmann::json levels = nlohmann::json::array();
+    for (int l = 0; l < 50; ++l) {
+        levels.push_back("level_" + std::to_string(l));
+    }
+
+    nlohmann::json output = nlohmann::json::array();
+    for (int f = 0; f < 200; ++f) {
+        nlohmann::json values = nlohmann::json::array();
+        for (int i = 0; i < 1000; ++i) {
+            if ((i + f) % 31 == 0) {
+                values.push_back(nullptr);
+            } else {
+                values.push_back(levels[(i * 7 + f) % 50]);
+            }
+        }
+        output.push_back({{ "type", (f % 2 ? "factor" : "ordered") }, { "values", std::move(values) }, { "levels", levels }});
+    }
+    return output;
+}
+
+struct Workload {
+    const char* name;
+    nlohmann::json (*generate)();
+};
+
+const std::vector<Workload> workloads {
+    { "wide_list", wide_list },
+    { "deep_list", deep_list },
+    { "large_matrix", large_matrix },
+    { "string_data_frame", string_data_frame },
+    { "factor_heavy", factor_heavy }
+};
+
+/** Comparison to the baseline. **/
+
+nlohmann::json to_json(const Measurement& m) {
+    return {
+        { "allocations", m.allocations },
+        { "bytes", m.bytes },
+        { "peak_heap_bytes", m.peak_heap_bytes },
+        { "relative_time", m.relative_time }
+    };
+}
+
+bool compare(const std::string& id, const nlohmann::json& observed, const nlohmann::json& expected) {
+    bool okay = true;
+    auto check = [&](const char* metric, double tolerance) -> void {
+        double obs = observed[metric].get<double>();
+        double exp = expected.at(metric).get<double>();
+        double limit = exp * tolerance;
+        if (obs > limit) {
+            std::cout << "REGRESSION " << id << " " << metric << ": " << obs << " (baseline " << exp << ", limit " << limit << ")" << std::endl;
+            okay = false;
+        } else if (obs * tolerance < exp) {
+            std::cout << "improved   " << id << " " << metric << ": " << obs << " (baseline " << exp << "), consider updating the baseline" << std::endl;
+        }
+    };
+
+    check("allocations", count_tolerance);
+    check("bytes", bytes_tolerance);
+    check("peak_heap_bytes", bytes_tolerance);
+    check("relative_time", time_tolerance);
+
+    return okay;
+}
+
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        std::cerr << "Usage: " << argv[0] << " BASELINE [--update] [WORKLOAD...]" << std::endl;
+        return 2;
+    }
+    std::string baseline_path = argv[1];
+
+    bool update = false;
+    std::vector<const Workload*> selected;
+    for (int a = 2; a < argc; ++a) {
+        if (std::strcmp(argv[a], "--update") == 0) {
+            update = true;
+            continue;
+        }
+        auto wIt = std::find_if(workloads.begin(), workloads.end(), [&](const Workload& w) -> bool { return w.name == std::string(argv[a]); });
+        if (wIt == workloads.end()) {
+            std::cerr << "unknown workload '" << argv[a] << "'" << std::endl;
+            return 2;
+        }
+        selected.push_back(&(*wIt));
+    }
+    if (selected.empty()) {
+        for (const auto& w : workloads) {
+            selected.push_back(&w);
+        }
+    }
+
+    // When updating, entries for other toolchains and for workloads that weren't run are retained.
+    nlohmann::json everything = nlohmann::json::object();
+    {
+        std::ifstream handle(baseline_path);
+        if (handle) {
+            everything = nlohmann::json::parse(handle);
+        } else if (!update) {
+            std::cerr << "failed to open the baseline at '" << baseline_path << "'" << std::endl;
+            return 1;
+        }
+    }
+
+    auto tool = toolchain();
+    auto tIt = everything.find(tool);
+    if (tIt == everything.end() && !update) {
+        std::cout << "no baseline for '" << tool << "' in '" << baseline_path << "', run with --update to record it" << std::endl;
+        return skip_code;
+    }
+    nlohmann::json baseline = (tIt == everything.end() ? nlohmann::json::object() : *tIt);
+    nlohmann::json results = baseline;
+    bool okay = true;
+
+    for (auto wptr : selected) {
+        const auto& w = *wptr;
+        auto contents = w.generate();
+        auto serialized = contents.dump();
+
+        // Timing the JSON parser on the same document, to normalize for the speed of the machine.
+        auto reference = [&]() -> void {
+            auto parsed = nlohmann::json::parse(serialized);
+        };
+
+        size_t num_external = 0;
+        auto validated = measure([&]() -> void {
+            num_external = uzuki::validate(contents);
+        }, reference);
+
+        auto parsed = measure([&]() -> void {
+            uzuki::parse<DefaultProvisioner>(contents, DefaultExternals(num_external));
+        }, reference);
+
+        auto& current = results[w.name];
+        current = nlohmann::json::object();
+        current["validate"] = to_json(validated);
+        current["parse"] = to_json(parsed);
+
+        std::cout << std::left << std::setw(20) << w.name << " " << serialized.size() << " bytes" << std::endl;
+        for (const char* pass : { "validate", "parse" }) {
+            const auto& m = (std::strcmp(pass, "validate") == 0 ? validated : parsed);
+            std::cout << "  " << std::setw(10) << pass
+                << m.seconds * 1000 << " ms (" << m.relative_time << "x JSON parsing), "
+                << m.allocations << " allocations, "
+                << m.bytes << " bytes, "
+                << m.peak_heap_bytes << " peak heap bytes" << std::endl;
+
+            if (!update) {
+                std::string id = std::string(w.name) + "/" + pass;
+                auto wIt = baseline.find(w.name);
+                if (wIt == baseline.end() || wIt->find(pass) == wIt->end()) {
+                    std::cout << "MISSING    " << id << " in the baseline, run with --update to record it" << std::endl;
+                    okay = false;
+                } else if (!compare(id, current[pass], (*wIt)[pass])) {
+                    okay = false;
+                }
+            }
+        }
+    }
+
+    if (update) {
+        everything[tool] = std::move(results);
+        std::ofstream handle(baseline_path);
+        handle << std::setw(4) << everything << std::endl;
+        if (!handle) {
+            std::cerr << "failed to write the baseline to '" << baseline_path << "'" << std::endl;
+            return 1;
+        }
+        std::cout << "baseline for '" << tool << "' written to '" << baseline_path << "'" << std::endl;
+    }
+
+    return (okay ? 0 : 1);
+}
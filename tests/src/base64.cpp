@@ -0,0 +1,57 @@
+#include <gtest/gtest.h>
+
+#include "uzuki/base64.hpp"
+
+#include <string>
+#include <vector>
+
+static std::string as_string(const std::vector<unsigned char>& x) {
+    return std::string(x.begin(), x.end());
+}
+
+TEST(Base64Test, Decoding) {
+    std::vector<unsigned char> out;
+    EXPECT_TRUE(uzuki::base64_decode("", out));
+    EXPECT_TRUE(out.empty());
+
+    EXPECT_TRUE(uzuki::base64_decode("TWFu", out));
+    EXPECT_EQ(as_string(out), "Man");
+    EXPECT_TRUE(uzuki::base64_decode("TWE=", out));
+    EXPECT_EQ(as_string(out), "Ma");
+    EXPECT_TRUE(uzuki::base64_decode("TQ==", out));
+    EXPECT_EQ(as_string(out), "M");
+    EXPECT_TRUE(uzuki::base64_decode("aGVsbG8gd29ybGQ=", out));
+    EXPECT_EQ(as_string(out), "hello world");
+
+    EXPECT_FALSE(uzuki::base64_decode("TWF", out));
+    EXPECT_FALSE(uzuki::base64_decode("TW=u", out));
+    EXPECT_FALSE(uzuki::base64_decode("====", out));
+    EXPECT_FALSE(uzuki::base64_decode("TW u", out));
+}
+
+TEST(Base64Test, RoundTrip) {
+    std::vector<unsigned char> bytes;
+    for (size_t n = 0; n < 20; ++n) {
+        std::vector<unsigned char> out;
+        EXPECT_TRUE(uzuki::base64_decode(uzuki::base64_encode(bytes.data(), bytes.size()), out));
+        EXPECT_EQ(out, bytes);
+        bytes.push_back(n * 37 + 200);
+    }
+
+    std::vector<double> values { 1.5, -2.25, 1e300, 0 };
+    auto encoded = uzuki::base64_encode_values(values.data(), values.size());
+    std::vector<unsigned char> out;
+    EXPECT_TRUE(uzuki::base64_decode(encoded, out));
+    EXPECT_EQ(out.size(), 32);
+    EXPECT_EQ(uzuki::read_little_endian<double>(out.data() + 8), -2.25);
+    EXPECT_EQ(out[8 + 7], 0xC0); // sign and exponent live in the last byte.
+}
+
+TEST(Base64Test, Validity) {
+    std::vector<unsigned char> present { 1, 0, 1, 1, 0, 0, 0, 0, 1 };
+    std::vector<unsigned char> out;
+    EXPECT_TRUE(uzuki::base64_decode(uzuki::base64_encode_validity(present.data(), present.size()), out));
+    EXPECT_EQ(out.size(), 2);
+    EXPECT_EQ(out[0], 0x0D);
+    EXPECT_EQ(out[1], 0x01);
+}
@@ -0,0 +1,163 @@
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+#include "uzuki/binary.hpp"
+#include "nlohmann/json.hpp"
+
+#include "test_subclass.h"
+
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <limits>
+#include <functional>
+
+class BinaryTest : public ::testing::TestWithParam<std::string> {
+protected:
+    static std::vector<std::vector<uint8_t> > encode(const nlohmann::json& contents) {
+        return std::vector<std::vector<uint8_t> > {
+            nlohmann::json::to_cbor(contents),
+            nlohmann::json::to_msgpack(contents),
+            nlohmann::json::to_bjdata(contents, true, true)
+        };
+    }
+
+    static std::string outcome(std::function<void()> fun) {
+        try {
+            fun();
+        } catch (std::exception& e) {
+            return e.what();
+        }
+        return "";
+    }
+};
+
+TEST_P(BinaryTest, SameAsText) {
+    auto contents = nlohmann::json::parse(GetParam());
+    auto expected = outcome([&]() -> void { uzuki::validate(contents, 1); });
+    auto encoded = encode(contents);
+
+    EXPECT_EQ(outcome([&]() -> void { uzuki::validate_cbor(encoded[0], 1); }), expected);
+    EXPECT_EQ(outcome([&]() -> void { uzuki::validate_msgpack(encoded[1], 1); }), expected);
+    EXPECT_EQ(outcome([&]() -> void { uzuki::validate_bjdata(encoded[2], 1); }), expected);
+
+    if (expected == "") {
+        EXPECT_EQ(uzuki::validate_cbor(encoded[0]), 1);
+        EXPECT_EQ(uzuki::validate_msgpack(encoded[1]), 1);
+        EXPECT_EQ(uzuki::validate_bjdata(encoded[2]), 1);
+    }
+}
+
+INSTANTIATE_TEST_SUITE_P(
+    BinaryTest,
+    BinaryTest,
+    ::testing::Values(
+        "[ { \"type\": \"other\", \"index\": 0 }, { \"type\": \"number\", \"values\": [ 1.5, null, 3 ] } ]",
+        "{ \"a\": { \"type\": \"other\", \"index\": 0 }, \"b\": { \"type\": \"integer\", \"values\": [ 1, 2, 3, 4, 5, 6 ], \"dimensions\": [ 3, 2 ] } }",
+        "[ { \"type\": \"other\", \"index\": 0 }, { \"type\": \"factor\", \"values\": [ \"a\", \"b\" ], \"levels\": [ \"a\", \"b\" ] } ]",
+        "[ { \"type\": \"other\", \"index\": 0 }, { \"type\": \"integer\", \"values\": [ 1.5 ] } ]",
+        "[ { \"type\": \"other\", \"index\": 0 }, { \"type\": \"boolean\", \"values\": [ 1 ] } ]",
+        "[ { \"type\": \"other\", \"index\": 1 } ]"
+    )
+);
+
+TEST(BinaryTypedArrayTest, Parsing) {
+    nlohmann::json contents = nlohmann::json::array({
+        nlohmann::json::object({
+            { "type", "number" },
+            { "values", nlohmann::json::object({
+                { "_ArrayType_", "double" },
+                { "_ArraySize_", nlohmann::json::array({ 3, 2 }) },
+                { "_ArrayData_", nlohmann::json::array({ 1.5, 2.5, 3.5, 4.5, 5.5, 6.5 }) }
+            }) },
+            { "dimensions", nlohmann::json::array({ 3, 2 }) }
+        }),
+        nlohmann::json::object({
+            { "type", "integer" },
+            { "values", nlohmann::json::object({
+                { "_ArrayType_", "int16" },
+                { "_ArraySize_", nlohmann::json::array({ 4 }) },
+                { "_ArrayData_", nlohmann::json::array({ 1, -2, 3, -4 }) }
+            }) }
+        })
+    });
+
+    auto encoded = nlohmann::json::to_bjdata(contents, true, true);
+    DefaultExternals ext(0);
+    auto out = uzuki::parse_bjdata<DefaultProvisioner>(encoded, ext);
+
+    auto lptr = static_cast<const DefaultList*>(out.get());
+    EXPECT_EQ(lptr->values[0]->type(), uzuki::NUMBER_ARRAY);
+    auto dptr = static_cast<const DefaultNumberArray*>(lptr->values[0].get());
+    EXPECT_EQ(dptr->base.values, std::vector<double>({ 1.5, 3.5, 5.5, 2.5, 4.5, 6.5 })); // converted from row-major order.
+
+    EXPECT_EQ(lptr->values[1]->type(), uzuki::INTEGER);
+    auto iptr = static_cast<const DefaultIntegerVector*>(lptr->values[1].get());
+    EXPECT_EQ(iptr->base.values, std::vector<int32_t>({ 1, -2, 3, -4 }));
+
+    // Same results from CBOR and MessagePack, where the annotations are preserved as plain objects.
+    auto out2 = uzuki::parse_cbor<DefaultProvisioner>(nlohmann::json::to_cbor(contents), ext);
+    auto dptr2 = static_cast<const DefaultNumberArray*>(static_cast<const DefaultList*>(out2.get())->values[0].get());
+    EXPECT_EQ(dptr2->base.values, dptr->base.values);
+}
+
+TEST(BinaryTypedArrayTest, Errors) {
+    auto check = [](nlohmann::json values, std::string msg) -> void {
+        nlohmann::json contents = nlohmann::json::array({ nlohmann::json::object({ { "type", "integer" }, { "values", values } }) });
+        EXPECT_ANY_THROW({
+            try {
+                uzuki::validate_msgpack(nlohmann::json::to_msgpack(contents), 0);
+            } catch (std::exception& e) {
+                EXPECT_THAT(e.what(), ::testing::HasSubstr(msg));
+                throw;
+            }
+        });
+    };
+
+    check(nlohmann::json::object({ { "_ArrayType_", "int16" } }), "should be an array");
+    check(nlohmann::json::object({ { "_ArrayType_", "int16" }, { "_ArraySize_", { 3 } }, { "_ArrayData_", { 1, 2 } } }), "product");
+    check(nlohmann::json::object({ { "_ArrayType_", "int16" }, { "_ArraySize_", { -1 } }, { "_ArrayData_", { 1, 2 } } }), "non-negative");
+    check(nlohmann::json::object({ { "_ArrayType_", "double" }, { "_ArraySize_", { 2 } }, { "_ArrayData_", { 1, 2.5 } } }), "should be an integer");
+    check(nlohmann::json::object({ { "_ArrayType_", "int16" }, { "_ArraySize_", { 2, 1 } }, { "_ArrayData_", { 1, 2 } } }), "should have length 1");
+    check(nlohmann::json::object({ { "_ArrayType_", "int16" }, { "_ArraySize_", { 4294967296ull, 4294967296ull } }, { "_ArrayData_", nlohmann::json::array() } }), "overflows");
+
+    // The declared type is not trusted.
+    check(nlohmann::json::object({ { "_ArrayType_", "int32" }, { "_ArraySize_", { 2 } }, { "_ArrayData_", { 1.5, 3e20 } } }), "should be an integer");
+    check(nlohmann::json::object({ { "_ArrayType_", "int32" }, { "_ArraySize_", { 2 } }, { "_ArrayData_", { 1, 3e20 } } }), "out of 32-bit integer range");
+    check(nlohmann::json::object({ { "_ArrayType_", "int32" }, { "_ArraySize_", { 2 } }, { "_ArrayData_", { 1, "a" } } }), "should be an integer");
+    check(nlohmann::json::object({ { "_ArrayType_", "uint32" }, { "_ArraySize_", { 1 } }, { "_ArrayData_", { 4294967295u } } }), "out of 32-bit integer range");
+}
+
+TEST(BinaryTypedArrayTest, Dimensions) {
+    auto make = [](nlohmann::json sizes, nlohmann::json data, nlohmann::json dims) -> nlohmann::json {
+        return nlohmann::json::array({ nlohmann::json::object({ 
+            { "type", "integer" },
+            { "values", nlohmann::json::object({ { "_ArrayType_", "int32" }, { "_ArraySize_", sizes }, { "_ArrayData_", data } }) },
+            { "dimensions", dims }
+        }) });
+    };
+
+    auto contents = make({ 2, 3 }, { 1, 2, 3, 4, 5, 6 }, { 2, 3 });
+    DefaultExternals ext(0);
+    auto out = uzuki::parse_bjdata<DefaultProvisioner>(nlohmann::json::to_bjdata(contents, true, true), ext);
+    auto aptr = static_cast<const DefaultIntegerArray*>(static_cast<const DefaultList*>(out.get())->values[0].get());
+    EXPECT_EQ(aptr->base.values, std::vector<int32_t>({ 1, 4, 2, 5, 3, 6 }));
+
+    // Missing values are preserved by the reordering.
+    auto out2 = uzuki::parse<DefaultProvisioner>(make({ 2, 2 }, { 1, nullptr, 3, 4 }, { 2, 2 }), ext);
+    auto aptr2 = static_cast<const DefaultIntegerArray*>(static_cast<const DefaultList*>(out2.get())->values[0].get());
+    EXPECT_EQ(aptr2->base.values[0], 1);
+    EXPECT_EQ(aptr2->base.values[1], 3);
+    EXPECT_EQ(aptr2->base.values[2], std::numeric_limits<int32_t>::min());
+    EXPECT_EQ(aptr2->base.values[3], 4);
+
+    EXPECT_ANY_THROW({
+        try {
+            uzuki::validate(make({ 3, 2 }, { 1, 2, 3, 4, 5, 6 }, { 2, 3 }), 0);
+        } catch (std::exception& e) {
+            EXPECT_THAT(e.what(), ::testing::HasSubstr("should be equal to"));
+            throw;
+        }
+    });
+    EXPECT_ANY_THROW(uzuki::validate(make({ 6 }, { 1, 2, 3, 4, 5, 6 }, { 2, 3 }), 0));
+}
@@ -0,0 +1,130 @@
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+#include "uzuki/parse.hpp"
+#include "nlohmann/json.hpp"
+
+#include "test_subclass.h"
+
+#include <cmath>
+
+/** Writing into caller-owned memory, possibly with a validity bitmap. **/
+
+static std::vector<double> storage;
+static std::vector<unsigned char> bitmap;
+static bool use_bitmap = false;
+static size_t set_calls = 0, missing_calls = 0;
+
+struct BufferedNumberArray : public DefaultNumberArray {
+    BufferedNumberArray(std::vector<size_t> d) : DefaultNumberArray(d) {
+        size_t prod = 1;
+        for (auto x : d) {
+            prod *= x;
+        }
+        storage.assign(prod, -1);
+        bitmap.assign((prod + 7) / 8, 0xAA);
+    }
+
+    void set(size_t i, double v) {
+        ++set_calls;
+        DefaultNumberArray::set(i, v);
+    }
+
+    void set_missing(size_t i) {
+        ++missing_calls;
+        storage[i] = std::nan("");
+    }
+
+    double* buffer() { return storage.data(); }
+
+    unsigned char* validity() { return (use_bitmap ? bitmap.data() : nullptr); }
+};
+
+struct BufferedIntegerVector : public DefaultIntegerVector {
+    BufferedIntegerVector(size_t l) : DefaultIntegerVector(l), values(l) {}
+
+    void set(size_t i, int32_t v) {
+        ++set_calls;
+        DefaultIntegerVector::set(i, v);
+    }
+
+    int32_t* buffer() { return values.data(); }
+
+    std::vector<int32_t> values;
+};
+
+struct BufferedProvisioner : public DefaultProvisioner {
+    static uzuki::IntegerVector* new_Integer(size_t l) { return (new BufferedIntegerVector(l)); }
+
+    static uzuki::NumberArray* new_Number(std::vector<size_t> d) { return (new BufferedNumberArray(std::move(d))); }
+
+    using DefaultProvisioner::new_Integer;
+    using DefaultProvisioner::new_Number;
+};
+
+class BufferTest : public ::testing::Test {
+protected:
+    void SetUp() {
+        set_calls = 0;
+        missing_calls = 0;
+        use_bitmap = false;
+    }
+};
+
+TEST_F(BufferTest, Array) {
+    auto contents = nlohmann::json::parse("{ \"a\": { \"type\": \"number\", \"values\": [ 1.5, null, 3, 4, 5, 6.5 ], \"dimensions\": [ 3, 2 ] } }");
+    uzuki::parse<BufferedProvisioner>(contents, DefaultExternals(0));
+    EXPECT_EQ(set_calls, 0);
+    EXPECT_EQ(missing_calls, 1);
+    EXPECT_EQ(storage[0], 1.5);
+    EXPECT_TRUE(std::isnan(storage[1]));
+    EXPECT_EQ(storage[5], 6.5);
+
+    // Missingness is recorded in the bitmap instead.
+    use_bitmap = true;
+    uzuki::parse<BufferedProvisioner>(contents, DefaultExternals(0));
+    EXPECT_EQ(set_calls, 0);
+    EXPECT_EQ(missing_calls, 1);
+    EXPECT_EQ(bitmap[0] & 0x3F, 0x3D);
+    EXPECT_EQ(storage[2], 3);
+}
+
+TEST_F(BufferTest, Encodings) {
+    use_bitmap = true;
+    auto rle = nlohmann::json::parse("{ \"a\": { \"type\": \"number\", \"encoding\": \"rle\", \"values\": [ 2, null ], \"lengths\": [ 3, 1 ], \"dimensions\": [ 2, 2 ] } }");
+    uzuki::parse<BufferedProvisioner>(rle, DefaultExternals(0));
+    EXPECT_EQ(storage, std::vector<double>({ 2, 2, 2, -1 }));
+    EXPECT_EQ(bitmap[0] & 0xF, 0x7);
+
+    auto seq = nlohmann::json::parse("{ \"a\": { \"type\": \"number\", \"encoding\": \"sequence\", \"start\": 1, \"step\": 0.5, \"length\": 4, \"dimensions\": [ 2, 2 ] } }");
+    uzuki::parse<BufferedProvisioner>(seq, DefaultExternals(0));
+    EXPECT_EQ(storage, std::vector<double>({ 1, 1.5, 2, 2.5 }));
+
+    // Base64-encoded doubles 1, 2 with the second one missing.
+    auto b64 = nlohmann::json::parse("{ \"a\": { \"type\": \"number\", \"encoding\": \"base64\", \"values\": \"AAAAAAAA8D8AAAAAAAAAQA==\", \"validity\": \"AQ==\", \"dimensions\": [ 2 ] } }");
+    uzuki::parse<BufferedProvisioner>(b64, DefaultExternals(0));
+    EXPECT_EQ(storage[0], 1);
+    EXPECT_EQ(bitmap[0] & 0x3, 0x1);
+    EXPECT_EQ(set_calls, 0);
+    EXPECT_EQ(missing_calls, 0);
+}
+
+TEST_F(BufferTest, Vector) {
+    auto contents = nlohmann::json::parse("{ \"a\": { \"type\": \"integer\", \"values\": [ 1, 2, 3 ] } }");
+    auto parsed = uzuki::parse<BufferedProvisioner>(contents, DefaultExternals(0));
+    auto list = static_cast<const DefaultList*>(parsed.get());
+    auto vec = static_cast<const BufferedIntegerVector*>(list->values[0].get());
+    EXPECT_EQ(vec->values, std::vector<int32_t>({ 1, 2, 3 }));
+    EXPECT_EQ(set_calls, 0);
+
+    // Errors are still thrown as usual.
+    auto invalid = nlohmann::json::parse("{ \"a\": { \"type\": \"integer\", \"values\": [ 1, 2.5 ] } }");
+    EXPECT_ANY_THROW({
+        try {
+            uzuki::parse<BufferedProvisioner>(invalid, DefaultExternals(0));
+        } catch (std::exception& e) {
+            EXPECT_THAT(e.what(), ::testing::HasSubstr("should be an integer"));
+            throw;
+        }
+    });
+}
@@ -0,0 +1,180 @@
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+#include "uzuki/cache.hpp"
+
+#include <filesystem>
+#include <fstream>
+#include <string>
+
+TEST(HashTest, KnownValues) {
+    EXPECT_EQ(uzuki::hash_bytes(std::string("")), 0xEF46DB3751D8E999ULL);
+    EXPECT_EQ(uzuki::hash_bytes(std::string("a")), 0xD24EC4F1A98C6E5BULL);
+    EXPECT_EQ(uzuki::hash_bytes(std::string("The quick brown fox jumps over the lazy dog")), 0x0B242D361FDA71BCULL);
+}
+
+TEST(ValidationCacheTest, Memory) {
+    uzuki::ValidationCache<> cache(2);
+    std::string doc1 = "[ { \"type\": \"other\", \"index\": 0 } ]";
+    std::string doc2 = "[ { \"type\": \"nothing\" } ]";
+    std::string doc3 = "[ { \"type\": \"integer\", \"values\": [ 1.5 ] } ]";
+
+    EXPECT_EQ(cache.validate(doc1), 1);
+    EXPECT_EQ(cache.misses(), 1);
+    EXPECT_EQ(cache.validate(doc1), 1);
+    EXPECT_EQ(cache.hits(), 1);
+
+    EXPECT_NO_THROW(cache.validate(doc1, 1));
+    EXPECT_EQ(cache.hits(), 2);
+    EXPECT_ANY_THROW({
+        try {
+            cache.validate(doc1, 2);
+        } catch (std::exception& e) {
+            EXPECT_THAT(e.what(), ::testing::HasSubstr("fewer"));
+            throw;
+        }
+    });
+
+    // Failures are cached as well, along with their location.
+    for (int i = 0; i < 2; ++i) {
+        EXPECT_ANY_THROW({
+            try {
+                cache.validate(doc3);
+            } catch (uzuki::Error& e) {
+                EXPECT_THAT(e.what(), ::testing::HasSubstr("should be an integer"));
+                EXPECT_EQ(e.code(), uzuki::ErrorCode::INVALID_VALUE);
+                EXPECT_EQ(e.path(), "[0].values");
+                EXPECT_EQ(e.index(), 0);
+                throw;
+            }
+        });
+    }
+    EXPECT_EQ(cache.misses(), 2);
+    EXPECT_EQ(cache.hits(), 4);
+
+    // Evicting the least recently used entry.
+    EXPECT_EQ(cache.validate(doc2), 0);
+    EXPECT_EQ(cache.misses(), 3);
+    EXPECT_ANY_THROW(cache.validate(doc3, 0));
+}
+
+TEST(ValidationCacheTest, InvalidJson) {
+    uzuki::ValidationCache<> cache(2);
+    for (int i = 0; i < 2; ++i) {
+        try {
+            cache.validate("[ { \"type\": ");
+            FAIL() << "expected an error";
+        } catch (uzuki::Error& e) {
+            EXPECT_EQ(e.code(), uzuki::ErrorCode::UNKNOWN);
+        }
+    }
+    EXPECT_EQ(cache.misses(), 1);
+}
+
+TEST(ValidationCacheTest, Eviction) {
+    uzuki::ValidationCache<> cache(1);
+    std::string doc1 = "[ { \"type\": \"other\", \"index\": 0 } ]";
+    std::string doc2 = "[ { \"type\": \"nothing\" } ]";
+
+    cache.validate(doc1);
+    cache.validate(doc2);
+    cache.validate(doc1);
+    EXPECT_EQ(cache.misses(), 3);
+    EXPECT_EQ(cache.hits(), 0);
+
+    cache.clear();
+    cache.validate(doc1);
+    EXPECT_EQ(cache.misses(), 4);
+}
+
+TEST(ValidationCacheTest, Disk) {
+    auto dir = std::filesystem::temp_directory_path() / "uzuki-cache-test";
+    std::filesystem::remove_all(dir);
+    std::filesystem::create_directories(dir);
+
+    std::string doc1 = "{ \"foo\": { \"type\": \"other\", \"index\": 1 }, \"bar\": { \"type\": \"other\", \"index\": 0 } }";
+    std::string doc2 = "[ { \"type\": \"string\", \"values\": [ 1 ] } ]";
+    {
+        uzuki::ValidationCache<> cache(10, dir.string());
+        EXPECT_EQ(cache.validate(doc1), 2);
+        EXPECT_ANY_THROW(cache.validate(doc2));
+        EXPECT_EQ(cache.misses(), 2);
+    }
+
+    {
+        uzuki::ValidationCache<> cache(10, dir.string());
+        EXPECT_EQ(cache.validate(doc1), 2);
+        EXPECT_ANY_THROW({
+            try {
+                cache.validate(doc2);
+            } catch (uzuki::Error& e) {
+                EXPECT_THAT(e.what(), ::testing::HasSubstr("[0].values[0]"));
+                EXPECT_EQ(e.code(), uzuki::ErrorCode::INVALID_VALUE);
+                EXPECT_EQ(e.path(), "[0].values");
+                EXPECT_EQ(e.index(), 0);
+                throw;
+            }
+        });
+        EXPECT_EQ(cache.misses(), 0);
+        EXPECT_EQ(cache.hits(), 2);
+    }
+
+    // Files are keyed by the cache version, so those from other versions are ignored.
+    size_t nfiles = 0;
+    for (const auto& entry : std::filesystem::directory_iterator(dir)) {
+        auto name = entry.path().filename().string();
+        EXPECT_THAT(name, ::testing::HasSubstr("-v" + std::to_string(uzuki::caching::version) + ".uzuki"));
+        auto stale = name.substr(0, name.find("-v")) + ".uzuki";
+        std::filesystem::rename(entry.path(), dir / stale);
+        ++nfiles;
+    }
+    EXPECT_EQ(nfiles, 2);
+    {
+        uzuki::ValidationCache<> cache(10, dir.string());
+        EXPECT_EQ(cache.validate(doc1), 2);
+        EXPECT_EQ(cache.misses(), 1);
+    }
+
+    // Files are also keyed by the limits.
+    uzuki::Options opt;
+    opt.limits.max_depth = 1;
+    {
+        uzuki::ValidationCache<> cache(10, dir.string(), opt);
+        EXPECT_EQ(cache.validate(doc1), 2);
+        EXPECT_EQ(cache.misses(), 1);
+    }
+    {
+        uzuki::ValidationCache<> cache(10, dir.string(), opt);
+        EXPECT_EQ(cache.validate(doc1), 2);
+        EXPECT_EQ(cache.hits(), 1);
+    }
+
+    // Corrupted files are ignored.
+    for (const auto& entry : std::filesystem::directory_iterator(dir)) {
+        std::ofstream handle(entry.path());
+        handle << "0 0 1 0 1000000000000\nfoo";
+    }
+    {
+        uzuki::ValidationCache<> cache(10, dir.string());
+        EXPECT_EQ(cache.validate(doc1), 2);
+        EXPECT_EQ(cache.misses(), 1);
+    }
+
+    std::filesystem::remove_all(dir);
+}
+
+TEST(ValidationCacheTest, Limits) {
+    uzuki::Options opt;
+    opt.limits.max_depth = 1;
+    uzuki::ValidationCache<> cache(10, "", opt);
+    EXPECT_EQ(cache.validate("[ { \"type\": \"nothing\" } ]"), 0);
+    for (int i = 0; i < 2; ++i) {
+        try {
+            cache.validate("[ [ { \"type\": \"nothing\" } ] ]");
+            FAIL() << "expected an error";
+        } catch (uzuki::Error& e) {
+            EXPECT_EQ(e.code(), uzuki::ErrorCode::LIMIT_EXCEEDED);
+        }
+    }
+    EXPECT_EQ(cache.misses(), 2);
+}
@@ -0,0 +1,112 @@
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+#include "uzuki/parse.hpp"
+#include "uzuki/compact.hpp"
+#include "nlohmann/json.hpp"
+
+#include "test_subclass.h"
+
+struct CompactProvisioner : public DefaultProvisioner {
+    static uzuki::Factor* new_Factor(size_t l, size_t ll) { return (new uzuki::CompactFactor(l, ll)); }
+
+    static uzuki::BooleanVector* new_Boolean(size_t l) { return (new uzuki::CompactBooleanVector(l)); }
+
+    static uzuki::FactorArray* new_Factor(std::vector<size_t> d, size_t ll) { return (new uzuki::CompactFactorArray(std::move(d), ll)); }
+
+    static uzuki::BooleanArray* new_Boolean(std::vector<size_t> d) { return (new uzuki::CompactBooleanArray(std::move(d))); }
+
+    using DefaultProvisioner::new_Factor;
+    using DefaultProvisioner::new_Boolean;
+};
+
+TEST(CompactTest, Codes) {
+    uzuki::PackedCodes small(5, 256);
+    EXPECT_EQ(small.width(), 1);
+    small.set(0, 255);
+    small.set_missing(1);
+    EXPECT_EQ(small.get(0), 255);
+    EXPECT_TRUE(small.is_missing(1));
+    EXPECT_FALSE(small.is_missing(0));
+
+    uzuki::PackedCodes medium(5, 257);
+    EXPECT_EQ(medium.width(), 2);
+    medium.set(4, 256);
+    EXPECT_EQ(medium.get(4), 256);
+
+    uzuki::PackedCodes large(5, 70000);
+    EXPECT_EQ(large.width(), 4);
+    large.set(2, 69999);
+    EXPECT_EQ(large.get(2), 69999);
+
+    EXPECT_EQ(uzuki::PackedCodes(0, 0).width(), 1);
+}
+
+TEST(CompactTest, Booleans) {
+    uzuki::PackedBooleans bools(10);
+    bools.set(0, true);
+    bools.set(1, false);
+    bools.set_missing(2);
+    bools.set(9, true);
+    EXPECT_TRUE(bools.get(0));
+    EXPECT_FALSE(bools.get(1));
+    EXPECT_TRUE(bools.is_missing(2));
+    EXPECT_FALSE(bools.is_missing(9));
+    EXPECT_EQ(bools.validity().data()[0], 0x3);
+    EXPECT_EQ(bools.validity().data()[1], 0x2);
+}
+
+TEST(CompactTest, Parse) {
+    auto contents = nlohmann::json::parse("{ \
+        \"a\": { \"type\": \"factor\", \"values\": [ \"lo\", null, \"hi\" ], \"levels\": [ \"lo\", \"hi\" ], \"names\": [ \"x\", \"y\", \"z\" ] }, \
+        \"b\": { \"type\": \"ordered\", \"values\": [ \"hi\", \"lo\", \"lo\", \"hi\" ], \"levels\": [ \"lo\", \"hi\" ], \"dimensions\": [ 2, 2 ] }, \
+        \"c\": { \"type\": \"boolean\", \"values\": [ true, false, null, true ] }, \
+        \"d\": { \"type\": \"boolean\", \"encoding\": \"base64\", \"values\": \"AQABAQ==\", \"dimensions\": [ 2, 2 ] } \
+    }");
+    auto parsed = uzuki::parse<CompactProvisioner>(contents, DefaultExternals(0));
+    auto list = static_cast<const DefaultList*>(parsed.get());
+
+    auto a = static_cast<const uzuki::CompactFactor*>(list->values[0].get());
+    EXPECT_EQ(*(a->levels), std::vector<std::string>({ "lo", "hi" }));
+    EXPECT_EQ(a->codes.width(), 1);
+    EXPECT_EQ(a->codes.get(0), 0);
+    EXPECT_TRUE(a->codes.is_missing(1));
+    EXPECT_EQ(a->codes.get(2), 1);
+    EXPECT_FALSE(a->ordered);
+    EXPECT_EQ(a->names[2], "z");
+
+    auto b = static_cast<const uzuki::CompactFactorArray*>(list->values[1].get());
+    EXPECT_TRUE(b->ordered);
+    EXPECT_EQ(b->dimensions, std::vector<size_t>({ 2, 2 }));
+    EXPECT_EQ(b->codes.get(0), 1);
+    EXPECT_EQ(b->codes.get(1), 0);
+
+    auto c = static_cast<const uzuki::CompactBooleanVector*>(list->values[2].get());
+    EXPECT_TRUE(c->values.get(0));
+    EXPECT_FALSE(c->values.get(1));
+    EXPECT_TRUE(c->values.is_missing(2));
+    EXPECT_TRUE(c->values.get(3));
+
+    auto d = static_cast<const uzuki::CompactBooleanArray*>(list->values[3].get());
+    EXPECT_TRUE(d->values.get(0));
+    EXPECT_FALSE(d->values.get(1));
+    EXPECT_TRUE(d->values.get(3));
+    EXPECT_FALSE(d->values.is_missing(1));
+}
+
+TEST(CompactTest, ManyLevels) {
+    nlohmann::json levels = nlohmann::json::array(), values = nlohmann::json::array();
+    for (size_t i = 0; i < 300; ++i) {
+        levels.push_back("L" + std::to_string(i));
+    }
+    values.push_back("L299");
+    values.push_back("L0");
+    nlohmann::json contents = {{ "a", {{ "type", "factor" }, { "values", values }, { "levels", levels }} }};
+
+    auto parsed = uzuki::parse<CompactProvisioner>(contents, DefaultExternals(0));
+    auto list = static_cast<const DefaultList*>(parsed.get());
+    auto a = static_cast<const uzuki::CompactFactor*>(list->values[0].get());
+    EXPECT_EQ(a->codes.width(), 2);
+    EXPECT_EQ(a->codes.get(0), 299);
+    EXPECT_EQ(a->codes.get(1), 0);
+}
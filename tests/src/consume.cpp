@@ -0,0 +1,110 @@
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+#include "uzuki/parse.hpp"
+#include "uzuki/parser.hpp"
+#include "nlohmann/json.hpp"
+
+#include "test_subclass.h"
+
+static const char* example = "{ \
+    \"a\": { \"type\": \"string\", \"values\": [ \"foo\", null, \"a fairly long string that avoids the small string optimization\" ], \"names\": [ \"x\", \"y\", \"z\" ] }, \
+    \"b\": [ \
+        { \"type\": \"ordered\", \"encoding\": \"rle\", \"values\": [ \"lo\", \"hi\" ], \"lengths\": [ 2, 1 ], \"levels\": [ \"lo\", \"hi\" ] }, \
+        { \"type\": \"date\", \"values\": [ \"2023-01-01\", \"2023-02-03\" ], \"dimensions\": [ 1, 2 ], \"names\": [ [ \"r\" ], [ \"c1\", \"c2\" ] ] } \
+    ], \
+    \"c\": { \"type\": \"data.frame\", \"rows\": 2, \"columns\": { \"x\": { \"type\": \"string\", \"values\": [ \"u\", \"v\" ] } }, \"names\": [ \"p\", \"q\" ] } \
+}";
+
+static void compare(const DefaultList* left, const DefaultList* right) {
+    ASSERT_EQ(left->names, right->names);
+
+    auto la = static_cast<const DefaultStringVector*>(left->values[0].get());
+    auto ra = static_cast<const DefaultStringVector*>(right->values[0].get());
+    EXPECT_EQ(la->base.values, ra->base.values);
+    EXPECT_EQ(la->base.names, ra->base.names);
+
+    auto lb = static_cast<const DefaultList*>(left->values[1].get());
+    auto rb = static_cast<const DefaultList*>(right->values[1].get());
+    auto lf = static_cast<const DefaultFactor*>(lb->values[0].get());
+    auto rf = static_cast<const DefaultFactor*>(rb->values[0].get());
+    EXPECT_EQ(lf->fbase.levels, rf->fbase.levels);
+    EXPECT_EQ(lf->vbase.values, rf->vbase.values);
+
+    auto ld = static_cast<const DefaultDateArray*>(lb->values[1].get());
+    auto rd = static_cast<const DefaultDateArray*>(rb->values[1].get());
+    EXPECT_EQ(ld->base.values, rd->base.values);
+    EXPECT_EQ(ld->base.names, rd->base.names);
+
+    auto lc = static_cast<const DefaultDataFrame*>(left->values[2].get());
+    auto rc = static_cast<const DefaultDataFrame*>(right->values[2].get());
+    EXPECT_EQ(lc->colnames, rc->colnames);
+    EXPECT_EQ(lc->rownames, rc->rownames);
+    auto lx = static_cast<const DefaultStringVector*>(lc->columns[0].get());
+    auto rx = static_cast<const DefaultStringVector*>(rc->columns[0].get());
+    EXPECT_EQ(lx->base.values, rx->base.values);
+}
+
+TEST(ConsumeTest, Basic) {
+    auto contents = nlohmann::json::parse(example);
+    auto ref = uzuki::parse<DefaultProvisioner>(contents, DefaultExternals(0));
+    EXPECT_EQ(contents, nlohmann::json::parse(example)); // lvalues are untouched.
+
+    auto consumed = uzuki::parse<DefaultProvisioner>(std::move(contents), DefaultExternals(0));
+    EXPECT_TRUE(contents.is_null());
+    compare(static_cast<const DefaultList*>(ref.get()), static_cast<const DefaultList*>(consumed.get()));
+
+    // Same results with a Parser.
+    uzuki::Parser<> parser;
+    auto again = nlohmann::json::parse(example);
+    auto reparsed = parser.parse<DefaultProvisioner>(std::move(again), DefaultExternals(0));
+    EXPECT_TRUE(again.is_null());
+    compare(static_cast<const DefaultList*>(ref.get()), static_cast<const DefaultList*>(reparsed.get()));
+}
+
+TEST(ConsumeTest, Fingerprints) {
+    uzuki::Fingerprints ref_fp, con_fp;
+    uzuki::Options opt;
+
+    opt.fingerprints = &ref_fp;
+    auto ref = uzuki::parse<DefaultProvisioner>(nlohmann::json::parse(example), DefaultExternals(0), opt);
+    auto contents = nlohmann::json::parse(example);
+    opt.fingerprints = &con_fp;
+    auto consumed = uzuki::parse<DefaultProvisioner>(std::move(contents), DefaultExternals(0), opt);
+
+    EXPECT_EQ(ref_fp.document, con_fp.document);
+    EXPECT_EQ(ref_fp.nodes, con_fp.nodes);
+    compare(static_cast<const DefaultList*>(ref.get()), static_cast<const DefaultList*>(consumed.get()));
+}
+
+static const nlohmann::json* watched = nullptr;
+static bool released = false;
+
+struct WatchingProvisioner : public DefaultProvisioner {
+    static uzuki::Nothing* new_Nothing() {
+        // Earlier siblings should have been released by the time we get here.
+        released = (*watched)[0].is_null() && (*watched)[1].is_null();
+        return DefaultProvisioner::new_Nothing();
+    }
+};
+
+TEST(ConsumeTest, Release) {
+    auto contents = nlohmann::json::parse("[ { \"type\": \"integer\", \"values\": [ 1, 2 ] }, [ { \"type\": \"string\", \"values\": [ \"a\" ] } ], { \"type\": \"nothing\" } ]");
+    watched = &contents;
+    uzuki::parse<WatchingProvisioner>(std::move(contents), DefaultExternals(0));
+    EXPECT_TRUE(released);
+    EXPECT_TRUE(contents.is_null());
+    watched = nullptr;
+}
+
+TEST(ConsumeTest, Invalid) {
+    auto contents = nlohmann::json::parse("{ \"a\": { \"type\": \"string\", \"values\": [ \"foo\", 1 ] } }");
+    EXPECT_ANY_THROW({
+        try {
+            uzuki::parse<DefaultProvisioner>(std::move(contents), DefaultExternals(0));
+        } catch (std::exception& e) {
+            EXPECT_THAT(e.what(), ::testing::HasSubstr("\".a.values[1]\" should be a string"));
+            throw;
+        }
+    });
+}
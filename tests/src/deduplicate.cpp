@@ -0,0 +1,181 @@
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+#include "uzuki/parse.hpp"
+#include "uzuki/validate.hpp"
+#include "uzuki/parser.hpp"
+#include "uzuki/compact.hpp"
+#include "nlohmann/json.hpp"
+
+#include "test_subclass.h"
+
+static size_t created = 0;
+
+struct CountingProvisioner : public DefaultProvisioner {
+    static uzuki::NumberVector* new_Number(size_t l) {
+        ++created;
+        return DefaultProvisioner::new_Number(l);
+    }
+
+    static uzuki::Factor* new_Factor(size_t l, size_t ll) {
+        ++created;
+        return (new uzuki::CompactFactor(l, ll));
+    }
+
+    using DefaultProvisioner::new_Number;
+    using DefaultProvisioner::new_Factor;
+};
+
+class DeduplicateTest : public ::testing::Test {
+protected:
+    void SetUp() {
+        created = 0;
+    }
+
+    static uzuki::Options options() {
+        uzuki::Options opt;
+        opt.deduplicate = true;
+        return opt;
+    }
+};
+
+TEST_F(DeduplicateTest, Nodes) {
+    auto contents = nlohmann::json::parse("{ \
+        \"a\": { \"type\": \"number\", \"values\": [ 1, 2, 3 ], \"names\": [ \"x\", \"y\", \"z\" ] }, \
+        \"b\": [ { \"names\": [ \"x\", \"y\", \"z\" ], \"values\": [ 1.0, 2, 3 ], \"type\": \"number\" } ], \
+        \"c\": { \"type\": \"number\", \"values\": [ 1, 2, 4 ], \"names\": [ \"x\", \"y\", \"z\" ] }, \
+        \"d\": { \"type\": \"data.frame\", \"rows\": 3, \"columns\": { \"p\": { \"type\": \"number\", \"values\": [ 1, 2, 3 ], \"names\": [ \"x\", \"y\", \"z\" ] } } } \
+    }");
+
+    auto parsed = uzuki::parse<CountingProvisioner>(contents, DefaultExternals(0), options());
+    EXPECT_EQ(created, 2);
+
+    auto list = static_cast<const DefaultList*>(parsed.get());
+    auto b = static_cast<const DefaultList*>(list->values[1].get());
+    EXPECT_EQ(list->values[0], b->values[0]); // key order and number representation don't matter.
+    EXPECT_NE(list->values[0], list->values[2]);
+
+    auto d = static_cast<const DefaultDataFrame*>(list->values[3].get());
+    EXPECT_EQ(list->values[0], d->columns[0]);
+
+    // Same results without deduplication, just with more nodes.
+    created = 0;
+    auto ref = uzuki::parse<CountingProvisioner>(contents, DefaultExternals(0));
+    EXPECT_EQ(created, 4);
+    auto rlist = static_cast<const DefaultList*>(ref.get());
+    auto rvec = static_cast<const DefaultNumberVector*>(rlist->values[0].get());
+    auto vec = static_cast<const DefaultNumberVector*>(list->values[0].get());
+    EXPECT_EQ(rvec->base.values, vec->base.values);
+    EXPECT_EQ(rvec->base.names, vec->base.names);
+}
+
+TEST_F(DeduplicateTest, Levels) {
+    auto contents = nlohmann::json::parse("{ \
+        \"a\": { \"type\": \"factor\", \"values\": [ \"lo\", \"hi\" ], \"levels\": [ \"lo\", \"hi\" ] }, \
+        \"b\": { \"type\": \"factor\", \"values\": [ \"hi\", \"hi\", null ], \"levels\": [ \"lo\", \"hi\" ] }, \
+        \"c\": { \"type\": \"factor\", \"values\": [ \"hi\" ], \"levels\": [ \"hi\", \"lo\" ] } \
+    }");
+
+    auto parsed = uzuki::parse<CountingProvisioner>(contents, DefaultExternals(0), options());
+    EXPECT_EQ(created, 3);
+
+    auto list = static_cast<const DefaultList*>(parsed.get());
+    auto a = static_cast<const uzuki::CompactFactor*>(list->values[0].get());
+    auto b = static_cast<const uzuki::CompactFactor*>(list->values[1].get());
+    auto c = static_cast<const uzuki::CompactFactor*>(list->values[2].get());
+    EXPECT_EQ(a->levels, b->levels);
+    EXPECT_NE(a->levels, c->levels);
+    EXPECT_EQ(b->codes.get(0), 1);
+    EXPECT_TRUE(b->codes.is_missing(2));
+    EXPECT_EQ(c->codes.get(0), 0);
+
+    // Factors that don't support sharing still get their levels.
+    auto ref = uzuki::parse<DefaultProvisioner>(contents, DefaultExternals(0), options());
+    auto rlist = static_cast<const DefaultList*>(ref.get());
+    auto rb = static_cast<const DefaultFactor*>(rlist->values[1].get());
+    EXPECT_EQ(rb->fbase.levels, std::vector<std::string>({ "lo", "hi" }));
+    EXPECT_EQ(rb->vbase.values[0], 1);
+}
+
+TEST_F(DeduplicateTest, Errors) {
+    auto contents = nlohmann::json::parse("{ \
+        \"a\": { \"type\": \"factor\", \"values\": [ \"lo\" ], \"levels\": [ \"lo\", \"hi\" ] }, \
+        \"b\": { \"type\": \"factor\", \"values\": [ \"mid\" ], \"levels\": [ \"lo\", \"hi\" ] } \
+    }");
+    EXPECT_ANY_THROW({
+        try {
+            uzuki::parse<DefaultProvisioner>(contents, DefaultExternals(0), options());
+        } catch (std::exception& e) {
+            EXPECT_THAT(e.what(), ::testing::HasSubstr("\".b.values[0]\" should be present"));
+            throw;
+        }
+    });
+
+    contents = nlohmann::json::parse("{ \
+        \"a\": { \"type\": \"factor\", \"values\": [ \"lo\" ], \"levels\": [ \"lo\", \"lo\" ] } \
+    }");
+    EXPECT_ANY_THROW({
+        try {
+            uzuki::validate(contents, 0, options());
+        } catch (std::exception& e) {
+            EXPECT_THAT(e.what(), ::testing::HasSubstr("duplicated"));
+            throw;
+        }
+    });
+}
+
+TEST_F(DeduplicateTest, Fingerprints) {
+    auto contents = nlohmann::json::parse("[ { \"type\": \"number\", \"values\": [ 1 ] }, { \"type\": \"number\", \"values\": [ 1 ] } ]");
+    uzuki::Fingerprints ref_fp, dedup_fp;
+    uzuki::Statistics stats;
+
+    auto opt = options();
+    opt.fingerprints = &dedup_fp;
+    opt.statistics = &stats;
+    uzuki::parse<DefaultProvisioner>(contents, DefaultExternals(0), opt);
+
+    uzuki::Options ref_opt;
+    ref_opt.fingerprints = &ref_fp;
+    uzuki::parse<DefaultProvisioner>(contents, DefaultExternals(0), ref_opt);
+
+    EXPECT_EQ(ref_fp.document, dedup_fp.document);
+    EXPECT_EQ(ref_fp.nodes, dedup_fp.nodes);
+    EXPECT_EQ(stats.nodes.at("[1]").sum, 1);
+}
+
+TEST_F(DeduplicateTest, Parser) {
+    // Shared nodes are not carried over between documents.
+    uzuki::Parser<> parser(options());
+    auto contents = nlohmann::json::parse("{ \"a\": { \"type\": \"number\", \"values\": [ 1, 2 ] } }");
+    auto first = parser.parse<CountingProvisioner>(contents, DefaultExternals(0));
+    auto second = parser.parse<CountingProvisioner>(contents, DefaultExternals(0));
+    EXPECT_EQ(created, 2);
+    EXPECT_NE(static_cast<const DefaultList*>(first.get())->values[0], static_cast<const DefaultList*>(second.get())->values[0]);
+
+    // Consumption is disabled as the document is needed for comparisons.
+    auto consumed = uzuki::parse<CountingProvisioner>(std::move(contents), DefaultExternals(0), options());
+    EXPECT_EQ(created, 3);
+}
+
+TEST_F(DeduplicateTest, IgnoredKeys) {
+    // Deeply nested content in ignored keys is neither hashed nor compared recursively.
+    size_t depth = 500000;
+    std::string junk = std::string(depth, '[') + std::string(depth, ']');
+    auto contents = nlohmann::json::parse(
+        "[ { \"type\": \"number\", \"values\": [ 1, 2 ], \"junk\": " + junk + ", \"start\": " + junk + " }, "
+        "{ \"type\": \"number\", \"values\": [ 1, 2 ], \"junk\": " + junk + ", \"start\": " + junk + " }, "
+        "{ \"type\": \"number\", \"values\": [ 1, 2 ], \"start\": [ 1 ] } ]"
+    );
+
+    auto parsed = uzuki::parse<CountingProvisioner>(contents, DefaultExternals(0), options());
+    EXPECT_EQ(created, 2);
+    auto list = static_cast<const DefaultList*>(parsed.get());
+    EXPECT_EQ(list->values[0], list->values[1]);
+    EXPECT_NE(list->values[0], list->values[2]);
+
+    uzuki::Fingerprints prints;
+    auto opt = options();
+    opt.fingerprints = &prints;
+    uzuki::validate(contents, 0, opt);
+    EXPECT_EQ(prints.nodes.at("[0]"), prints.nodes.at("[1]"));
+}
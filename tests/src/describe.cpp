@@ -0,0 +1,90 @@
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+#include "uzuki/describe.hpp"
+#include "nlohmann/json.hpp"
+
+TEST(DescribeTest, Basic) {
+    auto desc = uzuki::describe(nlohmann::json::parse("{ \
+        \"a\": { \"type\": \"integer\", \"values\": [ 1, null, 3 ], \"names\": [ \"x\", \"y\", \"z\" ] }, \
+        \"b\": [ \
+            { \"type\": \"ordered\", \"encoding\": \"rle\", \"values\": [ \"A\", null ], \"lengths\": [ 2, 3 ], \"levels\": [ \"A\", \"B\" ] }, \
+            { \"type\": \"number\", \"values\": [ 1, 2, null, 4, 5, 6 ], \"dimensions\": [ 3, 2 ] }, \
+            { \"type\": \"other\", \"index\": 0 } \
+        ], \
+        \"c\": { \"type\": \"data.frame\", \"rows\": 2, \"columns\": { \"x\": { \"type\": \"string\", \"values\": [ null, null ] } } }, \
+        \"d\": { \"type\": \"nothing\" } \
+    }"));
+
+    EXPECT_EQ(desc.type, uzuki::LIST);
+    EXPECT_EQ(desc.length, 4);
+    EXPECT_TRUE(desc.has_names);
+    EXPECT_EQ(desc.names, std::vector<std::string>({ "a", "b", "c", "d" }));
+    ASSERT_EQ(desc.children.size(), 4);
+
+    const auto& a = desc.children[0];
+    EXPECT_EQ(a.type, uzuki::INTEGER);
+    EXPECT_EQ(a.length, 3);
+    EXPECT_EQ(a.missing, 1);
+    EXPECT_TRUE(a.has_names);
+    EXPECT_TRUE(a.children.empty());
+
+    const auto& b = desc.children[1];
+    EXPECT_EQ(b.type, uzuki::LIST);
+    EXPECT_FALSE(b.has_names);
+    ASSERT_EQ(b.children.size(), 3);
+
+    EXPECT_EQ(b.children[0].type, uzuki::FACTOR);
+    EXPECT_EQ(b.children[0].length, 5);
+    EXPECT_EQ(b.children[0].missing, 3);
+    EXPECT_EQ(b.children[0].levels, 2);
+    EXPECT_TRUE(b.children[0].ordered);
+
+    EXPECT_EQ(b.children[1].type, uzuki::NUMBER_ARRAY);
+    EXPECT_EQ(b.children[1].dimensions, std::vector<size_t>({ 3, 2 }));
+    EXPECT_EQ(b.children[1].length, 6);
+    EXPECT_EQ(b.children[1].missing, 1);
+
+    EXPECT_EQ(b.children[2].type, uzuki::OTHER);
+    EXPECT_EQ(b.children[2].index, 0);
+
+    const auto& c = desc.children[2];
+    EXPECT_EQ(c.type, uzuki::DATA_FRAME);
+    EXPECT_EQ(c.length, 2);
+    EXPECT_EQ(c.names, std::vector<std::string>({ "x" }));
+    EXPECT_EQ(c.children[0].type, uzuki::STRING);
+    EXPECT_EQ(c.children[0].missing, 2);
+
+    EXPECT_EQ(desc.children[3].type, uzuki::NOTHING);
+}
+
+TEST(DescribeTest, Structural) {
+    // Values are not checked...
+    auto desc = uzuki::describe(nlohmann::json::parse("[ { \"type\": \"integer\", \"values\": [ \"foo\" ] } ]"));
+    EXPECT_EQ(desc.children[0].length, 1);
+
+    // ... but the structure is.
+    EXPECT_ANY_THROW(uzuki::describe(nlohmann::json::parse("[ { \"type\": \"integer\", \"values\": [ 1, 2 ], \"dimensions\": [ 3 ] } ]")));
+    EXPECT_ANY_THROW(uzuki::describe(nlohmann::json::parse("[ { \"type\": \"foo\", \"values\": [] } ]")));
+    EXPECT_ANY_THROW(uzuki::describe(nlohmann::json::parse("[ { \"type\": \"factor\", \"values\": [] } ]")));
+    EXPECT_ANY_THROW(uzuki::describe(nlohmann::json::parse("[ { \"type\": \"other\", \"index\": 1 } ]")));
+    EXPECT_ANY_THROW(uzuki::describe(nlohmann::json::parse("[ { \"type\": \"data.frame\", \"rows\": 2, \"columns\": { \"x\": { \"type\": \"string\", \"values\": [ null ] } } } ]")));
+}
+
+TEST(DescribeTest, Deduplicate) {
+    uzuki::Options opt;
+    opt.deduplicate = true;
+    auto desc = uzuki::describe(nlohmann::json::parse("[ \
+        { \"type\": \"integer\", \"values\": [ 1, 2, null, 4 ], \"dimensions\": [ 2, 2 ] }, \
+        { \"type\": \"integer\", \"values\": [ 1, 2, null, 4 ], \"dimensions\": [ 2, 2 ] } \
+    ]"), opt);
+
+    // Shared nodes are copied into each description.
+    ASSERT_EQ(desc.children.size(), 2);
+    for (const auto& child : desc.children) {
+        EXPECT_EQ(child.type, uzuki::INTEGER_ARRAY);
+        EXPECT_EQ(child.dimensions, std::vector<size_t>({ 2, 2 }));
+        EXPECT_EQ(child.length, 4);
+        EXPECT_EQ(child.missing, 1);
+    }
+}
@@ -0,0 +1,124 @@
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+#include "uzuki/validate.hpp"
+#include "uzuki/parser.hpp"
+#include "nlohmann/json.hpp"
+
+#include "test_subclass.h"
+
+static uzuki::Result check(std::string contents, size_t num_external = 0) {
+    return uzuki::validate_nothrow(nlohmann::json::parse(contents), num_external);
+}
+
+TEST(ErrorTest, Codes) {
+    EXPECT_TRUE(check("{ \"a\": { \"type\": \"integer\", \"values\": [ 1, 2 ] } }").ok());
+
+    auto res = check("{ \"a\": { \"type\": \"integer\", \"values\": [ 1, 2, \"foo\" ] } }");
+    EXPECT_EQ(res.code, uzuki::ErrorCode::INVALID_VALUE);
+    EXPECT_EQ(res.path, ".a.values");
+    EXPECT_EQ(res.index, 2);
+    EXPECT_EQ(res.message(), "\".a.values[2]\" should be an integer");
+
+    res = check("{ \"a\": { \"type\": \"integer\", \"values\": [ 1, 2, 1e10 ] } }");
+    EXPECT_EQ(res.code, uzuki::ErrorCode::OUT_OF_RANGE);
+    EXPECT_EQ(res.index, 2);
+
+    res = check("{ \"a\": [ { \"type\": \"date\", \"values\": [ \"2023-01-01\", \"foo\" ] } ] }");
+    EXPECT_EQ(res.code, uzuki::ErrorCode::INVALID_DATE);
+    EXPECT_EQ(res.path, ".a[0].values");
+    EXPECT_EQ(res.index, 1);
+
+    res = check("{ \"a\": { \"type\": \"factor\", \"values\": [ \"x\", \"z\" ], \"levels\": [ \"x\", \"y\" ] } }");
+    EXPECT_EQ(res.code, uzuki::ErrorCode::UNKNOWN_LEVEL);
+    EXPECT_EQ(res.index, 1);
+
+    res = check("{ \"a\": { \"type\": \"foo\", \"values\": [] } }");
+    EXPECT_EQ(res.code, uzuki::ErrorCode::INVALID_TYPE);
+    EXPECT_EQ(res.path, ".a");
+    EXPECT_EQ(res.index, uzuki::Error::no_index);
+
+    res = check("{ \"a\": { \"type\": \"integer\", \"values\": [ 1 ], \"dimensions\": [ 2 ] } }");
+    EXPECT_EQ(res.code, uzuki::ErrorCode::INVALID_DIMENSIONS);
+    EXPECT_EQ(res.path, ".a.dimensions");
+
+    res = check("{ \"a\": { \"type\": \"data.frame\", \"rows\": 2, \"columns\": { \"x\": { \"type\": \"integer\", \"values\": [ 1 ] } } } }");
+    EXPECT_EQ(res.code, uzuki::ErrorCode::INVALID_DATA_FRAME);
+    EXPECT_EQ(res.path, ".a.columns.x");
+
+    res = check("[ { \"type\": \"other\", \"index\": 0 }, { \"type\": \"other\", \"index\": 0 } ]", 2);
+    EXPECT_EQ(res.code, uzuki::ErrorCode::DUPLICATE_EXTERNAL);
+    EXPECT_EQ(res.path, "[1].index");
+    EXPECT_EQ(res.index, 0);
+
+    res = check("[ { \"type\": \"other\", \"index\": 0 } ]", 2);
+    EXPECT_EQ(res.code, uzuki::ErrorCode::EXTERNAL_COUNT);
+
+    res = check("[ 1 ]");
+    EXPECT_EQ(res.code, uzuki::ErrorCode::INVALID_STRUCTURE);
+    EXPECT_EQ(res.path, "[0]");
+    EXPECT_STREQ(uzuki::error_name(res.code), "INVALID_STRUCTURE");
+    EXPECT_STREQ(uzuki::error_name(uzuki::ErrorCode::OK), "OK");
+}
+
+TEST(ErrorTest, Messages) {
+    auto contents = nlohmann::json::parse("{ \"a\": { \"type\": \"boolean\", \"values\": [ true, 1 ] } }");
+    auto res = uzuki::validate_nothrow(contents, 0, uzuki::Options());
+    EXPECT_EQ(res.code, uzuki::ErrorCode::INVALID_VALUE);
+    EXPECT_EQ(res.message(), "\".a.values[1]\" should be a boolean");
+
+    uzuki::Options opt;
+    opt.limits.max_total_elements = 1;
+    res = uzuki::validate_nothrow(contents, 0, opt);
+    EXPECT_EQ(res.code, uzuki::ErrorCode::LIMIT_EXCEEDED);
+    EXPECT_EQ(res.path, ".a");
+
+    // Structured errors are still thrown by the usual functions.
+    try {
+        uzuki::validate(contents, 0);
+        FAIL() << "expected an error";
+    } catch (const uzuki::Error& e) {
+        EXPECT_EQ(e.code(), uzuki::ErrorCode::INVALID_VALUE);
+        EXPECT_THAT(e.what(), ::testing::HasSubstr("should be a boolean"));
+    }
+}
+
+TEST(ErrorTest, UnknownCount) {
+    auto contents = nlohmann::json::parse("[ { \"type\": \"other\", \"index\": 1 }, { \"type\": \"other\", \"index\": 0 } ]");
+    size_t num_external = 0;
+    EXPECT_TRUE(uzuki::validate_nothrow(contents, uzuki::Options(), num_external).ok());
+    EXPECT_EQ(num_external, 2);
+
+    contents = nlohmann::json::parse("[ { \"type\": \"other\", \"index\": 1 } ]");
+    num_external = 100;
+    auto res = uzuki::validate_nothrow(contents, uzuki::Options(), num_external);
+    EXPECT_EQ(res.code, uzuki::ErrorCode::EXTERNAL_COUNT);
+    EXPECT_EQ(num_external, 100);
+
+    contents = nlohmann::json::parse("[ { \"type\": \"other\", \"index\": 0 }, { \"type\": \"other\", \"index\": 0 } ]");
+    res = uzuki::validate_nothrow(contents, uzuki::Options(), num_external);
+    EXPECT_EQ(res.code, uzuki::ErrorCode::DUPLICATE_EXTERNAL);
+    EXPECT_EQ(res.path, "[1].index");
+    EXPECT_EQ(res.message(), "\"[1].index\" for type \"other\" is duplicated (0)");
+}
+
+TEST(ErrorTest, Parse) {
+    auto contents = nlohmann::json::parse("{ \"a\": { \"type\": \"number\", \"values\": [ 1, 2 ] } }");
+    std::shared_ptr<uzuki::Base> output;
+    auto res = uzuki::parse_nothrow<DefaultProvisioner>(contents, DefaultExternals(0), output);
+    EXPECT_TRUE(res.ok());
+    ASSERT_TRUE(output != nullptr);
+    EXPECT_EQ(output->type(), uzuki::LIST);
+
+    std::shared_ptr<uzuki::Base> failed;
+    res = uzuki::parse_nothrow<DefaultProvisioner>(contents, DefaultExternals(1), failed, uzuki::Options());
+    EXPECT_EQ(res.code, uzuki::ErrorCode::EXTERNAL_COUNT);
+    EXPECT_THAT(res.message(), ::testing::HasSubstr("fewer instances"));
+    EXPECT_TRUE(failed == nullptr);
+
+    uzuki::Parser<> parser;
+    EXPECT_TRUE(parser.validate_nothrow(contents, 0).ok());
+    res = parser.validate_nothrow(nlohmann::json::parse("{ \"a\": { \"type\": \"number\", \"values\": [ 1, \"foo\" ] } }"), 0);
+    EXPECT_EQ(res.code, uzuki::ErrorCode::INVALID_VALUE);
+    EXPECT_EQ(res.index, 1);
+}
@@ -0,0 +1,97 @@
+#include <gtest/gtest.h>
+
+#include "uzuki/validate.hpp"
+#include "uzuki/parse.hpp"
+#include "nlohmann/json.hpp"
+
+#include "test_subclass.h"
+
+#include <string>
+
+template<class Json = nlohmann::json>
+uzuki::Fingerprints fingerprint(std::string contents) {
+    uzuki::Fingerprints prints;
+    uzuki::Options opt;
+    opt.fingerprints = &prints;
+    uzuki::validate(Json::parse(contents), opt);
+    return prints;
+}
+
+TEST(FingerprintTest, KeyOrderAndWhitespace) {
+    auto ref = fingerprint<nlohmann::ordered_json>("[ { \"type\": \"integer\", \"values\": [ 1, 2, 3 ], \"names\": [ \"a\", \"b\", \"c\" ] }, { \"type\": \"nothing\" } ]");
+    auto alt = fingerprint<nlohmann::ordered_json>("[{\"names\":[\"a\",\"b\",\"c\"],\"values\":[1,2,3.0],\n\"type\":\"integer\"},{\"type\":\"nothing\"}]");
+    EXPECT_EQ(ref.document, alt.document);
+    EXPECT_EQ(ref.nodes, alt.nodes);
+    EXPECT_EQ(ref.nodes.size(), 3);
+    EXPECT_EQ(ref.nodes[""], ref.document);
+    EXPECT_NE(ref.nodes["[0]"], ref.nodes["[1]"]);
+
+    // Element order is respected.
+    auto swapped = fingerprint<nlohmann::ordered_json>("[ { \"type\": \"nothing\" }, { \"type\": \"integer\", \"values\": [ 1, 2, 3 ], \"names\": [ \"a\", \"b\", \"c\" ] } ]");
+    EXPECT_NE(ref.document, swapped.document);
+    EXPECT_EQ(ref.nodes["[0]"], swapped.nodes["[1]"]);
+
+    auto reordered = fingerprint<nlohmann::ordered_json>("[ { \"type\": \"integer\", \"values\": [ 2, 1, 3 ], \"names\": [ \"a\", \"b\", \"c\" ] }, { \"type\": \"nothing\" } ]");
+    EXPECT_NE(ref.nodes["[0]"], reordered.nodes["[0]"]);
+    EXPECT_EQ(ref.nodes["[1]"], reordered.nodes["[1]"]);
+
+    // Named lists respect the order of their elements.
+    auto named1 = fingerprint<nlohmann::ordered_json>("{ \"A\": { \"type\": \"nothing\" }, \"B\": [] }");
+    auto named2 = fingerprint<nlohmann::ordered_json>("{ \"B\": [], \"A\": { \"type\": \"nothing\" } }");
+    EXPECT_NE(named1.document, named2.document);
+    EXPECT_EQ(named1.nodes[".A"], named2.nodes[".A"]);
+
+    // Unnamed and named lists are distinguished.
+    EXPECT_NE(fingerprint("[]").document, fingerprint("{}").document);
+}
+
+TEST(FingerprintTest, DataFrameColumns) {
+    auto df1 = fingerprint("{ \"foo\": { \"type\": \"data.frame\", \"rows\": 2, \"columns\": { \
+        \"x\": { \"type\": \"integer\", \"values\": [ 1, 2 ] }, \
+        \"y\": { \"type\": \"string\", \"values\": [ \"A\", \"B\" ] } } } }");
+    auto df2 = fingerprint("{ \"bar\": { \"type\": \"data.frame\", \"rows\": 2, \"columns\": { \
+        \"x\": { \"type\": \"integer\", \"values\": [ 1, 2 ] }, \
+        \"z\": { \"type\": \"string\", \"values\": [ \"A\", \"C\" ] } } } }");
+
+    EXPECT_EQ(df1.nodes.count(".foo.columns.x"), 1);
+    EXPECT_EQ(df1.nodes[".foo.columns.x"], df2.nodes[".bar.columns.x"]);
+    EXPECT_NE(df1.nodes[".foo.columns.y"], df2.nodes[".bar.columns.z"]);
+    EXPECT_NE(df1.nodes[".foo"], df2.nodes[".bar"]);
+}
+
+TEST(FingerprintTest, Parse) {
+    std::string contents = "[ { \"type\": \"other\", \"index\": 0 }, { \"type\": \"number\", \"values\": [ 1.5, null ] } ]";
+    auto ref = fingerprint(contents);
+
+    uzuki::Fingerprints prints;
+    uzuki::Options opt;
+    opt.fingerprints = &prints;
+    uzuki::parse<DefaultProvisioner>(nlohmann::json::parse(contents), DefaultExternals(1), opt);
+    EXPECT_EQ(prints.document, ref.document);
+    EXPECT_EQ(prints.nodes, ref.nodes);
+
+    // Consistent with the canonical hash of the JSON content for non-list objects.
+    auto parsed = nlohmann::json::parse(contents);
+    EXPECT_EQ(prints.nodes["[1]"], uzuki::hash_json(parsed[1]));
+}
+
+TEST(FingerprintTest, ExtraKeys) {
+    auto ref = fingerprint("[ { \"type\": \"integer\", \"values\": [ 1, 2 ] } ]");
+    auto extra = fingerprint("[ { \"type\": \"integer\", \"values\": [ 1, 2 ], \"foo\": { \"bar\": [ 1 ] } } ]");
+    EXPECT_EQ(ref.document, extra.document);
+    EXPECT_EQ(ref.nodes, extra.nodes);
+
+    // Deeply nested junk is ignored without recursing through it.
+    size_t depth = 1000000;
+    std::string junk = "[ { \"type\": \"integer\", \"values\": [ 1, 2 ], \"junk\": ";
+    junk += std::string(depth, '[');
+    junk += std::string(depth, ']');
+    junk += " } ]";
+    auto deep = fingerprint(junk);
+    EXPECT_EQ(ref.nodes, deep.nodes);
+
+    // Same for the raw hash.
+    auto parsed = nlohmann::json::parse(junk);
+    EXPECT_NE(uzuki::hash_json(parsed), uzuki::hash_json(nlohmann::json::parse("[ { \"type\": \"integer\", \"values\": [ 1, 2 ] } ]")));
+    EXPECT_EQ(uzuki::hash_node(parsed[0]), ref.nodes["[0]"]);
+}
@@ -0,0 +1,184 @@
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+#include "uzuki/index.hpp"
+#include "nlohmann/json.hpp"
+
+#include "test_subclass.h"
+
+#include <filesystem>
+#include <fstream>
+
+class IndexTest : public ::testing::Test {
+protected:
+    void SetUp() {
+        dir = std::filesystem::temp_directory_path() / "uzuki-index-test";
+        std::filesystem::remove_all(dir);
+        std::filesystem::create_directories(dir);
+        file = (dir / "doc.json").string();
+        write(document);
+    }
+
+    void TearDown() {
+        std::filesystem::remove_all(dir);
+    }
+
+    void write(const std::string& contents) {
+        std::ofstream handle(file, std::ios::binary);
+        handle << contents;
+    }
+
+    std::filesystem::path dir;
+    std::string file;
+
+    const std::string document = "{\n\
+  \"a\": { \"values\": [ 1, 2, 3 ], \"type\": \"integer\" },\n\
+  \"b\\\"c\": [\n\
+    { \"type\": \"string\", \"values\": [ \"x]\", \"y}\" ] },\n\
+    { \"type\": \"data.frame\", \"rows\": 2, \"columns\": {\n\
+      \"x\": { \"type\": \"number\", \"values\": [ 1.5, null ] },\n\
+      \"y\": { \"type\": \"boolean\", \"values\": [ true, false ], \"dimensions\": [ 2, 1 ] }\n\
+    } },\n\
+    { \"type\": \"other\", \"index\": 1 },\n\
+    []\n\
+  ],\n\
+  \"d\": { \"e\": { \"type\": \"other\", \"index\": 0 }, \"f\": { \"type\": \"integer\", \"values\": [ \"bad\" ] } }\n\
+}";
+};
+
+TEST_F(IndexTest, Build) {
+    auto index = uzuki::build_index_from_file(file);
+    EXPECT_EQ(index.file_size, document.size());
+
+    auto root = index.find("");
+    ASSERT_TRUE(root != nullptr);
+    EXPECT_EQ(root->type, uzuki::LIST);
+    EXPECT_EQ(root->length, 3);
+    EXPECT_EQ(root->begin, 0);
+    EXPECT_EQ(root->end, document.size());
+
+    auto a = index.find(".a");
+    ASSERT_TRUE(a != nullptr);
+    EXPECT_EQ(a->type, uzuki::INTEGER);
+    EXPECT_EQ(a->length, 3);
+    EXPECT_EQ(document.substr(a->begin, a->end - a->begin), "{ \"values\": [ 1, 2, 3 ], \"type\": \"integer\" }");
+
+    auto s = index.find(".b\"c[0]");
+    ASSERT_TRUE(s != nullptr);
+    EXPECT_EQ(s->type, uzuki::STRING);
+    EXPECT_EQ(document.substr(s->begin, s->end - s->begin), "{ \"type\": \"string\", \"values\": [ \"x]\", \"y}\" ] }");
+
+    auto y = index.find(".b\"c[1].columns.y");
+    ASSERT_TRUE(y != nullptr);
+    EXPECT_TRUE(y->column);
+    EXPECT_EQ(y->path.substr(0, y->parent_size), ".b\"c[1]");
+    EXPECT_EQ(y->type, uzuki::BOOLEAN_ARRAY);
+    EXPECT_EQ(y->dimensions, std::vector<uint64_t>({ 2, 1 }));
+
+    auto empty = index.find(".b\"c[3]");
+    ASSERT_TRUE(empty != nullptr);
+    EXPECT_EQ(empty->type, uzuki::LIST);
+    EXPECT_EQ(empty->length, 0);
+
+    EXPECT_TRUE(index.find(".b\"c[4]") == nullptr);
+    EXPECT_TRUE(index.find(".a.values") == nullptr);
+
+    // Round-tripping via the sidecar file.
+    auto sidecar = (dir / "doc.json.idx").string();
+    uzuki::save_index(index, sidecar);
+    auto reloaded = uzuki::load_index(sidecar);
+    EXPECT_EQ(reloaded.file_size, index.file_size);
+    ASSERT_EQ(reloaded.entries.size(), index.entries.size());
+    for (size_t i = 0; i < index.entries.size(); ++i) {
+        const auto& left = index.entries[i];
+        const auto& right = reloaded.entries[i];
+        EXPECT_EQ(left.path, right.path);
+        EXPECT_EQ(left.type, right.type);
+        EXPECT_EQ(left.length, right.length);
+        EXPECT_EQ(left.dimensions, right.dimensions);
+        EXPECT_EQ(left.begin, right.begin);
+        EXPECT_EQ(left.end, right.end);
+        EXPECT_EQ(left.column, right.column);
+        EXPECT_EQ(left.parent_size, right.parent_size);
+        EXPECT_EQ(left.hash, right.hash);
+    }
+}
+
+TEST_F(IndexTest, AmbiguousPaths) {
+    EXPECT_ANY_THROW({
+        try {
+            uzuki::build_index("{ \"a.b\": { \"type\": \"nothing\" }, \"a\": { \"b\": { \"type\": \"nothing\" } } }");
+        } catch (std::exception& e) {
+            EXPECT_THAT(e.what(), ::testing::HasSubstr("\".a.b\""));
+            throw;
+        }
+    });
+
+    EXPECT_ANY_THROW(uzuki::build_index("{ \"a[0]\": { \"type\": \"nothing\" }, \"a\": [ { \"type\": \"nothing\" } ] }"));
+
+    // Unambiguous names are fine.
+    auto index = uzuki::build_index("{ \"a.b\": { \"type\": \"nothing\" }, \"a\": { \"c\": { \"type\": \"nothing\" } } }");
+    EXPECT_TRUE(index.find(".a.b") != nullptr);
+    EXPECT_TRUE(index.find(".a.c") != nullptr);
+}
+
+TEST_F(IndexTest, ParseAt) {
+    auto index = uzuki::build_index_from_file(file);
+
+    auto a = uzuki::parse_at<DefaultProvisioner>(file, index, ".a", DefaultExternals(2));
+    EXPECT_EQ(a->type(), uzuki::INTEGER);
+    EXPECT_EQ(static_cast<const DefaultIntegerVector*>(a.get())->base.values, std::vector<int32_t>({ 1, 2, 3 }));
+
+    auto x = uzuki::parse_at<DefaultProvisioner>(file, index, ".b\"c[1].columns.x", DefaultExternals(2));
+    EXPECT_EQ(x->type(), uzuki::NUMBER);
+    EXPECT_EQ(static_cast<const DefaultNumberVector*>(x.get())->base.values[0], 1.5);
+
+    auto b = uzuki::parse_at<DefaultProvisioner>(file, index, ".b\"c", DefaultExternals(2));
+    auto lptr = static_cast<const DefaultList*>(b.get());
+    EXPECT_EQ(lptr->size(), 4);
+    EXPECT_EQ(lptr->values[1]->type(), uzuki::DATA_FRAME);
+    EXPECT_EQ(reinterpret_cast<uintptr_t>(static_cast<const DefaultOther*>(lptr->values[2].get())->ptr), 2);
+
+    auto other = uzuki::parse_at<DefaultProvisioner>(file, index, ".b\"c[2]", BatchedExternals(2));
+    EXPECT_EQ(reinterpret_cast<uintptr_t>(static_cast<const DefaultOther*>(other.get())->ptr), 2);
+
+    // Only the selected slice is validated.
+    auto e = uzuki::parse_at<DefaultProvisioner>(file, index, ".d.e", DefaultExternals(2));
+    EXPECT_EQ(e->type(), uzuki::OTHER);
+    EXPECT_ANY_THROW({
+        try {
+            uzuki::parse_at<DefaultProvisioner>(file, index, ".d", DefaultExternals(2));
+        } catch (std::exception& e) {
+            EXPECT_THAT(e.what(), ::testing::HasSubstr("\".d.f.values[0]\""));
+            throw;
+        }
+    });
+
+    EXPECT_ANY_THROW(uzuki::parse_at<DefaultProvisioner>(file, index, ".z", DefaultExternals(2)));
+    EXPECT_ANY_THROW(uzuki::parse_at<DefaultProvisioner>(file, index, ".b\"c[2]", DefaultExternals(1))); // out of range.
+
+    write(document + "\n");
+    EXPECT_ANY_THROW({
+        try {
+            uzuki::parse_at<DefaultProvisioner>(file, index, ".a", DefaultExternals(2));
+        } catch (std::exception& e) {
+            EXPECT_THAT(e.what(), ::testing::HasSubstr("out of date"));
+            throw;
+        }
+    });
+
+    // Changes that preserve the file size are caught by the hash of the node.
+    auto modified = document;
+    modified.replace(modified.find("[ 1, 2, 3 ]"), 11, "[ 3, 2, 1 ]");
+    write(modified);
+    EXPECT_ANY_THROW({
+        try {
+            uzuki::parse_at<DefaultProvisioner>(file, index, ".a", DefaultExternals(2));
+        } catch (std::exception& e) {
+            EXPECT_THAT(e.what(), ::testing::HasSubstr("out of date"));
+            throw;
+        }
+    });
+    auto unchanged = uzuki::parse_at<DefaultProvisioner>(file, index, ".b\"c[1].columns.x", DefaultExternals(2));
+    EXPECT_EQ(unchanged->type(), uzuki::NUMBER);
+}
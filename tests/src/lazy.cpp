@@ -0,0 +1,171 @@
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+#include "uzuki/parse.hpp"
+#include "uzuki/lazy.hpp"
+#include "nlohmann/json.hpp"
+
+#include "test_subclass.h"
+
+#include <thread>
+#include <functional>
+
+static void expect_error(std::function<void()> fun, std::string msg) {
+    EXPECT_ANY_THROW({
+        try {
+            fun();
+        } catch (std::exception& e) {
+            EXPECT_THAT(e.what(), ::testing::HasSubstr(msg));
+            throw;
+        }
+    });
+}
+
+template<bool defer>
+struct LazyProvisioner : public DefaultProvisioner {
+    static constexpr bool lazy_values = true;
+
+    static constexpr bool defer_validation = defer;
+
+    static uzuki::LazyVector<int32_t, uzuki::INTEGER, nlohmann::json>* new_Integer(size_t l) { return (new uzuki::LazyVector<int32_t, uzuki::INTEGER, nlohmann::json>(l, 2)); }
+
+    static uzuki::LazyVector<double, uzuki::NUMBER, nlohmann::json>* new_Number(size_t l) { return (new uzuki::LazyVector<double, uzuki::NUMBER, nlohmann::json>(l, 2)); }
+
+    static uzuki::LazyVector<std::string, uzuki::STRING, nlohmann::json>* new_String(size_t l) { return (new uzuki::LazyVector<std::string, uzuki::STRING, nlohmann::json>(l, 2)); }
+
+    static uzuki::LazyVector<unsigned char, uzuki::BOOLEAN, nlohmann::json>* new_Boolean(size_t l) { return (new uzuki::LazyVector<unsigned char, uzuki::BOOLEAN, nlohmann::json>(l, 2)); }
+
+    static uzuki::LazyVector<std::string, uzuki::DATE, nlohmann::json>* new_Date(size_t l) { return (new uzuki::LazyVector<std::string, uzuki::DATE, nlohmann::json>(l, 2)); }
+
+    static uzuki::LazyArray<int32_t, uzuki::INTEGER_ARRAY, nlohmann::json>* new_Integer(std::vector<size_t> d) { return (new uzuki::LazyArray<int32_t, uzuki::INTEGER_ARRAY, nlohmann::json>(std::move(d), 2)); }
+
+    static uzuki::LazyArray<double, uzuki::NUMBER_ARRAY, nlohmann::json>* new_Number(std::vector<size_t> d) { return (new uzuki::LazyArray<double, uzuki::NUMBER_ARRAY, nlohmann::json>(std::move(d), 2)); }
+
+    static uzuki::LazyArray<unsigned char, uzuki::BOOLEAN_ARRAY, nlohmann::json>* new_Boolean(std::vector<size_t> d) { return (new uzuki::LazyArray<unsigned char, uzuki::BOOLEAN_ARRAY, nlohmann::json>(std::move(d), 2)); }
+
+    static uzuki::LazyArray<std::string, uzuki::STRING_ARRAY, nlohmann::json>* new_String(std::vector<size_t> d) { return (new uzuki::LazyArray<std::string, uzuki::STRING_ARRAY, nlohmann::json>(std::move(d), 2)); }
+
+    static uzuki::LazyArray<std::string, uzuki::DATE_ARRAY, nlohmann::json>* new_Date(std::vector<size_t> d) { return (new uzuki::LazyArray<std::string, uzuki::DATE_ARRAY, nlohmann::json>(std::move(d), 2)); }
+};
+
+typedef uzuki::LazyVector<int32_t, uzuki::INTEGER, nlohmann::json> LazyIntegerVector;
+typedef uzuki::LazyVector<std::string, uzuki::STRING, nlohmann::json> LazyStringVector;
+
+TEST(LazyTest, Vector) {
+    auto contents = nlohmann::json::parse("{ \
+        \"a\": { \"type\": \"integer\", \"values\": [ 1, null, 3, 4, 5 ], \"names\": [ \"v\", \"w\", \"x\", \"y\", \"z\" ] }, \
+        \"b\": { \"type\": \"string\", \"encoding\": \"rle\", \"values\": [ \"A\", null, \"B\" ], \"lengths\": [ 3, 0, 2 ] }, \
+        \"c\": { \"type\": \"factor\", \"values\": [ \"x\", \"y\" ], \"levels\": [ \"x\", \"y\" ] } \
+    }");
+    auto parsed = uzuki::parse<LazyProvisioner<false> >(contents, DefaultExternals(0));
+    auto list = static_cast<const DefaultList*>(parsed.get());
+
+    auto a = static_cast<const LazyIntegerVector*>(list->values[0].get());
+    EXPECT_EQ(a->size(), 5);
+    EXPECT_EQ(a->values.loaded_chunks(), 0);
+    EXPECT_EQ(a->names[3], "y");
+
+    EXPECT_EQ(a->values.get(3), 4);
+    EXPECT_EQ(a->values.loaded_chunks(), 1);
+    EXPECT_FALSE(a->values.is_missing(2));
+    EXPECT_EQ(a->values.loaded_chunks(), 1);
+    EXPECT_EQ(a->values.get(0), 1);
+    EXPECT_TRUE(a->values.is_missing(1));
+    EXPECT_EQ(a->values.get(4), 5);
+    EXPECT_EQ(a->values.loaded_chunks(), 3);
+
+    auto b = static_cast<const LazyStringVector*>(list->values[1].get());
+    EXPECT_EQ(b->size(), 5);
+    EXPECT_EQ(b->values.get(3), "B");
+    EXPECT_EQ(b->values.get(2), "A");
+    EXPECT_EQ(b->values.get(0), "A");
+    EXPECT_EQ(b->values.get(4), "B");
+    EXPECT_FALSE(b->values.is_missing(1));
+
+    // Factors are always decoded eagerly.
+    auto c = static_cast<const DefaultFactor*>(list->values[2].get());
+    EXPECT_EQ(c->vbase.values[1], 1);
+}
+
+TEST(LazyTest, Array) {
+    auto contents = nlohmann::json::parse("{ \"a\": { \"type\": \"number\", \"values\": [ 1, 2, null, 4, 5, 6 ], \"dimensions\": [ 3, 2 ], \"names\": [ [ \"x\", \"y\", \"z\" ], null ] } }");
+    auto parsed = uzuki::parse<LazyProvisioner<false> >(contents, DefaultExternals(0));
+    auto list = static_cast<const DefaultList*>(parsed.get());
+
+    auto a = static_cast<const uzuki::LazyArray<double, uzuki::NUMBER_ARRAY, nlohmann::json>*>(list->values[0].get());
+    EXPECT_EQ(a->dimensions, std::vector<size_t>({ 3, 2 }));
+    EXPECT_EQ(a->names[0][2], "z");
+    EXPECT_TRUE(a->names[1].empty());
+    EXPECT_EQ(a->values.get(5), 6);
+    EXPECT_TRUE(a->values.is_missing(2));
+    EXPECT_EQ(a->values.loaded_chunks(), 2);
+}
+
+TEST(LazyTest, Eager) {
+    // Sequences are filled directly.
+    auto contents = nlohmann::json::parse("{ \"a\": { \"type\": \"integer\", \"encoding\": \"sequence\", \"start\": 5, \"step\": 2, \"length\": 3 } }");
+    auto parsed = uzuki::parse<LazyProvisioner<false> >(contents, DefaultExternals(0));
+    auto list = static_cast<const DefaultList*>(parsed.get());
+
+    auto a = static_cast<const LazyIntegerVector*>(list->values[0].get());
+    EXPECT_EQ(a->values.loaded_chunks(), 2);
+    EXPECT_EQ(a->values.get(0), 5);
+    EXPECT_EQ(a->values.get(2), 9);
+
+    // Typed arrays in row-major order are reordered into a temporary copy, so they can't be bound.
+    auto tcontents = nlohmann::json::parse("{ \"a\": { \"type\": \"number\", \"values\": { \"_ArrayType_\": \"double\", \"_ArraySize_\": [ 2, 2 ], \"_ArrayData_\": [ 1, 2, 3, 4 ] }, \"dimensions\": [ 2, 2 ] } }");
+    auto tparsed = uzuki::parse<LazyProvisioner<false> >(tcontents, DefaultExternals(0));
+    auto tlist = static_cast<const DefaultList*>(tparsed.get());
+
+    auto ta = static_cast<const uzuki::LazyArray<double, uzuki::NUMBER_ARRAY, nlohmann::json>*>(tlist->values[0].get());
+    EXPECT_EQ(ta->values.loaded_chunks(), 2);
+    EXPECT_EQ(ta->values.get(1), 3);
+    EXPECT_EQ(ta->values.get(2), 2);
+}
+
+TEST(LazyTest, Validation) {
+    auto contents = nlohmann::json::parse("{ \"a\": { \"type\": \"integer\", \"values\": [ 1, 2, 3, \"foo\" ] } }");
+    expect_error([&]() -> void { uzuki::parse<LazyProvisioner<false> >(contents, DefaultExternals(0)); }, "\".a.values[3]\" should be an integer");
+
+    // Errors are only reported when the offending chunk is decoded.
+    auto parsed = uzuki::parse<LazyProvisioner<true> >(contents, DefaultExternals(0));
+    auto list = static_cast<const DefaultList*>(parsed.get());
+    auto a = static_cast<const LazyIntegerVector*>(list->values[0].get());
+    EXPECT_EQ(a->values.get(1), 2);
+    expect_error([&]() -> void { a->values.get(2); }, "\".a.values[3]\" should be an integer");
+    expect_error([&]() -> void { a->values.get(3); }, "\".a.values[3]\" should be an integer");
+    EXPECT_EQ(a->values.loaded_chunks(), 1);
+
+    auto dcontents = nlohmann::json::parse("{ \"a\": { \"type\": \"date\", \"encoding\": \"rle\", \"values\": [ \"2023-01-01\", \"foo\" ], \"lengths\": [ 3, 1 ] } }");
+    expect_error([&]() -> void { uzuki::parse<LazyProvisioner<false> >(dcontents, DefaultExternals(0)); }, "\".a.values[1]\" should use a YYYY-MM-DD format");
+    auto dparsed = uzuki::parse<LazyProvisioner<true> >(dcontents, DefaultExternals(0));
+    auto d = static_cast<const uzuki::LazyVector<std::string, uzuki::DATE, nlohmann::json>*>(static_cast<const DefaultList*>(dparsed.get())->values[0].get());
+    EXPECT_EQ(d->values.get(0), "2023-01-01");
+    expect_error([&]() -> void { d->values.get(2); }, "\".a.values[1]\" should use a YYYY-MM-DD format");
+}
+
+TEST(LazyTest, Threaded) {
+    nlohmann::json values = nlohmann::json::array();
+    for (int i = 0; i < 1000; ++i) {
+        values.push_back(i);
+    }
+    uzuki::LazyValues<int32_t, uzuki::INTEGER, nlohmann::json> lazy(values.size(), 16);
+    lazy.bind(&values, nullptr, ".a");
+
+    std::vector<std::thread> workers;
+    std::vector<int> failures(4);
+    for (int t = 0; t < 4; ++t) {
+        workers.emplace_back([&](int t) -> void {
+            for (int i = 0; i < 1000; ++i) {
+                size_t j = (i * 7 + t * 13) % 1000;
+                failures[t] += (lazy.get(j) != static_cast<int32_t>(j));
+            }
+        }, t);
+    }
+    for (auto& w : workers) {
+        w.join();
+    }
+
+    EXPECT_EQ(failures, std::vector<int>(4));
+    EXPECT_EQ(lazy.loaded_chunks(), 63);
+}
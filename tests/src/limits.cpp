@@ -0,0 +1,99 @@
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+#include "uzuki/validate.hpp"
+#include "uzuki/limits.hpp"
+#include "nlohmann/json.hpp"
+
+#include <string>
+
+static void limit_check(std::string contents, const uzuki::Limits& limits, std::string msg) {
+    nlohmann::json mocked = nlohmann::json::parse(contents);
+    uzuki::Options opt;
+    opt.limits = limits;
+    EXPECT_ANY_THROW({
+        try {
+            uzuki::validate(mocked, opt);
+        } catch (std::exception& e) {
+            EXPECT_THAT(e.what(), ::testing::HasSubstr(msg));
+            throw;
+        }
+    });
+
+    // Passes without limits.
+    EXPECT_NO_THROW(uzuki::validate(mocked));
+}
+
+TEST(LimitsTest, Depth) {
+    uzuki::Limits limits;
+    limits.max_depth = 2;
+    limit_check("[ [ [ ] ] ]", limits, "[0][0]\" exceeds");
+    limit_check("{ \"a\": { \"b\": { \"c\": [] } } }", limits, ".a.b\" exceeds");
+
+    nlohmann::json ok = nlohmann::json::parse("[ [ { \"type\": \"nothing\" } ], [] ]");
+    uzuki::Options opt;
+    opt.limits = limits;
+    EXPECT_NO_THROW(uzuki::validate(ok, opt));
+}
+
+TEST(LimitsTest, Elements) {
+    uzuki::Limits limits;
+    limits.max_total_elements = 10;
+    limit_check("[ { \"type\": \"integer\", \"values\": [ 1, 2, 3, 4, 5 ] }, { \"type\": \"integer\", \"values\": [ 1, 2, 3, 4, 5 ] } ]", limits, "total number of elements");
+    limit_check("[ { \"type\": \"integer\", \"encoding\": \"sequence\", \"start\": 1, \"step\": 1, \"length\": 1000 } ]", limits, "total number of elements");
+
+    uzuki::Limits nlimits;
+    nlimits.max_node_elements = 100;
+    limit_check("[ { \"type\": \"integer\", \"encoding\": \"rle\", \"values\": [ 1, 2 ], \"lengths\": [ 100, 1 ] } ]", nlimits, "\"[0]\" exceeds");
+    limit_check("[ { \"type\": \"data.frame\", \"rows\": 1000, \"columns\": {} } ]", nlimits, "\"[0]\" exceeds");
+}
+
+TEST(LimitsTest, Strings) {
+    uzuki::Limits limits;
+    limits.max_string_bytes = 10;
+    limit_check("[ { \"type\": \"string\", \"values\": [ \"abcdef\", \"ghijkl\" ] } ]", limits, "string bytes");
+    limit_check("[ { \"type\": \"string\", \"encoding\": \"rle\", \"values\": [ \"abcdef\" ], \"lengths\": [ 2 ] } ]", limits, "string bytes");
+    limit_check("[ { \"type\": \"integer\", \"values\": [ 1, 2 ], \"names\": [ \"abcdef\", \"ghijkl\" ] } ]", limits, "string bytes");
+    limit_check("[ { \"type\": \"factor\", \"values\": [ \"abcdef\" ], \"levels\": [ \"abcdef\", \"ghijkl\" ] } ]", limits, "string bytes");
+
+    uzuki::Limits flimits;
+    flimits.max_factor_levels = 1;
+    limit_check("[ { \"type\": \"factor\", \"values\": [ \"a\" ], \"levels\": [ \"a\", \"b\" ] } ]", flimits, "number of levels");
+}
+
+TEST(LimitsTest, Overflow) {
+    nlohmann::json mocked = nlohmann::json::parse("[ { \"type\": \"integer\", \"values\": [], \"dimensions\": [ 4294967296, 4294967296, 4294967296 ] } ]");
+    EXPECT_ANY_THROW({
+        try {
+            uzuki::validate(mocked);
+        } catch (std::exception& e) {
+            EXPECT_THAT(e.what(), ::testing::HasSubstr("overflows"));
+            throw;
+        }
+    });
+
+    mocked = nlohmann::json::parse("[ { \"type\": \"integer\", \"encoding\": \"rle\", \"values\": [ 1, 2 ], \"lengths\": [ 1e19, 1e19 ] } ]");
+    EXPECT_ANY_THROW({
+        try {
+            uzuki::validate(mocked);
+        } catch (std::exception& e) {
+            EXPECT_THAT(e.what(), ::testing::HasSubstr("overflows"));
+            throw;
+        }
+    });
+}
+
+TEST(LimitsTest, EstimateCost) {
+    auto cost = uzuki::estimate_cost(nlohmann::json::parse("{ \
+        \"a\": { \"type\": \"integer\", \"values\": [ 1, 2, 3 ] }, \
+        \"b\": [ { \"type\": \"number\", \"encoding\": \"sequence\", \"start\": 0, \"step\": 1, \"length\": 1000 } ], \
+        \"c\": { \"type\": \"string\", \"encoding\": \"rle\", \"values\": [ \"abcde\" ], \"lengths\": [ 10 ], \"names\": [ \"x\" ] }, \
+        \"d\": { \"type\": \"data.frame\", \"rows\": 2, \"columns\": { \"x\": { \"type\": \"factor\", \"values\": [ \"A\", \"B\" ], \"levels\": [ \"A\", \"B\" ] } } } \
+    }"));
+
+    EXPECT_EQ(cost.depth, 2);
+    EXPECT_EQ(cost.nodes, 7); // 2 lists, 4 typed objects, 1 data frame column.
+    EXPECT_EQ(cost.elements, 4 + 1 + 3 + 1000 + 10 + 2);
+    EXPECT_EQ(cost.string_bytes, 4 + 50 + 1 + 2);
+    EXPECT_GE(cost.bytes, 3 * sizeof(int32_t) + 1000 * sizeof(double) + 10 * sizeof(std::string) + 50 + 2 * sizeof(size_t));
+}
@@ -263,3 +263,153 @@ TEST(LoadTest, ExternalCheck) {
     auto ptr2 = static_cast<const DefaultOther*>(lptr->values[1].get());
     EXPECT_EQ(reinterpret_cast<uintptr_t>(ptr2->ptr), 1);
 }
+
+TEST(LoadTest, DeferredExternalCheck) {
+    std::string contents = "{ \"a\": { \"type\": \"other\", \"index\": 2 }, \"b\": [ { \"type\": \"other\", \"index\": 0 }, { \"type\": \"nothing\" } ], \"c\": { \"type\": \"other\", \"index\": 1 } }";
+    nlohmann::json stuff = nlohmann::json::parse(contents);
+
+    auto check = [](const std::shared_ptr<uzuki::Base>& out) -> void {
+        auto lptr = static_cast<const DefaultList*>(out.get());
+        EXPECT_EQ(lptr->size(), 3);
+        EXPECT_EQ(lptr->names[0], "a");
+        EXPECT_EQ(lptr->values[0]->type(), uzuki::OTHER);
+        EXPECT_EQ(reinterpret_cast<uintptr_t>(static_cast<const DefaultOther*>(lptr->values[0].get())->ptr), 3);
+
+        auto bptr = static_cast<const DefaultList*>(lptr->values[1].get());
+        EXPECT_EQ(bptr->values[0]->type(), uzuki::OTHER);
+        EXPECT_EQ(reinterpret_cast<uintptr_t>(static_cast<const DefaultOther*>(bptr->values[0].get())->ptr), 1);
+        EXPECT_EQ(bptr->values[1]->type(), uzuki::NOTHING);
+
+        EXPECT_EQ(lptr->names[2], "c");
+        EXPECT_EQ(reinterpret_cast<uintptr_t>(static_cast<const DefaultOther*>(lptr->values[2].get())->ptr), 2);
+    };
+
+    BatchedExternals bext(3);
+    check(uzuki::parse<DefaultProvisioner>(stuff, bext));
+    EXPECT_EQ(*(bext.calls), 1);
+
+    check(uzuki::parse<DefaultProvisioner>(stuff, AsyncExternals(3)));
+
+    // No retrieval is attempted for invalid documents.
+    BatchedExternals bext2(4);
+    EXPECT_ANY_THROW(uzuki::parse<DefaultProvisioner>(stuff, bext2));
+    EXPECT_EQ(*(bext2.calls), 0);
+}
+
+TEST(LoadTest, NestedCheck) {
+    auto out = load("{ \"a\": [ { \"type\": \"nothing\" }, [ { \"b\": { \"type\": \"other\", \"index\": 0 } }, [] ], { \"c\": [] } ], \"d\": {} }", 1);
+    EXPECT_EQ(out->type(), uzuki::LIST);
+
+    auto lptr = static_cast<const DefaultList*>(out.get());
+    EXPECT_EQ(lptr->size(), 2);
+    EXPECT_TRUE(lptr->has_names);
+    EXPECT_EQ(lptr->names[0], "a");
+    EXPECT_EQ(lptr->names[1], "d");
+    EXPECT_EQ(static_cast<const DefaultList*>(lptr->values[1].get())->size(), 0);
+
+    auto aptr = static_cast<const DefaultList*>(lptr->values[0].get());
+    EXPECT_EQ(aptr->size(), 3);
+    EXPECT_FALSE(aptr->has_names);
+    EXPECT_EQ(aptr->values[0]->type(), uzuki::NOTHING);
+    EXPECT_EQ(aptr->values[1]->type(), uzuki::LIST);
+    EXPECT_EQ(aptr->values[2]->type(), uzuki::LIST);
+
+    auto a1ptr = static_cast<const DefaultList*>(aptr->values[1].get());
+    EXPECT_EQ(a1ptr->size(), 2);
+    auto bptr = static_cast<const DefaultList*>(a1ptr->values[0].get());
+    EXPECT_EQ(bptr->names[0], "b");
+    EXPECT_EQ(bptr->values[0]->type(), uzuki::OTHER);
+    EXPECT_EQ(static_cast<const DefaultList*>(a1ptr->values[1].get())->size(), 0);
+
+    auto cptr = static_cast<const DefaultList*>(aptr->values[2].get());
+    EXPECT_EQ(cptr->names[0], "c");
+}
+
+TEST(LoadTest, RunLengthCheck) {
+    auto out = load("[ { \"type\": \"string\", \"encoding\": \"rle\", \"values\": [ \"A\", null, \"B\" ], \"lengths\": [ 2, 3, 1 ] }, \
+                       { \"type\": \"factor\", \"encoding\": \"rle\", \"values\": [ \"y\", \"x\" ], \"lengths\": [ 1, 2 ], \"levels\": [ \"x\", \"y\" ], \"dimensions\": [ 3, 1 ] } ]", 0);
+    EXPECT_EQ(out->type(), uzuki::LIST);
+
+    auto lptr = static_cast<const DefaultList*>(out.get());
+    EXPECT_EQ(lptr->size(), 2);
+    EXPECT_EQ(lptr->values[0]->type(), uzuki::STRING);
+    EXPECT_EQ(lptr->values[1]->type(), uzuki::FACTOR_ARRAY);
+
+    auto ptr = static_cast<const DefaultStringVector*>(lptr->values[0].get());
+    EXPECT_EQ(ptr->size(), 6);
+    EXPECT_EQ(ptr->base.values[0], "A");
+    EXPECT_EQ(ptr->base.values[1], "A");
+    EXPECT_EQ(ptr->base.values[2], "ich bin missing");
+    EXPECT_EQ(ptr->base.values[4], "ich bin missing");
+    EXPECT_EQ(ptr->base.values[5], "B");
+
+    auto ptr2 = static_cast<const DefaultFactorArray*>(lptr->values[1].get());
+    EXPECT_EQ(ptr2->abase.values[0], 1);
+    EXPECT_EQ(ptr2->abase.values[1], 0);
+    EXPECT_EQ(ptr2->abase.values[2], 0);
+}
+
+TEST(LoadTest, SequenceCheck) {
+    auto out = load("{ \"int\": { \"type\": \"integer\", \"encoding\": \"sequence\", \"start\": 5, \"step\": -2, \"length\": 4, \"names\": [ \"a\", \"b\", \"c\", \"d\" ] }, \
+                       \"dbl\": { \"type\": \"number\", \"encoding\": \"sequence\", \"start\": 0.5, \"step\": 0.25, \"length\": 6, \"dimensions\": [ 2, 3 ] } }", 0);
+    EXPECT_EQ(out->type(), uzuki::LIST);
+
+    auto lptr = static_cast<const DefaultList*>(out.get());
+    EXPECT_EQ(lptr->names[1], "int");
+    EXPECT_EQ(lptr->values[1]->type(), uzuki::INTEGER);
+    auto iptr = static_cast<const DefaultIntegerVector*>(lptr->values[1].get());
+    EXPECT_EQ(iptr->base.values, std::vector<int32_t>({ 5, 3, 1, -1 }));
+    EXPECT_EQ(iptr->base.names[3], "d");
+
+    EXPECT_EQ(lptr->names[0], "dbl");
+    EXPECT_EQ(lptr->values[0]->type(), uzuki::NUMBER_ARRAY);
+    auto dptr = static_cast<const DefaultNumberArray*>(lptr->values[0].get());
+    EXPECT_EQ(dptr->base.dimensions[1], 3);
+    EXPECT_EQ(dptr->base.values, std::vector<double>({ 0.5, 0.75, 1, 1.25, 1.5, 1.75 }));
+}
+
+TEST(LoadTest, Base64Check) {
+    std::vector<double> dvals { 1.5, -2, 0, 1e-10, 3, 4 };
+    std::vector<unsigned char> dpresent { 1, 1, 0, 1, 1, 1 };
+    std::vector<int32_t> ivals { 1, -2, 2147483647 };
+    std::vector<unsigned char> bvals { 1, 0, 0, 1 };
+
+    nlohmann::json stuff = nlohmann::json::array({
+        nlohmann::json::object({
+            { "type", "number" },
+            { "encoding", "base64" },
+            { "values", uzuki::base64_encode_values(dvals.data(), dvals.size()) },
+            { "validity", uzuki::base64_encode_validity(dpresent.data(), dpresent.size()) },
+            { "dimensions", nlohmann::json::array({ 3, 2 }) }
+        }),
+        nlohmann::json::object({
+            { "type", "integer" },
+            { "encoding", "base64" },
+            { "values", uzuki::base64_encode_values(ivals.data(), ivals.size()) }
+        }),
+        nlohmann::json::object({
+            { "type", "boolean" },
+            { "encoding", "base64" },
+            { "values", uzuki::base64_encode_values(bvals.data(), bvals.size()) }
+        })
+    });
+
+    DefaultExternals ext(0);
+    auto out = uzuki::parse<DefaultProvisioner>(stuff, ext);
+    auto lptr = static_cast<const DefaultList*>(out.get());
+    EXPECT_EQ(lptr->values[0]->type(), uzuki::NUMBER_ARRAY);
+    EXPECT_EQ(lptr->values[1]->type(), uzuki::INTEGER);
+    EXPECT_EQ(lptr->values[2]->type(), uzuki::BOOLEAN);
+
+    auto dptr = static_cast<const DefaultNumberArray*>(lptr->values[0].get());
+    EXPECT_EQ(dptr->base.values[0], 1.5);
+    EXPECT_EQ(dptr->base.values[1], -2);
+    EXPECT_TRUE(std::isnan(dptr->base.values[2]));
+    EXPECT_EQ(dptr->base.values[3], 1e-10);
+
+    auto iptr = static_cast<const DefaultIntegerVector*>(lptr->values[1].get());
+    EXPECT_EQ(iptr->base.values, ivals);
+
+    auto bptr = static_cast<const DefaultBooleanVector*>(lptr->values[2].get());
+    EXPECT_EQ(bptr->base.values, bvals);
+}
@@ -0,0 +1,61 @@
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+#include "uzuki/parser.hpp"
+#include "nlohmann/json.hpp"
+
+#include "test_subclass.h"
+
+TEST(ParserTest, Reuse) {
+    uzuki::Parser<> parser;
+
+    auto doc1 = nlohmann::json::parse("[ { \"type\": \"factor\", \"values\": [ \"a\", \"b\", \"a\" ], \"levels\": [ \"a\", \"b\" ] }, { \"type\": \"other\", \"index\": 0 } ]");
+    auto doc2 = nlohmann::json::parse("{ \"x\": { \"type\": \"factor\", \"values\": [ \"a\", \"c\" ], \"levels\": [ \"c\", \"a\" ] }, \"y\": { \"type\": \"integer\", \"encoding\": \"rle\", \"values\": [ 1, 2 ], \"lengths\": [ 3, 1 ] } }");
+    auto bad = nlohmann::json::parse("[ { \"type\": \"factor\", \"values\": [ \"b\" ], \"levels\": [ \"a\" ] } ]");
+
+    for (int it = 0; it < 2; ++it) {
+        EXPECT_EQ(parser.validate(doc1), 1);
+        parser.validate(doc1, 1);
+        EXPECT_ANY_THROW(parser.validate(doc1, 2));
+        EXPECT_ANY_THROW(parser.validate(bad));
+
+        auto out = parser.parse<DefaultProvisioner>(doc1, DefaultExternals(1));
+        auto lptr = static_cast<const DefaultList*>(out.get());
+        EXPECT_EQ(lptr->size(), 2);
+        auto fptr = static_cast<const DefaultFactor*>(lptr->values[0].get());
+        EXPECT_EQ(fptr->vbase.values[0], 0);
+        EXPECT_EQ(fptr->vbase.values[1], 1);
+        EXPECT_EQ(fptr->vbase.values[2], 0);
+
+        // Level mappings from the previous document should not leak into the next one.
+        out = parser.parse<DefaultProvisioner>(doc2);
+        lptr = static_cast<const DefaultList*>(out.get());
+        EXPECT_EQ(lptr->names[0], "x");
+        fptr = static_cast<const DefaultFactor*>(lptr->values[0].get());
+        EXPECT_EQ(fptr->vbase.values[0], 1);
+        EXPECT_EQ(fptr->vbase.values[1], 0);
+        auto iptr = static_cast<const DefaultIntegerVector*>(lptr->values[1].get());
+        EXPECT_EQ(iptr->base.values, std::vector<int32_t>({ 1, 1, 1, 2 }));
+    }
+}
+
+TEST(ParserTest, Options) {
+    uzuki::Parser<> parser;
+    auto doc = nlohmann::json::parse("[ [ [] ] ]");
+    parser.validate(doc, 0);
+
+    parser.options().limits.max_depth = 2;
+    EXPECT_ANY_THROW(parser.validate(doc, 0));
+
+    uzuki::Fingerprints fp;
+    parser.options().limits.max_depth = 10;
+    parser.options().fingerprints = &fp;
+    parser.validate(doc);
+
+    uzuki::Fingerprints ref;
+    uzuki::Options opt;
+    opt.fingerprints = &ref;
+    uzuki::validate(doc, opt);
+    EXPECT_EQ(fp.document, ref.document);
+    EXPECT_EQ(fp.nodes, ref.nodes);
+}
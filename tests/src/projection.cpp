@@ -0,0 +1,88 @@
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+#include "uzuki/parse.hpp"
+#include "uzuki/validate.hpp"
+#include "nlohmann/json.hpp"
+
+#include "test_subclass.h"
+
+static const std::string document = "{ \
+    \"a\": { \"type\": \"integer\", \"values\": [ 1, 2, 3 ] }, \
+    \"ab\": { \"type\": \"nothing\" }, \
+    \"b\": [ \
+        { \"type\": \"string\", \"values\": [ \"x\" ] }, \
+        { \"type\": \"data.frame\", \"rows\": 2, \"columns\": { \
+            \"x\": { \"type\": \"number\", \"values\": [ 1, 2 ] }, \
+            \"y\": { \"type\": \"boolean\", \"values\": [ true, false ] } \
+        } } \
+    ], \
+    \"c\": [ { \"type\": \"other\", \"index\": 1 }, { \"type\": \"other\", \"index\": 0 } ] \
+}";
+
+static std::shared_ptr<uzuki::Base> project(const std::string& contents, std::vector<std::string> paths, bool trust = false, size_t nexpected = 2) {
+    uzuki::Options opt;
+    opt.projection.paths = std::move(paths);
+    opt.projection.trust = trust;
+    return uzuki::parse<DefaultProvisioner>(nlohmann::json::parse(contents), DefaultExternals(nexpected), opt);
+}
+
+TEST(ProjectionTest, Elements) {
+    for (int trust = 0; trust < 2; ++trust) {
+        auto out = project(document, { ".a", ".c[1]" }, trust);
+        auto lptr = static_cast<const DefaultList*>(out.get());
+        EXPECT_EQ(lptr->size(), 4);
+        EXPECT_EQ(lptr->names[0], "a");
+        EXPECT_EQ(lptr->names[2], "b");
+        EXPECT_EQ(lptr->values[0]->type(), uzuki::INTEGER);
+        EXPECT_FALSE(lptr->values[1]); // '.ab' is not selected by '.a'.
+        EXPECT_FALSE(lptr->values[2]);
+
+        auto cptr = static_cast<const DefaultList*>(lptr->values[3].get());
+        EXPECT_EQ(cptr->size(), 2);
+        EXPECT_FALSE(cptr->values[0]);
+        EXPECT_EQ(reinterpret_cast<uintptr_t>(static_cast<const DefaultOther*>(cptr->values[1].get())->ptr), 1);
+    }
+}
+
+TEST(ProjectionTest, Columns) {
+    for (int trust = 0; trust < 2; ++trust) {
+        auto out = project(document, { ".b[1].columns.y" }, trust);
+        auto lptr = static_cast<const DefaultList*>(out.get());
+        EXPECT_FALSE(lptr->values[0]);
+        EXPECT_FALSE(lptr->values[3]);
+
+        auto bptr = static_cast<const DefaultList*>(lptr->values[2].get());
+        EXPECT_FALSE(bptr->values[0]);
+        auto dptr = static_cast<const DefaultDataFrame*>(bptr->values[1].get());
+        EXPECT_EQ(dptr->nrows, 2);
+        EXPECT_EQ(dptr->columns.size(), 1);
+        EXPECT_EQ(dptr->colnames[0], "y");
+        EXPECT_EQ(dptr->columns[0]->type(), uzuki::BOOLEAN);
+    }
+
+    // Selecting the entire data frame.
+    auto out = project(document, { ".b" });
+    auto bptr = static_cast<const DefaultList*>(static_cast<const DefaultList*>(out.get())->values[2].get());
+    EXPECT_EQ(bptr->values[0]->type(), uzuki::STRING);
+    EXPECT_EQ(static_cast<const DefaultDataFrame*>(bptr->values[1].get())->columns.size(), 2);
+}
+
+TEST(ProjectionTest, Validation) {
+    std::string bad_element = "{ \"a\": { \"type\": \"nothing\" }, \"b\": [ { \"type\": \"integer\", \"values\": [ \"foo\" ] } ] }";
+    EXPECT_ANY_THROW(project(bad_element, { ".a" }, false, 0));
+    EXPECT_NO_THROW(project(bad_element, { ".a" }, true, 0));
+    EXPECT_ANY_THROW(project(bad_element, { ".b" }, true, 0));
+
+    std::string bad_column = "[ { \"type\": \"data.frame\", \"rows\": 2, \"columns\": { \"x\": { \"type\": \"number\", \"values\": [ 1, 2 ] }, \"y\": { \"type\": \"number\", \"values\": [ 1 ] } } } ]";
+    EXPECT_ANY_THROW(project(bad_column, { "[0].columns.x" }, false, 0));
+    EXPECT_NO_THROW(project(bad_column, { "[0].columns.x" }, true, 0));
+
+    // External references are still checked in unselected subtrees, unless we trust the document.
+    EXPECT_ANY_THROW(project(document, { ".a" }, false, 3));
+    EXPECT_NO_THROW(project(document, { ".a" }, true, 3));
+
+    uzuki::Options opt;
+    opt.projection.paths.push_back(".a");
+    EXPECT_EQ(uzuki::validate(nlohmann::json::parse(document), opt), 2);
+}
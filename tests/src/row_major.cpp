@@ -0,0 +1,103 @@
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+#include "uzuki/parse.hpp"
+#include "nlohmann/json.hpp"
+
+#include "test_subclass.h"
+
+#include <cmath>
+
+struct RowMajorProvisioner : public DefaultProvisioner {
+    static constexpr bool row_major = true;
+};
+
+// Reference implementation that computes the row-major index of each column-major index.
+static size_t row_major_index(size_t i, const std::vector<size_t>& dims) {
+    std::vector<size_t> position(dims.size());
+    for (size_t d = 0; d < dims.size(); ++d) {
+        position[d] = i % dims[d];
+        i /= dims[d];
+    }
+    size_t out = 0;
+    for (size_t d = 0; d < dims.size(); ++d) {
+        out = out * dims[d] + position[d];
+    }
+    return out;
+}
+
+class RowMajorDimensionsTest : public ::testing::TestWithParam<std::vector<size_t> > {};
+
+TEST_P(RowMajorDimensionsTest, Numbers) {
+    auto dims = GetParam();
+    size_t total = 1;
+    for (auto d : dims) {
+        total *= d;
+    }
+
+    nlohmann::json values = nlohmann::json::array();
+    for (size_t i = 0; i < total; ++i) {
+        if (i % 7 == 3) {
+            values.push_back(nullptr);
+        } else {
+            values.push_back(static_cast<double>(i));
+        }
+    }
+    nlohmann::json contents = {{ "a", {{ "type", "number" }, { "values", values }, { "dimensions", dims }} }};
+
+    auto parsed = uzuki::parse<RowMajorProvisioner>(contents, DefaultExternals(0));
+    auto list = static_cast<const DefaultList*>(parsed.get());
+    auto arr = static_cast<const DefaultNumberArray*>(list->values[0].get());
+    EXPECT_EQ(arr->base.dimensions, dims);
+
+    std::vector<double> expected(total);
+    for (size_t i = 0; i < total; ++i) {
+        expected[row_major_index(i, dims)] = (i % 7 == 3 ? -1 : static_cast<double>(i));
+    }
+    std::vector<double> observed = arr->base.values;
+    for (auto& x : observed) {
+        if (std::isnan(x)) {
+            x = -1;
+        }
+    }
+    EXPECT_EQ(observed, expected);
+}
+
+INSTANTIATE_TEST_SUITE_P(
+    RowMajor,
+    RowMajorDimensionsTest,
+    ::testing::Values(
+        std::vector<size_t>{ 5 },
+        std::vector<size_t>{ 3, 4 },
+        std::vector<size_t>{ 70, 45 },
+        std::vector<size_t>{ 33, 3, 40 },
+        std::vector<size_t>{ 2, 3, 4, 5 },
+        std::vector<size_t>{ 4, 0, 3 }
+    )
+);
+
+TEST(RowMajorTest, Encodings) {
+    auto contents = nlohmann::json::parse("{ \
+        \"a\": { \"type\": \"integer\", \"encoding\": \"sequence\", \"start\": 0, \"step\": 1, \"length\": 6, \"dimensions\": [ 2, 3 ] }, \
+        \"b\": { \"type\": \"string\", \"encoding\": \"rle\", \"values\": [ \"x\", null, \"y\" ], \"lengths\": [ 2, 1, 3 ], \"dimensions\": [ 2, 3 ] }, \
+        \"c\": { \"type\": \"factor\", \"values\": [ \"p\", \"q\", \"q\", \"p\", \"p\", \"p\" ], \"levels\": [ \"p\", \"q\" ], \"dimensions\": [ 2, 3 ], \"names\": [ [ \"r1\", \"r2\" ], null ] }, \
+        \"d\": { \"type\": \"integer\", \"values\": [ 1, 2, 3 ] } \
+    }");
+
+    auto parsed = uzuki::parse<RowMajorProvisioner>(contents, DefaultExternals(0));
+    auto list = static_cast<const DefaultList*>(parsed.get());
+
+    auto a = static_cast<const DefaultIntegerArray*>(list->values[0].get());
+    EXPECT_EQ(a->base.values, std::vector<int32_t>({ 0, 2, 4, 1, 3, 5 }));
+
+    auto b = static_cast<const DefaultStringArray*>(list->values[1].get());
+    EXPECT_EQ(b->base.values, std::vector<std::string>({ "x", "ich bin missing", "y", "x", "y", "y" }));
+
+    auto c = static_cast<const DefaultFactorArray*>(list->values[2].get());
+    EXPECT_EQ(c->abase.values, std::vector<size_t>({ 0, 1, 0, 1, 0, 0 }));
+    EXPECT_EQ(c->abase.names[0], std::vector<std::string>({ "r1", "r2" }));
+
+    // Vectors are unaffected.
+    auto d = static_cast<const DefaultIntegerVector*>(list->values[3].get());
+    EXPECT_EQ(d->base.values, std::vector<int32_t>({ 1, 2, 3 }));
+}
@@ -0,0 +1,118 @@
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+#include "uzuki/parse.hpp"
+#include "uzuki/scalar.hpp"
+#include "nlohmann/json.hpp"
+
+#include "test_subclass.h"
+
+static size_t scalar_calls = 0;
+
+struct ScalarProvisioner : public DefaultProvisioner {
+    static uzuki::IntegerVector* new_IntegerScalar(int32_t v) {
+        ++scalar_calls;
+        return new uzuki::IntegerScalarVector(v);
+    }
+
+    static uzuki::NumberVector* new_NumberScalar(double v) {
+        ++scalar_calls;
+        return new uzuki::NumberScalarVector(v);
+    }
+
+    static uzuki::StringVector* new_StringScalar(std::string v) {
+        ++scalar_calls;
+        return new uzuki::StringScalarVector(std::move(v));
+    }
+
+    static uzuki::BooleanVector* new_BooleanScalar(unsigned char v) {
+        ++scalar_calls;
+        return new uzuki::BooleanScalarVector(v);
+    }
+
+    // No hook for dates, to check that the hooks are detected separately.
+};
+
+class ScalarTest : public ::testing::Test {
+protected:
+    void SetUp() {
+        scalar_calls = 0;
+    }
+};
+
+TEST_F(ScalarTest, Basic) {
+    auto contents = nlohmann::json::parse("{ \
+        \"a\": { \"type\": \"integer\", \"values\": [ 5 ] }, \
+        \"b\": { \"type\": \"number\", \"values\": [ 2.5 ], \"names\": [ \"foo\" ] }, \
+        \"c\": { \"type\": \"string\", \"values\": [ \"bar\" ] }, \
+        \"d\": { \"type\": \"boolean\", \"values\": [ true ] }, \
+        \"e\": { \"type\": \"date\", \"values\": [ \"2023-01-01\" ] } \
+    }");
+    auto parsed = uzuki::parse<ScalarProvisioner>(contents, DefaultExternals(0));
+    EXPECT_EQ(scalar_calls, 4);
+
+    auto list = static_cast<const DefaultList*>(parsed.get());
+    EXPECT_EQ(static_cast<const uzuki::IntegerScalarVector*>(list->values[0].get())->value, 5);
+
+    auto b = static_cast<const uzuki::NumberScalarVector*>(list->values[1].get());
+    EXPECT_EQ(b->value, 2.5);
+    EXPECT_TRUE(b->has_names);
+    EXPECT_EQ(b->name, "foo");
+
+    EXPECT_EQ(static_cast<const uzuki::StringScalarVector*>(list->values[2].get())->value, "bar");
+    EXPECT_EQ(static_cast<const uzuki::BooleanScalarVector*>(list->values[3].get())->value, 1);
+
+    auto e = static_cast<const DefaultDateVector*>(list->values[4].get());
+    EXPECT_EQ(e->base.values[0], "2023-01-01");
+}
+
+TEST_F(ScalarTest, Fallback) {
+    // Missing values, arrays, factors and other encodings go through the usual path.
+    auto contents = nlohmann::json::parse("{ \
+        \"a\": { \"type\": \"integer\", \"values\": [ null ] }, \
+        \"b\": { \"type\": \"number\", \"values\": [ 1 ], \"dimensions\": [ 1 ] }, \
+        \"c\": { \"type\": \"factor\", \"values\": [ \"x\" ], \"levels\": [ \"x\" ] }, \
+        \"d\": { \"type\": \"integer\", \"encoding\": \"rle\", \"values\": [ 1 ], \"lengths\": [ 1 ] }, \
+        \"e\": { \"type\": \"number\", \"encoding\": \"sequence\", \"start\": 1, \"step\": 1, \"length\": 1 }, \
+        \"f\": { \"type\": \"string\", \"values\": [ \"x\", \"y\" ] } \
+    }");
+    auto parsed = uzuki::parse<ScalarProvisioner>(contents, DefaultExternals(0));
+    EXPECT_EQ(scalar_calls, 0);
+
+    auto list = static_cast<const DefaultList*>(parsed.get());
+    EXPECT_EQ(list->values[0]->type(), uzuki::INTEGER);
+    EXPECT_EQ(list->values[1]->type(), uzuki::NUMBER_ARRAY);
+}
+
+TEST_F(ScalarTest, Errors) {
+    auto contents = nlohmann::json::parse("{ \"a\": { \"type\": \"integer\", \"values\": [ 1.5 ] } }");
+    EXPECT_ANY_THROW({
+        try {
+            uzuki::parse<ScalarProvisioner>(contents, DefaultExternals(0));
+        } catch (std::exception& e) {
+            EXPECT_THAT(e.what(), ::testing::HasSubstr("\".a.values[0]\" should be an integer"));
+            throw;
+        }
+    });
+
+    contents = nlohmann::json::parse("{ \"a\": { \"type\": \"string\", \"values\": [ \"x\" ], \"names\": [ \"y\", \"z\" ] } }");
+    EXPECT_ANY_THROW({
+        try {
+            uzuki::parse<ScalarProvisioner>(contents, DefaultExternals(0));
+        } catch (std::exception& e) {
+            EXPECT_THAT(e.what(), ::testing::HasSubstr("names"));
+            throw;
+        }
+    });
+}
+
+TEST_F(ScalarTest, Statistics) {
+    uzuki::Statistics stats;
+    uzuki::Options opt;
+    opt.statistics = &stats;
+    uzuki::parse<ScalarProvisioner>(nlohmann::json::parse("{ \"a\": { \"type\": \"number\", \"values\": [ 3 ] } }"), DefaultExternals(0), opt);
+    EXPECT_EQ(scalar_calls, 1);
+    const auto& a = stats.nodes.at(".a");
+    EXPECT_EQ(a.count, 1);
+    EXPECT_EQ(a.sum, 3);
+}
@@ -0,0 +1,168 @@
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+#include "uzuki/parse.hpp"
+#include "uzuki/validate.hpp"
+#include "nlohmann/json.hpp"
+
+#include "test_subclass.h"
+
+#include <cmath>
+
+static uzuki::Statistics collect(std::string contents) {
+    uzuki::Statistics stats;
+    uzuki::Options opt;
+    opt.statistics = &stats;
+    uzuki::parse<DefaultProvisioner>(nlohmann::json::parse(contents), DefaultExternals(0), opt);
+    return stats;
+}
+
+TEST(StatisticsTest, Numbers) {
+    auto stats = collect("{ \
+        \"a\": { \"type\": \"integer\", \"values\": [ 1, null, 5, 3 ] }, \
+        \"b\": { \"type\": \"number\", \"encoding\": \"rle\", \"values\": [ 1.5, null, 2 ], \"lengths\": [ 2, 3, 1 ], \"dimensions\": [ 3, 2 ] }, \
+        \"c\": { \"type\": \"boolean\", \"values\": [ true, false, true ] }, \
+        \"d\": { \"type\": \"integer\", \"encoding\": \"sequence\", \"start\": 10, \"step\": -2, \"length\": 4 } \
+    }");
+
+    const auto& a = stats.nodes.at(".a");
+    EXPECT_EQ(a.count, 3);
+    EXPECT_EQ(a.missing, 1);
+    EXPECT_EQ(a.min, 1);
+    EXPECT_EQ(a.max, 5);
+    EXPECT_EQ(a.sum, 9);
+    EXPECT_FALSE(a.sorted);
+
+    const auto& b = stats.nodes.at(".b");
+    EXPECT_EQ(b.count, 3);
+    EXPECT_EQ(b.missing, 3);
+    EXPECT_EQ(b.min, 1.5);
+    EXPECT_EQ(b.max, 2);
+    EXPECT_EQ(b.sum, 5);
+    EXPECT_TRUE(b.sorted); // missing values are ignored.
+
+    const auto& c = stats.nodes.at(".c");
+    EXPECT_EQ(c.sum, 2);
+    EXPECT_EQ(c.min, 0);
+    EXPECT_EQ(c.max, 1);
+    EXPECT_FALSE(c.sorted);
+
+    const auto& d = stats.nodes.at(".d");
+    EXPECT_EQ(d.count, 4);
+    EXPECT_EQ(d.min, 4);
+    EXPECT_EQ(d.max, 10);
+    EXPECT_FALSE(d.sorted);
+    EXPECT_EQ(d.distinct, 0);
+    EXPECT_TRUE(d.level_counts.empty());
+}
+
+TEST(StatisticsTest, Binary) {
+    // Base64-encoded doubles 1, 2 with the second one missing.
+    auto stats = collect("{ \"a\": { \"type\": \"number\", \"encoding\": \"base64\", \"values\": \"AAAAAAAA8D8AAAAAAAAAQA==\", \"validity\": \"AQ==\" } }");
+    const auto& a = stats.nodes.at(".a");
+    EXPECT_EQ(a.count, 1);
+    EXPECT_EQ(a.missing, 1);
+    EXPECT_EQ(a.sum, 1);
+
+    // Base64-encoded doubles 1, NaN, 2, where the NaN is not missing.
+    stats = collect("{ \"a\": { \"type\": \"number\", \"encoding\": \"base64\", \"values\": \"AAAAAAAA8D8AAAAAAAD4fwAAAAAAAABA\" } }");
+    const auto& n = stats.nodes.at(".a");
+    EXPECT_EQ(n.count, 3);
+    EXPECT_EQ(n.sum, 3);
+    EXPECT_EQ(n.min, 1);
+    EXPECT_EQ(n.max, 2);
+    EXPECT_TRUE(n.sorted);
+}
+
+TEST(StatisticsTest, Strings) {
+    auto stats = collect("{ \
+        \"a\": { \"type\": \"string\", \"values\": [ \"apple\", \"banana\", null, \"banana\", \"cherry\" ] }, \
+        \"b\": { \"type\": \"date\", \"values\": [ \"2023-05-01\", \"2023-01-01\" ] }, \
+        \"c\": { \"type\": \"string\", \"values\": [] } \
+    }");
+
+    const auto& a = stats.nodes.at(".a");
+    EXPECT_EQ(a.count, 4);
+    EXPECT_EQ(a.missing, 1);
+    EXPECT_TRUE(a.sorted);
+    EXPECT_NEAR(a.distinct, 3, 0.1);
+    EXPECT_TRUE(std::isnan(a.min));
+    EXPECT_EQ(a.sum, 0);
+
+    const auto& b = stats.nodes.at(".b");
+    EXPECT_FALSE(b.sorted);
+    EXPECT_NEAR(b.distinct, 2, 0.1);
+
+    const auto& c = stats.nodes.at(".c");
+    EXPECT_EQ(c.count, 0);
+    EXPECT_EQ(c.distinct, 0);
+}
+
+TEST(StatisticsTest, StringValues) {
+    // Collecting statistics doesn't affect the stored values.
+    uzuki::Statistics stats;
+    uzuki::Options opt;
+    opt.statistics = &stats;
+    auto parsed = uzuki::parse<DefaultProvisioner>(nlohmann::json::parse("[ \
+        { \"type\": \"string\", \"values\": [ \"b\", null, \"a\", \"c\" ] }, \
+        { \"type\": \"string\", \"values\": [ \"a\", \"b\", \"c\", \"d\" ], \"dimensions\": [ 2, 2 ] } \
+    ]"), DefaultExternals(0), opt);
+    auto list = static_cast<const DefaultList*>(parsed.get());
+
+    auto vec = static_cast<const DefaultStringVector*>(list->values[0].get());
+    EXPECT_EQ(vec->base.values, std::vector<std::string>({ "b", "ich bin missing", "a", "c" }));
+    EXPECT_FALSE(stats.nodes.at("[0]").sorted);
+
+    auto arr = static_cast<const DefaultStringArray*>(list->values[1].get());
+    EXPECT_EQ(arr->base.values, std::vector<std::string>({ "a", "b", "c", "d" }));
+    EXPECT_TRUE(stats.nodes.at("[1]").sorted);
+}
+
+TEST(StatisticsTest, Distinct) {
+    nlohmann::json values = nlohmann::json::array();
+    for (size_t i = 0; i < 20000; ++i) {
+        values.push_back("value_" + std::to_string(i % 5000));
+    }
+    nlohmann::json contents = {{ "a", {{ "type", "string" }, { "values", values }} }};
+
+    uzuki::Statistics stats;
+    uzuki::Options opt;
+    opt.statistics = &stats;
+    uzuki::parse<DefaultProvisioner>(contents, DefaultExternals(0), opt);
+
+    const auto& a = stats.nodes.at(".a");
+    EXPECT_EQ(a.count, 20000);
+    EXPECT_NEAR(a.distinct, 5000, 5000 * 0.1);
+}
+
+TEST(StatisticsTest, Factors) {
+    auto stats = collect("{ \
+        \"a\": [ { \"type\": \"factor\", \"values\": [ \"lo\", \"lo\", null, \"hi\" ], \"levels\": [ \"lo\", \"mid\", \"hi\" ] } ], \
+        \"b\": { \"type\": \"data.frame\", \"rows\": 3, \"columns\": { \"x\": { \"type\": \"ordered\", \"encoding\": \"rle\", \"values\": [ \"hi\", \"lo\" ], \"lengths\": [ 1, 2 ], \"levels\": [ \"lo\", \"hi\" ] } } } \
+    }");
+
+    const auto& a = stats.nodes.at(".a[0]");
+    EXPECT_EQ(a.level_counts, std::vector<size_t>({ 2, 0, 1 }));
+    EXPECT_EQ(a.count, 3);
+    EXPECT_EQ(a.missing, 1);
+    EXPECT_EQ(a.distinct, 2);
+    EXPECT_TRUE(a.sorted);
+
+    const auto& x = stats.nodes.at(".b.columns.x");
+    EXPECT_EQ(x.level_counts, std::vector<size_t>({ 2, 1 }));
+    EXPECT_FALSE(x.sorted);
+}
+
+TEST(StatisticsTest, Validation) {
+    // Same statistics are computed without a provisioner.
+    uzuki::Statistics stats;
+    uzuki::Options opt;
+    opt.statistics = &stats;
+    uzuki::validate(nlohmann::json::parse("{ \"a\": { \"type\": \"number\", \"values\": [ 3, 1, 2 ] } }"), 0, opt);
+    EXPECT_EQ(stats.nodes.at(".a").sum, 6);
+    EXPECT_EQ(stats.nodes.at(".a").min, 1);
+
+    // Nothing is collected if not requested.
+    auto parsed = uzuki::parse<DefaultProvisioner>(nlohmann::json::parse("{ \"a\": { \"type\": \"number\", \"values\": [ 3 ] } }"), DefaultExternals(0));
+    EXPECT_EQ(parsed->type(), uzuki::LIST);
+}
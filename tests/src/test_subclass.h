@@ -6,6 +6,7 @@
 #include <memory>
 #include <cstdint>
 #include <limits>
+#include <future>
 
 #include "uzuki/interfaces.hpp"
 
@@ -394,4 +395,38 @@ struct DefaultExternals {
     size_t number;
 };
 
+struct BatchedExternals {
+    BatchedExternals(size_t n) : number(n) {}
+
+    std::vector<void*> get_batch(const std::vector<size_t>& indices) {
+        ++(*calls);
+        std::vector<void*> output;
+        for (auto i : indices) {
+            output.push_back(reinterpret_cast<void*>(static_cast<uintptr_t>(i + 1)));
+        }
+        return output;
+    }
+
+    size_t size() const {
+        return number;
+    }
+
+    size_t number;
+    std::shared_ptr<int> calls = std::make_shared<int>(0); // shared with copies, as parse() takes its Externals by value.
+};
+
+struct AsyncExternals {
+    AsyncExternals(size_t n) : number(n) {}
+
+    std::future<void*> get_async(size_t i) {
+        return std::async(std::launch::async, [](size_t i) -> void* { return reinterpret_cast<void*>(static_cast<uintptr_t>(i + 1)); }, i);
+    }
+
+    size_t size() const {
+        return number;
+    }
+
+    size_t number;
+};
+
 #endif
@@ -2,6 +2,7 @@
 #include <gmock/gmock.h>
 
 #include "uzuki/validate.hpp"
+#include "uzuki/limits.hpp"
 #include "nlohmann/json.hpp"
 
 void quick_check(std::string contents, std::string msg, int nexpected = 0) {
@@ -47,7 +48,105 @@ TEST(BasicListTest, OtherChecks) {
     quick_check("[{ \"type\": \"other\", \"index\": -1 }]", "non-negative");
     quick_check("[{ \"type\": \"other\", \"index\": 1 }]", "out of range", 1);
     quick_check("[{ \"type\": \"other\", \"index\": 0 }]", "fewer", 2);
-    quick_check("[{ \"type\": \"other\", \"index\": 0 }, { \"type\": \"other\", \"index\": 0 } ]", "should be consecutive", 2);
+    quick_check("[{ \"type\": \"other\", \"index\": 0 }, { \"type\": \"other\", \"index\": 0 } ]", "\"[1].index\" for type \"other\" is duplicated", 2);
+}
+
+static void unknown_check(std::string contents, std::string msg) {
+    nlohmann::json mocked = nlohmann::json::parse(contents);
+    EXPECT_ANY_THROW({
+        try {
+            uzuki::validate(mocked);
+        } catch (std::exception& e) {
+            EXPECT_THAT(e.what(), ::testing::HasSubstr(msg));
+            throw;
+        }
+    });
+}
+
+TEST(BasicListTest, UnknownOtherChecks) {
+    unknown_check("[{ \"type\": \"other\", \"index\": 1 }, { \"type\": \"other\", \"index\": 1 } ]", "\"[1].index\" for type \"other\" is duplicated");
+    unknown_check("[{ \"type\": \"other\", \"index\": 1 }]", "should be consecutive");
+
+    // Huge indices are deferred rather than allocating a huge bitmap.
+    unknown_check("[{ \"type\": \"other\", \"index\": 1e15 }]", "should be consecutive");
+    unknown_check("[{ \"type\": \"other\", \"index\": 1e300 }]", "out of range");
+
+    // Order of indices doesn't matter.
+    std::string contents = "[";
+    size_t n = 10000;
+    for (size_t i = 0; i < n; ++i) {
+        if (i) {
+            contents += ",";
+        }
+        contents += "{ \"type\": \"other\", \"index\": " + std::to_string(n - i - 1) + " }";
+    }
+    contents += "]";
+    EXPECT_EQ(uzuki::validate(nlohmann::json::parse(contents)), n);
+}
+
+TEST(ExternalIndicesTest, Deferred) {
+    uzuki::ExternalIndices indices;
+    EXPECT_TRUE(indices.add(5000));
+    EXPECT_TRUE(indices.seen.empty());
+    EXPECT_EQ(indices.deferred.size(), 1);
+    for (size_t i = 0; i < 5000; ++i) {
+        EXPECT_TRUE(indices.add(i));
+    }
+    uzuki::Result status;
+    EXPECT_TRUE(indices.finish(status));
+
+    // Deferred duplicates are caught at the end.
+    indices.clear();
+    EXPECT_TRUE(indices.add(5000));
+    EXPECT_TRUE(indices.add(5000));
+    EXPECT_FALSE(indices.finish(status));
+
+    indices.clear();
+    EXPECT_TRUE(indices.add(5000));
+    for (size_t i = 0; i <= 5000; ++i) {
+        indices.add(i);
+    }
+    uzuki::Result status2;
+    EXPECT_FALSE(indices.finish(status2));
+    EXPECT_EQ(status2.code, uzuki::ErrorCode::DUPLICATE_EXTERNAL);
+
+    // Duplicated outliers are reported as such, rather than as a problem with the count.
+    indices.clear();
+    EXPECT_TRUE(indices.add(5000));
+    EXPECT_TRUE(indices.add(5000));
+    uzuki::Result status3;
+    EXPECT_FALSE(indices.finish(status3));
+    EXPECT_EQ(status3.code, uzuki::ErrorCode::DUPLICATE_EXTERNAL);
+    EXPECT_EQ(status3.index, 5000);
+
+    auto doc = nlohmann::json::parse("[ { \"type\": \"other\", \"index\": 5000 }, { \"type\": \"other\", \"index\": 5000 } ]");
+    EXPECT_EQ(uzuki::validate_nothrow(doc, 5001).code, uzuki::ErrorCode::DUPLICATE_EXTERNAL);
+    size_t num_external;
+    EXPECT_EQ(uzuki::validate_nothrow(doc, uzuki::Options(), num_external).code, uzuki::ErrorCode::DUPLICATE_EXTERNAL);
+}
+
+TEST(ExternalIndicesTest, Merge) {
+    uzuki::ExternalIndices left, right;
+    for (size_t i = 0; i < 200; i += 2) {
+        EXPECT_TRUE(left.add(i));
+    }
+    for (size_t i = 1; i < 200; i += 2) {
+        EXPECT_TRUE(right.add(i));
+    }
+    EXPECT_TRUE(right.add(100000));
+
+    uzuki::Result status;
+    EXPECT_TRUE(left.merge(right, status));
+    EXPECT_EQ(left.count, 201);
+    EXPECT_FALSE(left.finish(status)); // 100000 is not consecutive.
+    EXPECT_EQ(status.code, uzuki::ErrorCode::EXTERNAL_COUNT);
+
+    uzuki::ExternalIndices other;
+    other.add(10);
+    uzuki::Result status2;
+    EXPECT_FALSE(left.merge(other, status2));
+    EXPECT_EQ(status2.code, uzuki::ErrorCode::DUPLICATE_EXTERNAL);
+    EXPECT_THAT(status2.message(), ::testing::HasSubstr("value of 10"));
 }
 
 TEST(BasicListTest, VectorNameChecks) {
@@ -77,11 +176,65 @@ TEST(BasicListTest, DataFrameChecks) {
     quick_check("[{ \"type\": \"data.frame\", \"rows\": 2, \"columns\": { \"foo\": { \"type\": \"integer\", \"values\": [ 1, 2 ]} }, \"names\": []}]", "length");
 }
 
+TEST(BasicListTest, EncodingChecks) {
+    quick_check("[{ \"type\": \"integer\", \"values\": [1, 2], \"encoding\": 1 }]", "should be a string");
+    quick_check("[{ \"type\": \"integer\", \"values\": [1, 2], \"encoding\": \"foo\" }]", "unrecognized");
+
+    quick_check("[{ \"type\": \"integer\", \"values\": [1, 2], \"encoding\": \"rle\" }]", "[0].lengths");
+    quick_check("[{ \"type\": \"integer\", \"values\": [1, 2], \"encoding\": \"rle\", \"lengths\": [1] }]", "length equal to");
+    quick_check("[{ \"type\": \"integer\", \"values\": [1, 2], \"encoding\": \"rle\", \"lengths\": [1, -1] }]", "non-negative integer");
+    quick_check("[{ \"type\": \"integer\", \"values\": [1, \"a\"], \"encoding\": \"rle\", \"lengths\": [1, 2] }]", "[0].values[1]");
+    quick_check("[{ \"type\": \"integer\", \"values\": [1, 2], \"encoding\": \"rle\", \"lengths\": [2, 2], \"dimensions\": [3, 1] }]", "product");
+
+    quick_check("[{ \"type\": \"integer\", \"encoding\": \"sequence\", \"step\": 1, \"length\": 2 }]", "[0].start");
+    quick_check("[{ \"type\": \"integer\", \"encoding\": \"sequence\", \"start\": 1, \"step\": 1, \"length\": 2.5 }]", "non-negative integer");
+    quick_check("[{ \"type\": \"integer\", \"encoding\": \"sequence\", \"start\": 1.5, \"step\": 1, \"length\": 2 }]", "should be integers");
+    quick_check("[{ \"type\": \"integer\", \"encoding\": \"sequence\", \"start\": 2147483640, \"step\": 1, \"length\": 100 }]", "32-bit integer range");
+    quick_check("[{ \"type\": \"string\", \"encoding\": \"sequence\", \"start\": 1, \"step\": 1, \"length\": 2 }]", "only supported");
+    quick_check("[{ \"type\": \"number\", \"encoding\": \"sequence\", \"start\": 1, \"step\": 1, \"length\": 6, \"dimensions\": [4, 2] }]", "product");
+}
+
+TEST(BasicListTest, Base64Checks) {
+    quick_check("[{ \"type\": \"string\", \"values\": \"AAAA\", \"encoding\": \"base64\" }]", "only supported");
+    quick_check("[{ \"type\": \"integer\", \"values\": [ 1 ], \"encoding\": \"base64\" }]", "should be a string");
+    quick_check("[{ \"type\": \"integer\", \"values\": \"AA!A\", \"encoding\": \"base64\" }]", "valid base64");
+    quick_check("[{ \"type\": \"integer\", \"values\": \"AAA=\", \"encoding\": \"base64\" }]", "multiple of 4 bytes");
+    quick_check("[{ \"type\": \"boolean\", \"values\": \"AQI=\", \"encoding\": \"base64\" }]", "[0].values[1]");
+    quick_check("[{ \"type\": \"integer\", \"values\": \"AAAAAA==\", \"encoding\": \"base64\", \"validity\": 1 }]", "validity");
+    quick_check("[{ \"type\": \"integer\", \"values\": \"AAAAAA==\", \"encoding\": \"base64\", \"validity\": \"AAA=\" }]", "decode to 1 bytes");
+    quick_check("[{ \"type\": \"integer\", \"values\": \"AAAAAA==\", \"encoding\": \"base64\", \"dimensions\": [ 2 ] }]", "product");
+}
+
 void quick_check(std::string contents, int num) {
     nlohmann::json mocked = nlohmann::json::parse(contents);
     EXPECT_NO_THROW(uzuki::validate(mocked, num));
 } 
 
+TEST(BasicListTest, DeepNesting) {
+    // Deeply nested lists should not overflow the stack.
+    size_t depth = 200000;
+    std::string contents;
+    for (size_t i = 0; i < depth; ++i) {
+        contents += (i % 2 == 0 ? "[" : "{\"a\":");
+    }
+    contents += "{ \"type\": \"other\", \"index\": 0 }";
+    for (size_t i = depth; i > 0; --i) {
+        contents += ((i - 1) % 2 == 0 ? "]" : "}");
+    }
+
+    nlohmann::json mocked = nlohmann::json::parse(contents);
+    EXPECT_EQ(uzuki::validate(mocked), 1);
+    EXPECT_EQ(uzuki::estimate_cost(mocked).depth, depth);
+    EXPECT_ANY_THROW({
+        try {
+            uzuki::validate(mocked, 0);
+        } catch (std::exception& e) {
+            EXPECT_THAT(e.what(), ::testing::HasSubstr("[0].a[0].a"));
+            throw;
+        }
+    });
+}
+
 TEST(BasicListTest, SimpleSuccess) {
     // Some simple cases.
     quick_check("[ { \"type\": \"string\", \"values\": [\"a\"] } ]", 0);